@@ -0,0 +1,143 @@
+// Classification, backoff and the fault payload have no Arduino
+// dependencies — compiled on all platforms; RTC access is device-only.
+#include "BootGuard.h"
+#include <stdio.h>
+#include <string.h>
+#include "CpuPolicy.h"
+
+void boot_guard_reset(BootGuardState& s) {
+    memset(&s, 0, sizeof(s));
+    s.magic         = BOOT_GUARD_MAGIC;
+    s.phase         = BOOT_GUARD_PHASE_IDLE;
+    s.failing_phase = BOOT_GUARD_PHASE_IDLE;
+}
+
+bool boot_guard_is_abnormal(uint8_t reason, uint8_t marker) {
+    switch (reason) {
+        case BOOT_REASON_WDT:
+        case BOOT_REASON_EXCEPTION:
+        case BOOT_REASON_SOFT_WDT:
+            return true;
+        case BOOT_REASON_EXT_SYS:
+            return marker != BOOT_GUARD_PHASE_IDLE && marker != BOOT_GUARD_PHASE_RELAY;
+        default:
+            return false;
+    }
+}
+
+uint8_t boot_guard_abnormal_count(const BootGuardState& s) {
+    uint8_t n = 0;
+    for (uint8_t w = s.window; w; w &= (uint8_t)(w - 1)) n++;
+    return n;
+}
+
+bool boot_guard_skips(const BootGuardState& s, uint8_t phase) {
+    return s.degraded && phase != BOOT_GUARD_PHASE_RELAY && s.failing_phase == phase;
+}
+
+static const char* boot_guard_phase_name(uint8_t phase) {
+    if (phase == BOOT_GUARD_PHASE_IDLE)  return "none";
+    if (phase == BOOT_GUARD_PHASE_RELAY) return "relay";
+    return cpu_phase_name((CpuPhase)phase);
+}
+
+bool boot_guard_on_boot(BootGuardState& s, uint8_t reason) {
+    if (s.magic != BOOT_GUARD_MAGIC) boot_guard_reset(s);
+    bool abnormal = boot_guard_is_abnormal(reason, s.phase);
+    s.window = (uint8_t)((s.window << 1) | (abnormal ? 1 : 0));
+    if (abnormal) {
+        // A crash before the first marker (or after a clean end) is charged to boot
+        s.failing_phase    = (s.phase == BOOT_GUARD_PHASE_IDLE) ? (uint8_t)CPU_PHASE_BOOT : s.phase;
+        s.reasons[s.head]  = reason;
+        s.phases[s.head]   = s.failing_phase;
+        s.head             = (uint8_t)((s.head + 1) % BOOT_GUARD_HISTORY);
+        if (s.resets < 255) s.resets++;
+    }
+    s.phase    = CPU_PHASE_BOOT;
+    s.degraded = boot_guard_abnormal_count(s) >= BOOT_GUARD_TRIP;
+    return s.degraded;
+}
+
+uint32_t boot_guard_backoff_s(uint32_t normal_s, uint8_t degraded_wakes) {
+    uint32_t s = normal_s;
+    for (uint8_t i = 0; i <= degraded_wakes && s < BOOT_GUARD_BACKOFF_MAX_S; i++) s *= 2;
+    if (s > BOOT_GUARD_BACKOFF_MAX_S) s = BOOT_GUARD_BACKOFF_MAX_S;
+    return s < normal_s ? normal_s : s;
+}
+
+size_t boot_guard_format(const BootGuardState& s, char* buf, size_t len) {
+    const char* phase = boot_guard_phase_name(s.failing_phase);
+    int n = snprintf(buf, len, "phase=%s;resets=%u/%u;reasons=", phase,
+                     (unsigned)boot_guard_abnormal_count(s), (unsigned)BOOT_GUARD_WINDOW);
+    uint8_t kept = s.resets < BOOT_GUARD_HISTORY ? s.resets : BOOT_GUARD_HISTORY;
+    for (uint8_t i = 0; i < kept && n > 0 && (size_t)n < len; i++) {
+        uint8_t slot = (uint8_t)((s.head + BOOT_GUARD_HISTORY - 1 - i) % BOOT_GUARD_HISTORY);
+        n += snprintf(buf + n, len - (size_t)n, i ? ",%u" : "%u", (unsigned)s.reasons[slot]);
+    }
+    if (n > 0 && (size_t)n < len) {
+        n += snprintf(buf + n, len - (size_t)n, ";backoff=%u", (unsigned)s.degraded_wakes);
+    }
+    return (n < 0) ? 0 : ((size_t)n < len ? (size_t)n : len - 1);
+}
+
+#ifndef NATIVE_TEST
+
+#include <Arduino.h>
+#include "Log.h"
+#include "RtcLayout.h"
+
+static_assert(sizeof(BootGuardState) <= RTC_BLOCKS_BOOT_GUARD * RTC_BLOCK_SIZE,
+              "BootGuardState outgrew its RTC region");
+
+// Block 1 holds phase, window, degraded_wakes and failing_phase
+#define BOOT_GUARD_MARKER_BLOCK 1
+static_assert(offsetof(BootGuardState, phase) == BOOT_GUARD_MARKER_BLOCK * RTC_BLOCK_SIZE,
+              "phase marker must start block 1");
+
+static BootGuardState s_guard;
+
+bool boot_guard_begin() {
+    ESP.rtcUserMemoryRead(RTC_BLOCK_BOOT_GUARD, (uint32_t*)&s_guard, sizeof(s_guard));
+    bool degraded = boot_guard_on_boot(s_guard, (uint8_t)ESP.getResetInfoPtr()->reason);
+    ESP.rtcUserMemoryWrite(RTC_BLOCK_BOOT_GUARD, (uint32_t*)&s_guard, sizeof(s_guard));
+    if (degraded) {
+        LOG_W("[Guard] %u of the last %u boots crashed — degraded wake, %s %s\n",
+              boot_guard_abnormal_count(s_guard), BOOT_GUARD_WINDOW,
+              s_guard.failing_phase == BOOT_GUARD_PHASE_RELAY ? "reporting" : "skipping",
+              boot_guard_phase_name(s_guard.failing_phase));
+    }
+    return degraded;
+}
+
+void boot_guard_mark(uint8_t phase) {
+    s_guard.phase = phase;
+    ESP.rtcUserMemoryWrite(RTC_BLOCK_BOOT_GUARD + BOOT_GUARD_MARKER_BLOCK,
+                           (uint32_t*)&s_guard + BOOT_GUARD_MARKER_BLOCK, RTC_BLOCK_SIZE);
+}
+
+bool boot_guard_degraded() {
+    return s_guard.degraded;
+}
+
+bool boot_guard_skip(uint8_t phase) {
+    return boot_guard_skips(s_guard, phase);
+}
+
+uint32_t boot_guard_sleep_s(uint32_t normal_s) {
+    uint32_t sleep_s = normal_s;
+    if (s_guard.degraded) {
+        sleep_s = boot_guard_backoff_s(normal_s, s_guard.degraded_wakes);
+        if (s_guard.degraded_wakes < 255) s_guard.degraded_wakes++;
+        LOG_W("[Guard] Backoff sleep %us (degraded wake %u)\n", sleep_s, s_guard.degraded_wakes);
+    } else {
+        s_guard.degraded_wakes = 0;
+    }
+    boot_guard_mark(BOOT_GUARD_PHASE_IDLE);  // also writes degraded_wakes
+    return sleep_s;
+}
+
+const BootGuardState& boot_guard_state() {
+    return s_guard;
+}
+
+#endif // NATIVE_TEST
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Crash-loop detection. A phase marker, the last abnormal resets and a
+// window of recent boots live in RTC memory (RTC_BLOCK_BOOT_GUARD). main.cpp
+// marks each wake phase (the CpuPhase values); a watchdog or exception reset
+// records the phase that was running.
+//
+// When BOOT_GUARD_TRIP of the last BOOT_GUARD_WINDOW boots were abnormal,
+// the wake runs degraded: the phase that crashed most recently is skipped,
+// a short fault report goes to {root}/{device}/fault when the MQTT path is
+// still usable, and the wake sleeps for the normal interval doubled per
+// consecutive degraded wake (up to BOOT_GUARD_BACKOFF_MAX_S). A wake that
+// reaches its normal sleep clears the backoff.
+//
+// The gateway's relay loop has its own marker, BOOT_GUARD_PHASE_RELAY: its
+// crashes count towards the window and trigger the fault report, but no
+// phase is skipped, so the degraded gateway still connects and relays.
+//
+// Normal boots pay one 20-byte RTC read and write plus a 4-byte write per
+// phase marker.
+
+#define BOOT_GUARD_MAGIC          0x42475244   // "BGRD"
+#define BOOT_GUARD_WINDOW         8            // boots considered (bits of window)
+#define BOOT_GUARD_TRIP           3            // abnormal boots in the window
+#define BOOT_GUARD_HISTORY        4            // abnormal resets remembered
+#define BOOT_GUARD_BACKOFF_MAX_S  21600        // 6 h
+#define BOOT_GUARD_PHASE_IDLE     0xFF         // marker: wake ended cleanly
+#define BOOT_GUARD_PHASE_RELAY    0xFE         // marker: gateway relay loop running
+
+// rst_info.reason values (ESP8266 SDK user_interface.h)
+#define BOOT_REASON_WDT        1
+#define BOOT_REASON_EXCEPTION  2
+#define BOOT_REASON_SOFT_WDT   3
+#define BOOT_REASON_EXT_SYS    6
+
+struct BootGuardState {
+    uint32_t magic;
+    uint8_t  phase;                        // marker of the wake in progress
+    uint8_t  window;                       // bit 0 = this boot, 1 = abnormal
+    uint8_t  degraded_wakes;               // consecutive, drives the backoff
+    uint8_t  failing_phase;                // phase of the latest abnormal reset
+    uint8_t  reasons[BOOT_GUARD_HISTORY];  // latest abnormal resets, newest at head - 1
+    uint8_t  phases[BOOT_GUARD_HISTORY];
+    uint8_t  head;
+    uint8_t  resets;                       // abnormal resets seen, saturating
+    uint8_t  degraded;                     // this wake runs degraded
+    uint8_t  reserved;
+};
+
+void boot_guard_reset(BootGuardState& s);
+
+bool boot_guard_is_abnormal(uint8_t reason, uint8_t marker);
+// Watchdog and exception resets always; an external reset (reset pin,
+// brownout) only if it interrupted a wake, not the relay loop.
+
+bool boot_guard_on_boot(BootGuardState& s, uint8_t reason);
+// Classifies this boot, shifts the window and records the history.
+// Resets an invalid state first. Returns (and sets) degraded.
+
+uint8_t boot_guard_abnormal_count(const BootGuardState& s);
+
+bool boot_guard_skips(const BootGuardState& s, uint8_t phase);
+// True when degraded and phase is the one that crashed. Never for the
+// relay loop: a relay crash is reported, not skipped.
+
+uint32_t boot_guard_backoff_s(uint32_t normal_s, uint8_t degraded_wakes);
+// normal_s * 2^(degraded_wakes + 1), capped at BOOT_GUARD_BACKOFF_MAX_S
+// (never below normal_s).
+
+size_t boot_guard_format(const BootGuardState& s, char* buf, size_t len);
+// Fault report payload, e.g. "phase=mqtt;resets=3/8;reasons=2,2,3;backoff=2"
+// No Arduino dependencies — unit-tested in the native env.
+
+#ifndef NATIVE_TEST
+
+bool boot_guard_begin();
+// Reads the RTC state, classifies the reset (rst_info.reason) and writes it
+// back. True when this wake runs degraded.
+
+void boot_guard_mark(uint8_t phase);
+// Records the phase now running (a CpuPhase) — only the marker block is written.
+
+bool boot_guard_degraded();
+
+bool boot_guard_skip(uint8_t phase);
+// boot_guard_skips() on this wake's state.
+
+uint32_t boot_guard_sleep_s(uint32_t normal_s);
+// Ends the wake cleanly: returns normal_s, or the backoff when degraded
+// (counting the degraded wake), and clears the marker.
+
+const BootGuardState& boot_guard_state();
+
+#endif // NATIVE_TEST
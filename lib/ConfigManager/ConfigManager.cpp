@@ -1,7 +1,21 @@
-// config_apply_defaults has no Arduino dependencies — compiles on all platforms
+// config_apply_defaults and config_sleep_for_battery have no Arduino
+// dependencies — compile on all platforms
 #include "ConfigManager.h"
+#include <stdio.h>
 #include <string.h>
 
+static void config_default_sensors(Config& cfg) {
+    memset(cfg.sensors, 0, sizeof(cfg.sensors));
+    cfg.sensor_count    = 1;
+    cfg.sensors[0].pin  = 14;  // D5
+    cfg.sensors[0].type = SENSOR_TYPE_DHT11;
+}
+
+static bool sensor_name_ok(const char* name) {
+    // One topic segment; "telemetry" would make telemetry/telemetry/{metric} ambiguous
+    return !strpbrk(name, "/+#") && strcmp(name, "telemetry") != 0;
+}
+
 void config_apply_defaults(Config& cfg) {
     cfg.wifi_reset = false;
     cfg.mqtt_server[0] = '\0';
@@ -10,11 +24,73 @@ void config_apply_defaults(Config& cfg) {
     cfg.mqtt_topic_root[sizeof(cfg.mqtt_topic_root) - 1] = '\0';
     cfg.mqtt_username[0] = '\0';
     cfg.mqtt_password[0] = '\0';
+    cfg.mqtt_transport = MQTT_TRANSPORT_TCP;
+    cfg.mqttsn_port = 10000;
     cfg.sleep_normal_s = 60;
     cfg.sleep_low_battery_s = 300;
     cfg.sleep_critical_battery_s = 86400;
     cfg.battery_low_v = 3.5f;
     cfg.battery_critical_v = 3.40f;
+    cfg.espnow_role = ESPNOW_ROLE_OFF;
+    memset(cfg.espnow_gateway_mac, 0, sizeof(cfg.espnow_gateway_mac));
+    cfg.espnow_channel = 1;
+    cfg.espnow_sensor_count = 0;
+    memset(cfg.espnow_sensors, 0, sizeof(cfg.espnow_sensors));
+    cfg.led_mode = LED_CONFIG_AUTO;
+    cfg.log_dump = LOG_DUMP_OFF;
+    cfg.report_seq = false;
+    config_default_sensors(cfg);
+}
+
+bool config_sensor_pin_ok(uint8_t pin) {
+    return pin < 16 && (SENSOR_PINS_ALLOWED & (1u << pin)) != 0;
+}
+
+uint8_t config_sensor_pin(long value) {
+    return value >= 0 && value < SENSOR_PIN_NONE ? (uint8_t)value : SENSOR_PIN_NONE;
+}
+
+void config_normalize_sensors(Config& cfg) {
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < cfg.sensor_count && i < SENSOR_CHANNELS_MAX; i++) {
+        const SensorChannel& ch = cfg.sensors[i];
+        bool keep = config_sensor_pin_ok(ch.pin) && ch.type <= SENSOR_TYPE_DHT22 &&
+                    sensor_name_ok(ch.name);
+        for (uint8_t j = 0; keep && j < n; j++) {
+            if (cfg.sensors[j].pin == ch.pin ||
+                (ch.name[0] != '\0' && strcmp(cfg.sensors[j].name, ch.name) == 0)) keep = false;
+        }
+        if (keep) cfg.sensors[n++] = ch;
+    }
+    cfg.sensor_count = n;
+    if (n == 0) {
+        config_default_sensors(cfg);
+        return;
+    }
+    if (n == 1) return;
+
+    for (uint8_t i = 0; i < n; i++) {
+        if (cfg.sensors[i].name[0] != '\0') continue;
+        // "ch<N>" numbered by position; bump N past any user-chosen name
+        for (uint8_t k = i; ; k++) {
+            char name[SENSOR_NAME_LEN];
+            snprintf(name, sizeof(name), "ch%u", (unsigned)k);
+            bool taken = false;
+            for (uint8_t j = 0; j < n; j++) {
+                if (strcmp(cfg.sensors[j].name, name) == 0) taken = true;
+            }
+            if (!taken) {
+                memcpy(cfg.sensors[i].name, name, sizeof(name));
+                break;
+            }
+        }
+    }
+}
+
+int config_sleep_for_battery(const Config& cfg, float battery_v) {
+    if (battery_v <= cfg.battery_critical_v) return cfg.sleep_critical_battery_s;
+    if (battery_v <= cfg.battery_low_v)      return cfg.sleep_low_battery_s;
+    return cfg.sleep_normal_s;
 }
 
 #ifndef NATIVE_TEST
@@ -22,31 +98,41 @@ void config_apply_defaults(Config& cfg) {
 #include <Arduino.h>
 #include <LittleFS.h>
 #include <ArduinoJson.h>
+#include "Log.h"
+#include "utils.h"
+
+// One slot per member or element (JSON_OBJECT_SIZE(1) == JSON_ARRAY_SIZE(1))
+#define CONFIG_JSON_CAPACITY (JSON_OBJECT_SIZE(CONFIG_JSON_SLOTS) + CONFIG_JSON_STRINGS)
+
+static const char* const kEspNowRoles[] = { "off", "sensor", "gateway" };
+static const char* const kLedModes[]    = { "auto", "full", "pulse", "off" };
+static const char* const kTransports[]  = { "tcp", "mqttsn" };
+static const char* const kLogDumps[]    = { "off", "serial", "mqtt" };
+static const char* const kSensorTypes[] = { "dht11", "dht22" };
 
 bool config_load(Config& cfg) {
     if (!LittleFS.begin()) {
-        Serial.println("[Config] ERROR: LittleFS mount failed");
+        LOG_E("[Config] ERROR: LittleFS mount failed\n");
         return false;
     }
 
     if (!LittleFS.exists("/config.json")) {
-        Serial.println("[Config] ERROR: /config.json not found");
+        LOG_E("[Config] ERROR: /config.json not found\n");
         return false;
     }
 
     File file = LittleFS.open("/config.json", "r");
     if (!file) {
-        Serial.println("[Config] ERROR: Failed to open /config.json");
+        LOG_E("[Config] ERROR: Failed to open /config.json\n");
         return false;
     }
 
-    StaticJsonDocument<512> doc;
+    DynamicJsonDocument doc(CONFIG_JSON_CAPACITY);  // heap: too big for the loop stack
     DeserializationError err = deserializeJson(doc, file);
     file.close();
 
     if (err) {
-        Serial.print("[Config] ERROR: JSON parse failed: ");
-        Serial.println(err.c_str());
+        LOG_E("[Config] ERROR: JSON parse failed: %s\n", err.c_str());
         return false;
     }
 
@@ -68,6 +154,14 @@ bool config_load(Config& cfg) {
             strlcpy(cfg.mqtt_username, mqtt["username"].as<const char*>(), sizeof(cfg.mqtt_username));
         if (mqtt.containsKey("password"))
             strlcpy(cfg.mqtt_password, mqtt["password"].as<const char*>(), sizeof(cfg.mqtt_password));
+        if (mqtt.containsKey("transport")) {
+            const char* transport = mqtt["transport"].as<const char*>();
+            for (uint8_t i = 0; i < 2; i++) {
+                if (transport && strcmp(transport, kTransports[i]) == 0) cfg.mqtt_transport = i;
+            }
+        }
+        if (mqtt.containsKey("sn_port"))
+            cfg.mqttsn_port = mqtt["sn_port"].as<int>();
     }
 
     if (doc.containsKey("sleep")) {
@@ -88,23 +182,104 @@ bool config_load(Config& cfg) {
             cfg.battery_critical_v = battery["critical_v"].as<float>();
     }
 
+    if (doc.containsKey("espnow")) {
+        JsonObject espnow = doc["espnow"];
+        if (espnow.containsKey("role")) {
+            const char* role = espnow["role"].as<const char*>();
+            for (uint8_t i = 0; i < 3; i++) {
+                if (role && strcmp(role, kEspNowRoles[i]) == 0) cfg.espnow_role = i;
+            }
+        }
+        if (espnow.containsKey("gateway_mac") &&
+            !parse_mac(espnow["gateway_mac"].as<const char*>(), cfg.espnow_gateway_mac)) {
+            LOG_W("[Config] WARNING: espnow.gateway_mac invalid, ignored\n");
+        }
+        if (espnow.containsKey("channel"))
+            cfg.espnow_channel = espnow["channel"].as<int>();
+        for (const char* mac : espnow["sensors"].as<JsonArray>()) {
+            if (cfg.espnow_sensor_count == ESPNOW_SENSORS_MAX) {
+                LOG_W("[Config] WARNING: more than %d espnow.sensors, extra ignored\n",
+                      ESPNOW_SENSORS_MAX);
+                break;
+            }
+            if (!parse_mac(mac, cfg.espnow_sensors[cfg.espnow_sensor_count])) {
+                LOG_W("[Config] WARNING: espnow.sensors entry invalid, ignored\n");
+                continue;
+            }
+            cfg.espnow_sensor_count++;
+        }
+    }
+
+    if (doc.containsKey("led") && doc["led"].containsKey("mode")) {
+        const char* mode = doc["led"]["mode"].as<const char*>();
+        for (uint8_t i = 0; i < 4; i++) {
+            if (mode && strcmp(mode, kLedModes[i]) == 0) cfg.led_mode = i;
+        }
+    }
+
+    if (doc.containsKey("log") && doc["log"].containsKey("dump")) {
+        const char* dump = doc["log"]["dump"].as<const char*>();
+        for (uint8_t i = 0; i < 3; i++) {
+            if (dump && strcmp(dump, kLogDumps[i]) == 0) cfg.log_dump = i;
+        }
+    }
+
+    if (doc.containsKey("report") && doc["report"].containsKey("seq"))
+        cfg.report_seq = doc["report"]["seq"].as<bool>();
+
+    if (doc.containsKey("sensors")) {
+        JsonArray sensors = doc["sensors"].as<JsonArray>();
+        cfg.sensor_count = 0;
+        for (JsonObject s : sensors) {
+            if (cfg.sensor_count == SENSOR_CHANNELS_MAX) {
+                LOG_W("[Config] WARNING: more than %d sensors, extra ignored\n", SENSOR_CHANNELS_MAX);
+                break;
+            }
+            SensorChannel& ch = cfg.sensors[cfg.sensor_count++];
+            memset(&ch, 0, sizeof(ch));
+            strlcpy(ch.name, s["name"] | "", sizeof(ch.name));
+            ch.pin = config_sensor_pin(s["pin"] | -1L);
+            const char* type = s["type"] | "dht11";
+            ch.type = 255;
+            for (uint8_t i = 0; i < 2; i++) {
+                if (strcmp(type, kSensorTypes[i]) == 0) ch.type = i;
+            }
+        }
+        uint8_t configured = cfg.sensor_count;
+        config_normalize_sensors(cfg);
+        if (cfg.sensor_count != configured) {
+            LOG_W("[Config] WARNING: invalid or duplicate sensors entries ignored\n");
+        }
+    }
+
     // Print loaded values (mask password)
-    Serial.println("[Config] Loaded config:");
-    Serial.print("  wifi.reset: ");          Serial.println(cfg.wifi_reset);
-    Serial.print("  mqtt.server: ");         Serial.println(cfg.mqtt_server);
-    Serial.print("  mqtt.port: ");           Serial.println(cfg.mqtt_port);
-    Serial.print("  mqtt.topic_root: ");     Serial.println(cfg.mqtt_topic_root);
-    Serial.print("  mqtt.username: ");       Serial.println(cfg.mqtt_username);
-    Serial.print("  mqtt.password: ");
-    Serial.println(cfg.mqtt_password[0] != '\0' ? "(set)" : "(empty)");
-    Serial.print("  sleep.normal_s: ");      Serial.println(cfg.sleep_normal_s);
-    Serial.print("  sleep.low_battery_s: "); Serial.println(cfg.sleep_low_battery_s);
-    Serial.print("  sleep.critical_battery_s: "); Serial.println(cfg.sleep_critical_battery_s);
-    Serial.print("  battery.low_v: ");       Serial.println(cfg.battery_low_v, 2);
-    Serial.print("  battery.critical_v: ");  Serial.println(cfg.battery_critical_v, 2);
+    LOG_D("[Config] Loaded config:\n");
+    LOG_D("  wifi.reset: %d\n",               cfg.wifi_reset);
+    LOG_D("  mqtt.server: %s\n",              cfg.mqtt_server);
+    LOG_D("  mqtt.port: %d\n",                cfg.mqtt_port);
+    LOG_D("  mqtt.topic_root: %s\n",          cfg.mqtt_topic_root);
+    LOG_D("  mqtt.username: %s\n",            cfg.mqtt_username);
+    LOG_D("  mqtt.password: %s\n",            cfg.mqtt_password[0] != '\0' ? "(set)" : "(empty)");
+    LOG_D("  mqtt.transport: %s\n",           kTransports[cfg.mqtt_transport]);
+    LOG_D("  mqtt.sn_port: %d\n",             cfg.mqttsn_port);
+    LOG_D("  sleep.normal_s: %d\n",           cfg.sleep_normal_s);
+    LOG_D("  sleep.low_battery_s: %d\n",      cfg.sleep_low_battery_s);
+    LOG_D("  sleep.critical_battery_s: %d\n", cfg.sleep_critical_battery_s);
+    LOG_D("  battery.low_v: %.2f\n",          cfg.battery_low_v);
+    LOG_D("  battery.critical_v: %.2f\n",     cfg.battery_critical_v);
+    LOG_D("  espnow.role: %s\n",              kEspNowRoles[cfg.espnow_role]);
+    LOG_D("  espnow.channel: %d\n",           cfg.espnow_channel);
+    LOG_D("  espnow.sensors: %u\n",           cfg.espnow_sensor_count);
+    LOG_D("  led.mode: %s\n",                 kLedModes[cfg.led_mode]);
+    LOG_D("  log.dump: %s\n",                 kLogDumps[cfg.log_dump]);
+    LOG_D("  report.seq: %d\n",               cfg.report_seq);
+    for (uint8_t i = 0; i < cfg.sensor_count; i++) {
+        LOG_D("  sensors[%u]: \"%s\" GPIO%u %s\n", i, cfg.sensors[i].name,
+              cfg.sensors[i].pin, kSensorTypes[cfg.sensors[i].type]);
+    }
 
     if (cfg.sleep_normal_s > 4294) {
-        Serial.println("[Config] WARNING: sleep.normal_s exceeds ESP8266 hardware limit (~4294s); device will wake earlier than configured");
+        LOG_W("[Config] WARNING: sleep.normal_s exceeds ESP8266 hardware limit (~4294s); device will wake earlier than configured\n");
     }
 
     return true;
@@ -113,7 +288,7 @@ bool config_load(Config& cfg) {
 void config_save(const Config& cfg) {
     LittleFS.begin();  // safe to call if already mounted
 
-    StaticJsonDocument<512> doc;
+    DynamicJsonDocument doc(CONFIG_JSON_CAPACITY);
 
     doc["wifi"]["reset"] = cfg.wifi_reset;
     doc["mqtt"]["server"] = cfg.mqtt_server;
@@ -121,22 +296,45 @@ void config_save(const Config& cfg) {
     doc["mqtt"]["topic_root"] = cfg.mqtt_topic_root;
     doc["mqtt"]["username"] = cfg.mqtt_username;
     doc["mqtt"]["password"] = cfg.mqtt_password;
+    doc["mqtt"]["transport"] = kTransports[cfg.mqtt_transport];
+    doc["mqtt"]["sn_port"] = cfg.mqttsn_port;
     doc["sleep"]["normal_s"] = cfg.sleep_normal_s;
     doc["sleep"]["low_battery_s"] = cfg.sleep_low_battery_s;
     doc["sleep"]["critical_battery_s"] = cfg.sleep_critical_battery_s;
     doc["battery"]["low_v"] = cfg.battery_low_v;
     doc["battery"]["critical_v"] = cfg.battery_critical_v;
 
+    char mac_buf[18];
+    format_mac(cfg.espnow_gateway_mac, mac_buf, sizeof(mac_buf));
+    doc["espnow"]["role"] = kEspNowRoles[cfg.espnow_role];
+    doc["espnow"]["gateway_mac"] = mac_buf;
+    doc["espnow"]["channel"] = cfg.espnow_channel;
+    JsonArray espnow_sensors = doc["espnow"].createNestedArray("sensors");
+    for (uint8_t i = 0; i < cfg.espnow_sensor_count; i++) {
+        format_mac(cfg.espnow_sensors[i], mac_buf, sizeof(mac_buf));
+        espnow_sensors.add(mac_buf);  // copied: mac_buf is reused
+    }
+    doc["led"]["mode"] = kLedModes[cfg.led_mode];
+    doc["log"]["dump"] = kLogDumps[cfg.log_dump];
+    doc["report"]["seq"] = cfg.report_seq;
+    JsonArray sensors = doc.createNestedArray("sensors");
+    for (uint8_t i = 0; i < cfg.sensor_count; i++) {
+        JsonObject s = sensors.createNestedObject();
+        s["name"] = cfg.sensors[i].name;
+        s["pin"]  = cfg.sensors[i].pin;
+        s["type"] = kSensorTypes[cfg.sensors[i].type];
+    }
+
     File file = LittleFS.open("/config.json", "w");
     if (!file) {
-        Serial.println("[Config] ERROR: Failed to open /config.json for writing");
+        LOG_E("[Config] ERROR: Failed to open /config.json for writing\n");
         return;
     }
 
     serializeJson(doc, file);
     file.close();
 
-    Serial.println("[Config] Config saved");
+    LOG_I("[Config] Config saved\n");
 }
 
 #endif // NATIVE_TEST
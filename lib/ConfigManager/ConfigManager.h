@@ -1,6 +1,62 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
+
+enum EspNowRole {
+    ESPNOW_ROLE_OFF     = 0,  // publish over WiFi + MQTT (default)
+    ESPNOW_ROLE_SENSOR  = 1,  // send readings to the gateway over ESP-NOW
+    ESPNOW_ROLE_GATEWAY = 2   // mains-powered: relay ESP-NOW frames to MQTT
+};
+
+#define ESPNOW_SENSORS_MAX 8   // gateway allow-list entries
+
+enum LedConfigMode {
+    LED_CONFIG_AUTO  = 0,  // full, pulse on BAT_LOW, off on BAT_CRIT (default)
+    LED_CONFIG_FULL  = 1,
+    LED_CONFIG_PULSE = 2,
+    LED_CONFIG_OFF   = 3
+};
+
+enum MqttTransport {
+    MQTT_TRANSPORT_TCP    = 0,  // MQTT 3.1.1 over TCP (default)
+    MQTT_TRANSPORT_MQTTSN = 1   // MQTT-SN over UDP to a gateway at mqtt.server
+};
+
+enum LogDumpMode {
+    LOG_DUMP_OFF    = 0,  // events stay in the RTC ring (default)
+    LOG_DUMP_SERIAL = 1,  // print the ring at boot
+    LOG_DUMP_MQTT   = 2   // publish unsent events to {root}/{device}/log
+};
+
+enum SensorType {
+    SENSOR_TYPE_DHT11 = 0,  // default
+    SENSOR_TYPE_DHT22 = 1
+};
+
+#define SENSOR_CHANNELS_MAX 4
+#define SENSOR_NAME_LEN     16
+// GPIOs a DHT data line may use: free and with a pin-change interrupt.
+// Not 1/3 (Serial), 6-11 (SPI flash) or 16 (no interrupt, deep sleep wake).
+#define SENSOR_PINS_ALLOWED ((1u << 0) | (1u << 2) | (1u << 4) | (1u << 5) | \
+                             (1u << 12) | (1u << 13) | (1u << 14) | (1u << 15))
+#define SENSOR_PIN_NONE     255
+
+// Worst-case /config.json, for sizing the ArduinoJson document: every key
+// present, every string at its buffer's maximum length (deserialisation
+// copies keys and values). Fixed part: 29 object members, 225 bytes of key
+// names, 302 of values (4 x 64-byte mqtt strings, the longest enum names,
+// gateway_mac). Each espnow.sensors entry: 1 element + an 18-byte MAC.
+// Each sensors entry: 1 element + 3 members, 14 bytes of keys, a
+// SENSOR_NAME_LEN name and "dht11".
+#define CONFIG_JSON_SLOTS   (29 + ESPNOW_SENSORS_MAX + 4 * SENSOR_CHANNELS_MAX)
+#define CONFIG_JSON_STRINGS (527 + 18 * ESPNOW_SENSORS_MAX + (20 + SENSOR_NAME_LEN) * SENSOR_CHANNELS_MAX)
+
+struct SensorChannel {
+    char    name[SENSOR_NAME_LEN];  // telemetry sub-topic, "" = telemetry/{metric}
+    uint8_t pin;
+    uint8_t type;                   // SensorType
+};
 
 struct Config {
     bool wifi_reset;
@@ -9,11 +65,23 @@ struct Config {
     char mqtt_topic_root[64];
     char mqtt_username[64];
     char mqtt_password[64];
+    uint8_t mqtt_transport;        // MqttTransport
+    int mqttsn_port;
     int sleep_normal_s;
     int sleep_low_battery_s;
     int sleep_critical_battery_s;
     float battery_low_v;
     float battery_critical_v;
+    uint8_t espnow_role;           // EspNowRole
+    uint8_t espnow_gateway_mac[6];
+    int espnow_channel;
+    uint8_t espnow_sensor_count;   // gateway: senders accepted, 0 = none
+    uint8_t espnow_sensors[ESPNOW_SENSORS_MAX][6];
+    uint8_t led_mode;              // LedConfigMode
+    uint8_t log_dump;              // LogDumpMode
+    bool report_seq;               // sequence suffix on status (SeqCounter.h)
+    uint8_t sensor_count;          // 1..SENSOR_CHANNELS_MAX
+    SensorChannel sensors[SENSOR_CHANNELS_MAX];
 };
 
 bool config_load(Config& cfg);
@@ -26,6 +94,13 @@ bool config_load(Config& cfg);
 void config_save(const Config& cfg);
 // Writes complete config.json to LittleFS at /config.json using ArduinoJson.
 
+int config_sleep_for_battery(const Config& cfg, float battery_v);
+// Battery Conservation table, first match wins:
+//   battery_v <= battery_critical_v -> sleep_critical_battery_s
+//   battery_v <= battery_low_v      -> sleep_low_battery_s
+//   otherwise                       -> sleep_normal_s
+// No Arduino dependencies — shared with the native policy simulator.
+
 void config_apply_defaults(Config& cfg);
 // Unconditionally sets ALL fields to their hardcoded defaults.
 // Called by config_load before JSON parsing so JSON values overwrite defaults.
@@ -36,8 +111,31 @@ void config_apply_defaults(Config& cfg);
 //   mqtt_topic_root        = "devices"
 //   mqtt_username          = "" (empty)
 //   mqtt_password          = "" (empty)
+//   mqtt_transport         = MQTT_TRANSPORT_TCP
+//   mqttsn_port            = 10000
 //   sleep_normal_s         = 60
 //   sleep_low_battery_s    = 300
 //   sleep_critical_battery_s = 86400
 //   battery_low_v          = 3.5f
 //   battery_critical_v     = 3.40f
+//   espnow_role            = ESPNOW_ROLE_OFF
+//   espnow_gateway_mac     = 00:00:00:00:00:00
+//   espnow_channel         = 1
+//   espnow_sensors         = (empty — a gateway relays nothing until listed)
+//   led_mode               = LED_CONFIG_AUTO
+//   log_dump               = LOG_DUMP_OFF
+//   report_seq             = false
+//   sensors                = one unnamed DHT11 on GPIO14 (D5)
+
+bool config_sensor_pin_ok(uint8_t pin);
+// True if pin is in SENSOR_PINS_ALLOWED.
+
+uint8_t config_sensor_pin(long value);
+// A sensors[].pin value from JSON as a GPIO number; SENSOR_PIN_NONE if it
+// does not fit in a uint8_t (negative, or would wrap onto a valid pin).
+
+void config_normalize_sensors(Config& cfg);
+// Drops channels with an unknown type, a pin not in SENSOR_PINS_ALLOWED or
+// already used, or a name that is not a single topic segment ('/', '+', '#'), is
+// "telemetry" or clashes with another channel. With more than one channel left, unnamed ones become "ch<N>" so
+// every channel has its own sub-topic. No channels left restores the default.
@@ -0,0 +1,61 @@
+// Phase table and accounting have no Arduino dependencies — compiled on all
+// platforms; the clock switching is device-only.
+#include "CpuPolicy.h"
+
+static const char* const kPhaseNames[CPU_PHASE_COUNT] = {
+    "boot", "config", "wifi", "sensor", "mqtt", "encode", "portal"
+};
+
+uint8_t cpu_phase_mhz(CpuPhase phase) {
+#ifdef CPU_POLICY_FIXED_MHZ
+    (void)phase;
+    return CPU_POLICY_FIXED_MHZ;
+#else
+    return (phase == CPU_PHASE_CONFIG || phase == CPU_PHASE_ENCODE) ? 160 : 80;
+#endif
+}
+
+const char* cpu_phase_name(CpuPhase phase) {
+    return phase < CPU_PHASE_COUNT ? kPhaseNames[phase] : "?";
+}
+
+void cpu_phase_log_switch(CpuPhaseLog& log, CpuPhase next, uint32_t now_us) {
+    CpuPhase prev = (CpuPhase)log.current;
+    log.us[prev] += now_us - log.since_us;
+    if (cpu_phase_mhz(prev) != cpu_phase_mhz(next)) log.switches++;
+    log.current  = (uint8_t)next;
+    log.since_us = now_us;
+}
+
+#ifndef NATIVE_TEST
+
+#include <Arduino.h>
+#include <user_interface.h>
+#include "Log.h"
+
+// Zero-initialised: BOOT is current from t=0 (system_get_time() starts at reset)
+static CpuPhaseLog phase_log;
+
+void cpu_phase_begin(CpuPhase phase) {
+    cpu_phase_log_switch(phase_log, phase, system_get_time());
+    uint8_t mhz = cpu_phase_mhz(phase);
+    if (system_get_cpu_freq() != mhz) system_update_cpu_freq(mhz);
+}
+
+void cpu_phase_report() {
+    cpu_phase_log_switch(phase_log, (CpuPhase)phase_log.current, system_get_time());
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+    uint32_t total = 0;
+    LOG_I("[CPU]");
+    for (uint8_t i = 0; i < CPU_PHASE_COUNT; i++) {
+        if (phase_log.us[i] == 0) continue;
+        total += phase_log.us[i];
+        LOG_I(" %s@%u=%lums", kPhaseNames[i], cpu_phase_mhz((CpuPhase)i),
+              (unsigned long)(phase_log.us[i] / 1000));
+    }
+    LOG_I(" | awake %lums, %u clock switches\n",
+          (unsigned long)(total / 1000), phase_log.switches);
+#endif
+}
+
+#endif // NATIVE_TEST
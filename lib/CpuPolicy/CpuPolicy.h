@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdint.h>
+
+// Wake-cycle CPU frequency policy. main.cpp announces each phase; the
+// policy clocks the CPU at 80 MHz while waiting on I/O and at 160 MHz for
+// CPU-bound work, and records how long each phase took.
+//
+// Build with -D CPU_POLICY_FIXED_MHZ=80 (or 160) to pin the clock and
+// compare per-phase timings against the adaptive policy.
+
+enum CpuPhase {
+    CPU_PHASE_BOOT,          // reset until the first cpu_phase_begin()
+    CPU_PHASE_CONFIG,        // LittleFS mount + JSON parse         (compute)
+    CPU_PHASE_WIFI_WAIT,     // association / DHCP polling          (I/O)
+    CPU_PHASE_SENSOR,        // DHT reads and 1s gaps               (I/O)
+    CPU_PHASE_MQTT_WAIT,     // TCP connect + CONNACK               (I/O)
+    CPU_PHASE_ENCODE,        // payload formatting + publish burst  (compute)
+    CPU_PHASE_PORTAL,        // captive portal loop                 (I/O)
+    CPU_PHASE_COUNT
+};
+
+struct CpuPhaseLog {
+    uint32_t us[CPU_PHASE_COUNT];  // accumulated time per phase
+    uint8_t  current;              // CpuPhase
+    uint32_t since_us;             // when current began
+    uint8_t  switches;             // frequency changes issued
+};
+
+uint8_t cpu_phase_mhz(CpuPhase phase);
+// 160 for CONFIG and ENCODE, 80 otherwise (or CPU_POLICY_FIXED_MHZ).
+
+const char* cpu_phase_name(CpuPhase phase);
+
+void cpu_phase_log_switch(CpuPhaseLog& log, CpuPhase next, uint32_t now_us);
+// Credits now_us - since_us to the current phase and makes next current.
+// Counts a switch when the target frequency differs.
+// No Arduino dependencies — unit-tested in the native env.
+
+#ifndef NATIVE_TEST
+
+void cpu_phase_begin(CpuPhase phase);
+// Ends the running phase and sets the CPU clock for the new one.
+
+void cpu_phase_report();
+// Closes the running phase and prints per-phase time and clock to Serial
+// (LOG_LEVEL INFO and above).
+
+#endif // NATIVE_TEST
@@ -0,0 +1,161 @@
+// dht_decode_edges has no Arduino dependencies — compiles on all platforms
+#include "DhtAsync.h"
+#include <string.h>
+
+#define DHT_FRAME_BITS 40
+
+static const char* const kErrorNames[] = {
+    "OK", "no response", "too few edges", "bad pulse", "checksum"
+};
+
+const char* dht_error_str(uint8_t error) {
+    return (error <= DHT_ERR_CHECKSUM) ? kErrorNames[error] : "?";
+}
+
+uint32_t dht_min_interval_ms(uint8_t type) {
+    return (type == DHT_TYPE_22) ? 2000 : 1000;
+}
+
+static bool pulse_ok(uint32_t us) {
+    return us >= DHT_PULSE_MIN_US && us <= DHT_PULSE_MAX_US;
+}
+
+void dht_decode_edges(const uint32_t* t_us, const uint8_t* level, size_t count,
+                      uint8_t type, DhtReading& out) {
+    memset(&out, 0, sizeof(out));
+    out.edges = (uint8_t)(count > 255 ? 255 : count);
+    if (count == 0) {
+        out.error = DHT_ERR_NO_RESPONSE;
+        return;
+    }
+
+    // Complete high pulses (rising edge followed by falling edge) and the
+    // low pulse that preceded each, 0 when that low was not captured.
+    uint32_t high_us[DHT_MAX_EDGES];
+    uint32_t low_us[DHT_MAX_EDGES];
+    size_t   highs = 0;
+    for (size_t k = 0; k + 1 < count && highs < DHT_MAX_EDGES; k++) {
+        if (level[k] != 1 || level[k + 1] != 0) continue;
+        high_us[highs] = t_us[k + 1] - t_us[k];
+        low_us[highs]  = (k > 0 && level[k - 1] == 0) ? t_us[k] - t_us[k - 1] : 0;
+        highs++;
+    }
+    if (highs < DHT_FRAME_BITS) {
+        out.error = DHT_ERR_TOO_FEW_EDGES;
+        return;
+    }
+
+    uint8_t bytes[5] = { 0 };
+    size_t first = highs - DHT_FRAME_BITS;
+    for (size_t b = 0; b < DHT_FRAME_BITS; b++) {
+        uint32_t hi = high_us[first + b];
+        uint32_t lo = low_us[first + b];
+        if (!pulse_ok(hi) || (lo != 0 && !pulse_ok(lo))) {
+            out.error = DHT_ERR_BAD_PULSE;
+            return;
+        }
+        bytes[b / 8] = (uint8_t)((bytes[b / 8] << 1) | (hi >= DHT_BIT_ONE_MIN_US ? 1 : 0));
+    }
+    memcpy(out.bytes, bytes, sizeof(bytes));
+
+    if ((uint8_t)(bytes[0] + bytes[1] + bytes[2] + bytes[3]) != bytes[4]) {
+        out.error = DHT_ERR_CHECKSUM;
+        return;
+    }
+
+    if (type == DHT_TYPE_22) {
+        out.hum  = (float)((bytes[0] << 8) | bytes[1]) * 0.1f;
+        out.temp = (float)(((bytes[2] & 0x7F) << 8) | bytes[3]) * 0.1f;
+        if (bytes[2] & 0x80) out.temp = -out.temp;
+    } else {
+        out.hum  = (float)bytes[0] + (float)bytes[1] * 0.1f;
+        out.temp = (float)bytes[2] + (float)(bytes[3] & 0x7F) * 0.1f;
+        if (bytes[3] & 0x80) out.temp = -out.temp;
+    }
+    out.error = DHT_OK;
+}
+
+#ifndef NATIVE_TEST
+
+#include <Arduino.h>
+
+// Start pulse length: DHT11 needs >= 18 ms low, DHT22 >= 1 ms
+#define DHT11_START_MS 20
+#define DHT22_START_MS 2
+
+static void IRAM_ATTR dht_isr(void* arg) {
+    DhtAsync* d = static_cast<DhtAsync*>(arg);
+    uint8_t n = d->edge_count;
+    if (n >= DHT_MAX_EDGES) return;
+    d->edge_us[n]    = micros();
+    d->edge_level[n] = (uint8_t)digitalRead(d->pin);
+    d->edge_count    = n + 1;
+}
+
+static void dht_finish(void* arg) {
+    DhtAsync* d = static_cast<DhtAsync*>(arg);
+    detachInterrupt(d->pin);
+
+    uint32_t t[DHT_MAX_EDGES];
+    uint8_t  lv[DHT_MAX_EDGES];
+    size_t   n = d->edge_count;
+    for (size_t i = 0; i < n; i++) {
+        t[i]  = d->edge_us[i];
+        lv[i] = d->edge_level[i];
+    }
+    dht_decode_edges(t, lv, n, d->type, d->result);
+    d->state = DHT_ASYNC_DONE;
+    if (d->on_done) d->on_done(d->ctx, d->result);
+}
+
+static void dht_release(void* arg) {
+    DhtAsync* d = static_cast<DhtAsync*>(arg);
+    d->edge_count = 0;
+    d->state      = DHT_ASYNC_CAPTURE;
+    attachInterruptArg(d->pin, dht_isr, d, CHANGE);
+    pinMode(d->pin, INPUT_PULLUP);  // release; the rising edge is captured too
+    os_timer_setfn(&d->timer, dht_finish, d);
+    os_timer_arm(&d->timer, DHT_CAPTURE_MS, false);
+}
+
+void dht_async_begin(DhtAsync& d, uint8_t pin, uint8_t type, bool power_up) {
+    memset(&d, 0, sizeof(d));
+    d.pin   = pin;
+    d.type  = type;
+    d.state = DHT_ASYNC_IDLE;
+    // As if the last conversion were one interval ago, unless just powered
+    d.started_ms = millis() - (power_up ? 0 : dht_min_interval_ms(type));
+    pinMode(pin, INPUT_PULLUP);
+}
+
+bool dht_async_start(DhtAsync& d, DhtDoneFn on_done, void* ctx) {
+    if (d.state != DHT_ASYNC_IDLE) return false;
+    d.on_done    = on_done;
+    d.ctx        = ctx;
+    d.started_ms = millis();
+    d.state      = DHT_ASYNC_START;
+    digitalWrite(d.pin, LOW);
+    pinMode(d.pin, OUTPUT);
+    os_timer_disarm(&d.timer);
+    os_timer_setfn(&d.timer, dht_release, &d);
+    os_timer_arm(&d.timer, (d.type == DHT_TYPE_22) ? DHT22_START_MS : DHT11_START_MS, false);
+    return true;
+}
+
+uint32_t dht_async_wait_ms(const DhtAsync& d) {
+    uint32_t elapsed = millis() - d.started_ms;
+    uint32_t min_ms  = dht_min_interval_ms(d.type);
+    return (elapsed >= min_ms) ? 0 : min_ms - elapsed;
+}
+
+bool dht_async_done(const DhtAsync& d) {
+    return d.state == DHT_ASYNC_DONE;
+}
+
+DhtReading dht_async_take(DhtAsync& d) {
+    DhtReading r = d.result;
+    d.state = DHT_ASYNC_IDLE;
+    return r;
+}
+
+#endif // NATIVE_TEST
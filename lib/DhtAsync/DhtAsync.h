@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Interrupt-captured DHT11/DHT22 driver. The start pulse and the capture
+// window run on SDK timers, and a CHANGE interrupt timestamps every edge of
+// the sensor's reply. Interrupts stay enabled throughout, so the WiFi stack
+// keeps running. The 40-bit frame is decoded from the timestamps once the
+// window closes.
+//
+// Frame on the wire, after the host releases the line:
+//   80us low, 80us high (response), then 40 x { 50us low, 26-28us high = 0 / 70us high = 1 }
+// The bits are the last 40 complete high pulses; the final release has no
+// closing edge and is not counted.
+
+#define DHT_TYPE_11           11
+#define DHT_TYPE_22           22
+#define DHT_MAX_EDGES         96    // 84 expected incl. release and response
+#define DHT_BIT_ONE_MIN_US    48    // high pulse threshold between 0 and 1
+#define DHT_PULSE_MIN_US      10
+#define DHT_PULSE_MAX_US      110
+#define DHT_CAPTURE_MS        8     // frame takes ~5 ms after release
+
+enum DhtError {
+    DHT_OK = 0,
+    DHT_ERR_NO_RESPONSE,     // no edges at all: sensor missing or unpowered
+    DHT_ERR_TOO_FEW_EDGES,   // truncated frame (missed edges, late start)
+    DHT_ERR_BAD_PULSE,       // a bit pulse outside DHT_PULSE_MIN/MAX_US
+    DHT_ERR_CHECKSUM         // 40 bits decoded, checksum byte mismatch
+};
+
+struct DhtReading {
+    uint8_t error;      // DhtError
+    uint8_t edges;      // edges captured, for diagnostics
+    uint8_t bytes[5];   // raw frame, valid for DHT_OK and DHT_ERR_CHECKSUM
+    float   temp;       // °C, valid when error == DHT_OK
+    float   hum;        // %RH, valid when error == DHT_OK
+};
+
+const char* dht_error_str(uint8_t error);
+
+uint32_t dht_min_interval_ms(uint8_t type);
+// Minimum time between conversions: 1000 ms (DHT11), 2000 ms (DHT22).
+
+void dht_decode_edges(const uint32_t* t_us, const uint8_t* level, size_t count,
+                      uint8_t type, DhtReading& out);
+// t_us[i] is when edge i happened, level[i] the line level after it.
+// Fills out.error and, on DHT_OK, temp and hum for the given sensor type.
+// No Arduino dependencies — unit-tested in the native env with recorded edges.
+
+#ifndef NATIVE_TEST
+
+#include <user_interface.h>
+
+enum DhtAsyncState {
+    DHT_ASYNC_IDLE,
+    DHT_ASYNC_START,     // host holding the line low
+    DHT_ASYNC_CAPTURE,   // interrupt armed, sensor replying
+    DHT_ASYNC_DONE       // result ready, not yet taken
+};
+
+typedef void (*DhtDoneFn)(void* ctx, const DhtReading& reading);
+
+// One per sensor pin; several can run concurrently.
+struct DhtAsync {
+    uint8_t           pin;
+    uint8_t           type;
+    volatile uint8_t  state;      // DhtAsyncState
+    volatile uint8_t  edge_count;
+    volatile uint32_t edge_us[DHT_MAX_EDGES];
+    volatile uint8_t  edge_level[DHT_MAX_EDGES];
+    uint32_t          started_ms;  // last dht_async_start(); settle reference before the first
+    os_timer_t        timer;
+    DhtDoneFn         on_done;
+    void*             ctx;
+    DhtReading        result;
+};
+
+void dht_async_begin(DhtAsync& d, uint8_t pin, uint8_t type, bool power_up = false);
+// The sensor stays powered through deep sleep, so the first conversion may
+// start at once. power_up = the sensor has only just been powered (power-on
+// reset): the first conversion waits dht_min_interval_ms() for it to settle.
+
+bool dht_async_start(DhtAsync& d, DhtDoneFn on_done = nullptr, void* ctx = nullptr);
+// Begins a conversion and returns immediately. False if one is already
+// running or a result has not been taken. on_done runs in SDK timer (task)
+// context when the result is ready.
+
+uint32_t dht_async_wait_ms(const DhtAsync& d);
+// Time left before the sensor accepts another start (0 = now): the minimum
+// interval since the previous conversion, or the power-up settle time.
+
+bool dht_async_done(const DhtAsync& d);
+// Poll flag: true once a result is ready.
+
+DhtReading dht_async_take(DhtAsync& d);
+// Returns the result and makes the driver idle again.
+
+#endif // NATIVE_TEST
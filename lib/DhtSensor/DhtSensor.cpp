@@ -1,30 +1,93 @@
 #include "DhtSensor.h"
 #include <Arduino.h>
-#include <math.h>
-
-bool dht_read_average(DHT& dht, int num_reads, float& temp_out, float& hum_out) {
-    float temp_sum = 0.0f;
-    float hum_sum = 0.0f;
-    int valid_count = 0;
-
-    for (int i = 0; i < num_reads; i++) {
-        float t = dht.readTemperature();
-        float h = dht.readHumidity();
-        if (!isnan(t) && !isnan(h)) {
-            temp_sum += t;
-            hum_sum += h;
-            valid_count++;
-            Serial.printf("[DHT] Read %d/%d: %.1fC %.1f%%\n", i + 1, num_reads, t, h);
-        } else {
-            Serial.printf("[DHT] Read %d/%d: failed (NaN)\n", i + 1, num_reads);
-        }
-        if (i < num_reads - 1) delay(1000);  // 1s minimum DHT11 sampling interval
+#include <string.h>
+#include "PowerWait.h"
+#include "Log.h"
+
+static bool dht_on_wire(const DhtAsync* dht, size_t count) {
+    for (size_t c = 0; c < count; c++) {
+        if (dht[c].state == DHT_ASYNC_START || dht[c].state == DHT_ASYNC_CAPTURE) return true;
+    }
+    return false;
+}
+
+static bool dht_any_busy(const DhtAsync* dht, size_t count) {
+    for (size_t c = 0; c < count; c++) {
+        if (dht[c].state != DHT_ASYNC_IDLE) return true;
+    }
+    return false;
+}
+
+// Until the next thing the read loop acts on: 1 ms while a conversion is
+// on the wire or a result waits, else the shortest settle time of a
+// channel that still has reads to take.
+static uint32_t dht_next_event_ms(const DhtAsync* dht, size_t count, const int* taken,
+                                  int num_reads) {
+    uint32_t next = 0xFFFFFFFF;
+    for (size_t c = 0; c < count; c++) {
+        if (dht[c].state != DHT_ASYNC_IDLE) return 1;
+        if (taken[c] >= num_reads) continue;
+        uint32_t wait = dht_async_wait_ms(dht[c]);
+        if (wait < next) next = wait;
+    }
+    return (next == 0 || next == 0xFFFFFFFF) ? 1 : next;
+}
+
+bool dht_kick_channels(DhtAsync* dht, size_t count) {
+    if (dht_on_wire(dht, count)) return false;
+    for (size_t c = 0; c < count; c++) {
+        if (dht[c].state == DHT_ASYNC_IDLE && dht_async_wait_ms(dht[c]) == 0)
+            return dht_async_start(dht[c]);
     }
+    return false;
+}
 
-    if (valid_count == 0) return false;
+size_t dht_read_channels(DhtAsync* dht, size_t count, int num_reads, DhtAverage* out) {
+    int   taken[SENSOR_CHANNELS_MAX]    = { 0 };
+    float temp_sum[SENSOR_CHANNELS_MAX] = { 0 };
+    float hum_sum[SENSOR_CHANNELS_MAX]  = { 0 };
+    if (count > SENSOR_CHANNELS_MAX) count = SENSOR_CHANNELS_MAX;
+    memset(out, 0, count * sizeof(*out));
 
-    temp_out = temp_sum / valid_count;
-    hum_out = hum_sum / valid_count;
-    Serial.printf("[DHT] Average: %.1fC %.1f%%\n", temp_out, hum_out);
-    return true;
+    for (size_t pending = count * (size_t)num_reads; pending > 0; ) {
+        for (size_t c = 0; c < count; c++) {
+            DhtAsync& d = dht[c];
+            if (d.state == DHT_ASYNC_IDLE && taken[c] < num_reads &&
+                dht_async_wait_ms(d) == 0 && !dht_on_wire(dht, count)) {
+                dht_async_start(d);
+            }
+            if (!dht_async_done(d)) continue;
+
+            DhtReading r = dht_async_take(d);
+            taken[c]++;
+            pending--;
+            if (r.error == DHT_OK) {
+                temp_sum[c] += r.temp;
+                hum_sum[c]  += r.hum;
+                out[c].valid++;
+                LOG_D("[DHT] GPIO%u read %d/%d: %.1fC %.1f%%\n", d.pin, taken[c], num_reads,
+                      r.temp, r.hum);
+            } else {
+                out[c].last_error = r.error;
+                LOG_W("[DHT] GPIO%u read %d/%d: failed (%s, %u edges)\n", d.pin, taken[c],
+                      num_reads, dht_error_str(r.error), r.edges);
+            }
+        }
+        // Only the 1-2 s settle gaps may light-sleep; a capture needs the CPU
+        // awake for its micros() edge timestamps
+        if (pending > 0) {
+            power_wait(dht_next_event_ms(dht, count, taken, num_reads),
+                       dht_any_busy(dht, count) ? WAIT_SENSOR_CAPTURE : WAIT_SENSOR_GAP);
+        }
+    }
+
+    size_t ok = 0;
+    for (size_t c = 0; c < count; c++) {
+        if (out[c].valid == 0) continue;
+        out[c].temp = temp_sum[c] / out[c].valid;
+        out[c].hum  = hum_sum[c] / out[c].valid;
+        LOG_I("[DHT] GPIO%u average: %.1fC %.1f%%\n", dht[c].pin, out[c].temp, out[c].hum);
+        ok++;
+    }
+    return ok;
 }
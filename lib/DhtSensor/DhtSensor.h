@@ -1,10 +1,29 @@
 #pragma once
 
-#include <DHT.h>
-
-bool dht_read_average(DHT& dht, int num_reads,
-                      float& temp_out, float& hum_out);
-// Takes num_reads readings, 1s apart (delay(1000) between).
-// Discards NaN results (isnan() check).
-// Sets temp_out and hum_out to the average of valid reads.
-// Returns true if at least one valid read; false if all reads failed.
+#include <stddef.h>
+#include "DhtAsync.h"
+#include "ConfigManager.h"
+
+struct DhtAverage {
+    float   temp;        // average of valid reads, valid when valid > 0
+    float   hum;
+    uint8_t valid;       // conversions that decoded
+    uint8_t last_error;  // DhtError of the latest failed conversion, DHT_OK if none
+};
+
+bool dht_kick_channels(DhtAsync* dht, size_t count);
+// Starts the first idle channel whose settle time has passed, unless another
+// conversion is on the wire. True if one was started. For callers that
+// overlap the first reads with other waits (WiFi association).
+
+size_t dht_read_channels(DhtAsync* dht, size_t count, int num_reads, DhtAverage* out);
+// Takes num_reads conversions on each of count sensors, interleaved: a
+// channel is started as soon as its dht_async_wait_ms() allows and no other
+// conversion is on the wire, so every channel's reads fall inside the same
+// 1 s (DHT11) / 2 s (DHT22) settle windows and the ISR only ever serves one
+// capture. A conversion already started by the caller counts as the first
+// read. Failed conversions are discarded and logged with their reason.
+// count is capped at SENSOR_CHANNELS_MAX. Settle gaps are one
+// power_wait(WAIT_SENSOR_GAP) each; a conversion in flight is polled every ms
+// with WAIT_SENSOR_CAPTURE, which never light-sleeps.
+// Returns the number of channels with at least one valid read.
@@ -0,0 +1,246 @@
+// Frame codec and sender/gateway logic have no Arduino dependencies —
+// compiled on all platforms; the radio binding is device-only.
+#include "EspNowLink.h"
+#include <math.h>
+#include <string.h>
+#include "utils.h"
+
+#define FRAME_FLAG_SENSOR_OK 0x01
+
+static const char* const kStatusStr[] = { "OK", "NOK", "BAT_LOW", "BAT_CRIT" };
+
+uint8_t frame_status_from_str(const char* status) {
+    for (uint8_t i = 0; i < 4; i++) {
+        if (strcmp(status, kStatusStr[i]) == 0) return i;
+    }
+    return FRAME_STATUS_NOK;
+}
+
+const char* frame_status_str(uint8_t status) {
+    return status < 4 ? kStatusStr[status] : kStatusStr[FRAME_STATUS_NOK];
+}
+
+static void put_u16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static uint16_t get_u16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+// Layout: magic(2) version(1) flags|status(1) chip_id(4) temp_dC(2, signed)
+//         hum_dpct(2) batt_cV(2)
+size_t espnow_encode_frame(const SensorFrame& f, uint8_t* buf, size_t len) {
+    if (len < ESPNOW_FRAME_LEN) return 0;
+    put_u16(buf, ESPNOW_FRAME_MAGIC);
+    buf[2] = ESPNOW_FRAME_VERSION;
+    buf[3] = (uint8_t)((f.status & 0x0F) << 4) | (f.sensor_ok ? FRAME_FLAG_SENSOR_OK : 0);
+    put_u16(buf + 4, (uint16_t)(f.chip_id & 0xFFFF));
+    put_u16(buf + 6, (uint16_t)(f.chip_id >> 16));
+    put_u16(buf + 8,  (uint16_t)(int16_t)lroundf(f.sensor_ok ? f.temp * 10.0f : 0.0f));
+    put_u16(buf + 10, (uint16_t)lroundf(f.sensor_ok ? f.hum * 10.0f : 0.0f));
+    put_u16(buf + 12, (uint16_t)lroundf(f.battery_v * 100.0f));
+    return ESPNOW_FRAME_LEN;
+}
+
+bool espnow_decode_frame(const uint8_t* buf, size_t len, SensorFrame& f) {
+    if (len != ESPNOW_FRAME_LEN) return false;
+    if (get_u16(buf) != ESPNOW_FRAME_MAGIC || buf[2] != ESPNOW_FRAME_VERSION) return false;
+    f.status    = (uint8_t)(buf[3] >> 4);
+    f.sensor_ok = (buf[3] & FRAME_FLAG_SENSOR_OK) != 0;
+    f.chip_id   = (uint32_t)get_u16(buf + 4) | ((uint32_t)get_u16(buf + 6) << 16);
+    f.temp      = (float)(int16_t)get_u16(buf + 8) / 10.0f;
+    f.hum       = (float)get_u16(buf + 10) / 10.0f;
+    f.battery_v = (float)get_u16(buf + 12) / 100.0f;
+    return true;
+}
+
+bool espnow_send_readings(const EspNowLink& link, const uint8_t* gateway_mac,
+                          const SensorFrame& f, int max_attempts) {
+    uint8_t buf[ESPNOW_FRAME_LEN];
+    size_t n = espnow_encode_frame(f, buf, sizeof(buf));
+    for (int attempt = 1; attempt <= max_attempts; attempt++) {
+        if (link.send(link.ctx, gateway_mac, buf, n)) return true;
+    }
+    return false;
+}
+
+bool espnow_sender_allowed(const uint8_t* mac, const uint8_t (*allow)[6], size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (memcmp(mac, allow[i], 6) == 0) return true;
+    }
+    return false;
+}
+
+bool espnow_gateway_handle(const uint8_t* data, size_t len, const char* topic_root,
+                           GatewayPublishFn publish, void* ctx, const uint8_t* sender_mac) {
+    SensorFrame f;
+    if (!espnow_decode_frame(data, len, f)) return false;
+    if (sender_mac) {
+        uint32_t mac_id = ((uint32_t)sender_mac[3] << 16) | ((uint32_t)sender_mac[4] << 8) |
+                          sender_mac[5];
+        if (f.chip_id != mac_id) return false;
+    }
+
+    char device_name[16];
+    format_device_name(f.chip_id, device_name, sizeof(device_name));
+
+    char topic[96];
+    char val_buf[16];
+    bool ok = true;
+
+    build_topic(topic_root, device_name, "status", topic, sizeof(topic));
+    ok &= publish(ctx, topic, frame_status_str(f.status), true);
+
+    if (f.sensor_ok) {
+        build_telemetry_topic(topic_root, device_name, "temperature", topic, sizeof(topic));
+        format_float_1dp(f.temp, val_buf, sizeof(val_buf));
+        ok &= publish(ctx, topic, val_buf, false);
+
+        build_telemetry_topic(topic_root, device_name, "humidity", topic, sizeof(topic));
+        format_float_1dp(f.hum, val_buf, sizeof(val_buf));
+        ok &= publish(ctx, topic, val_buf, false);
+    }
+
+    build_telemetry_topic(topic_root, device_name, "voltage", topic, sizeof(topic));
+    format_float_2dp(f.battery_v, val_buf, sizeof(val_buf));
+    ok &= publish(ctx, topic, val_buf, false);
+
+    return ok;
+}
+
+#ifndef NATIVE_TEST
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <espnow.h>
+#include "ConfigManager.h"
+#include "Log.h"
+#include "utils.h"
+
+#define ESPNOW_ACK_TIMEOUT_MS 50
+#define GATEWAY_QUEUE_LEN     8
+
+// -- Sensor side ──────────────────────────────────────────────────────────────
+
+static volatile bool    send_done   = false;
+static volatile uint8_t send_status = 1;
+
+static void on_send(uint8_t* mac, uint8_t status) {
+    (void)mac;
+    send_status = status;
+    send_done   = true;
+}
+
+bool espnow_sensor_begin(const uint8_t* gateway_mac, int channel) {
+    // Never touch the saved station config — the WiFi fallback path needs it
+    WiFi.persistent(false);
+    WiFi.mode(WIFI_STA);
+    wifi_station_disconnect();
+    wifi_set_channel((uint8_t)channel);
+
+    if (esp_now_init() != 0) {
+        LOG_W("[ESPNOW] init failed\n");
+        return false;
+    }
+    esp_now_set_self_role(ESP_NOW_ROLE_CONTROLLER);
+    esp_now_register_send_cb(on_send);
+    if (esp_now_add_peer((uint8_t*)gateway_mac, ESP_NOW_ROLE_SLAVE, (uint8_t)channel, nullptr, 0) != 0) {
+        LOG_W("[ESPNOW] add peer failed\n");
+        return false;
+    }
+    return true;
+}
+
+void espnow_sensor_end() {
+    esp_now_deinit();
+}
+
+static bool radio_send(void* ctx, const uint8_t* mac, const uint8_t* data, size_t len) {
+    (void)ctx;
+    send_done = false;
+    if (esp_now_send((uint8_t*)mac, (uint8_t*)data, (int)len) != 0) return false;
+    unsigned long deadline = millis() + ESPNOW_ACK_TIMEOUT_MS;
+    while (!send_done && millis() < deadline) {
+        delay(1);
+    }
+    return send_done && send_status == 0;
+}
+
+EspNowLink espnow_radio_link() {
+    EspNowLink link = { radio_send, nullptr };
+    return link;
+}
+
+// -- Gateway side ─────────────────────────────────────────────────────────────
+// The receive callback runs in the WiFi task; frames from allowed senders
+// are copied into a small ring and published from loop() where PubSubClient
+// may be used safely.
+
+struct RxFrame {
+    uint8_t mac[6];
+    uint8_t data[ESPNOW_FRAME_LEN];
+};
+
+static RxFrame           rx_queue[GATEWAY_QUEUE_LEN];
+static volatile uint8_t  rx_head = 0;
+static volatile uint8_t  rx_tail = 0;
+static uint8_t           allowed[ESPNOW_SENSORS_MAX][6];
+static size_t            allowed_count = 0;
+static volatile uint32_t rejected      = 0;   // frames from unlisted senders
+static uint8_t           rejected_mac[6];     // latest one, for the log
+static uint32_t          rejected_logged = 0;
+
+static void on_recv(uint8_t* mac, uint8_t* data, uint8_t len) {
+    if (!espnow_sender_allowed(mac, allowed, allowed_count)) {
+        memcpy(rejected_mac, mac, sizeof(rejected_mac));
+        rejected++;
+        return;
+    }
+    if (len != ESPNOW_FRAME_LEN) return;
+    uint8_t next = (uint8_t)((rx_head + 1) % GATEWAY_QUEUE_LEN);
+    if (next == rx_tail) return;  // full — drop newest
+    memcpy(rx_queue[rx_head].mac, mac, sizeof(rx_queue[0].mac));
+    memcpy(rx_queue[rx_head].data, data, ESPNOW_FRAME_LEN);
+    rx_head = next;
+}
+
+bool espnow_gateway_begin(const uint8_t (*sensors)[6], size_t count) {
+    if (count > ESPNOW_SENSORS_MAX) count = ESPNOW_SENSORS_MAX;
+    memcpy(allowed, sensors, count * sizeof(allowed[0]));
+    allowed_count = count;
+    if (esp_now_init() != 0) {
+        LOG_W("[ESPNOW] init failed\n");
+        return false;
+    }
+    esp_now_set_self_role(ESP_NOW_ROLE_SLAVE);
+    esp_now_register_recv_cb(on_recv);
+    WiFi.setSleepMode(WIFI_NONE_SLEEP);  // listen continuously, not only at DTIM beacons
+    LOG_I("[ESPNOW] Gateway listening, MAC %s, channel %d, %u sensors allowed\n",
+          WiFi.macAddress().c_str(), (int)WiFi.channel(), (unsigned)allowed_count);
+    if (allowed_count == 0) LOG_W("[ESPNOW] espnow.sensors is empty — every frame is dropped\n");
+    return true;
+}
+
+int espnow_gateway_poll(const char* topic_root, GatewayPublishFn publish, void* ctx) {
+    if (rejected != rejected_logged) {
+        char mac[18];
+        format_mac(rejected_mac, mac, sizeof(mac));
+        LOG_W("[ESPNOW] Dropped %lu frames from unlisted senders (latest %s)\n",
+              (unsigned long)(rejected - rejected_logged), mac);
+        rejected_logged = rejected;
+    }
+    int handled = 0;
+    while (rx_tail != rx_head) {
+        const RxFrame& rx = rx_queue[rx_tail];
+        if (!espnow_gateway_handle(rx.data, ESPNOW_FRAME_LEN, topic_root, publish, ctx, rx.mac)) {
+            LOG_W("[ESPNOW] Frame rejected or publish failed\n");
+        }
+        rx_tail = (uint8_t)((rx_tail + 1) % GATEWAY_QUEUE_LEN);
+        handled++;
+    }
+    return handled;
+}
+
+#endif // NATIVE_TEST
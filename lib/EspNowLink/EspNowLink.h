@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ESP-NOW transport: a battery sensor sends one frame per wake to a paired,
+// mains-powered gateway running this firmware in gateway role, which
+// republishes it on MQTT under the sensor's own topics.
+//
+// The gateway relays only senders on its allow-list (espnow.sensors), and
+// only under the chip ID their MAC carries (the ESP8266 chip ID is the low
+// 24 bits of the factory station MAC). Frames are not encrypted: this
+// stops stray and misconfigured senders, not a deliberate MAC spoof.
+
+#define ESPNOW_FRAME_MAGIC   0x4553  // "ES", little-endian on the wire
+#define ESPNOW_FRAME_VERSION 1
+#define ESPNOW_FRAME_LEN     14
+
+enum FrameStatus {
+    FRAME_STATUS_OK       = 0,
+    FRAME_STATUS_NOK      = 1,
+    FRAME_STATUS_BAT_LOW  = 2,
+    FRAME_STATUS_BAT_CRIT = 3
+};
+
+struct SensorFrame {
+    uint32_t chip_id;
+    uint8_t  status;     // FrameStatus, computed by the sender
+    bool     sensor_ok;  // temp/hum valid
+    float    temp;       // carried as 0.1 °C
+    float    hum;        // carried as 0.1 %
+    float    battery_v;  // carried as 0.01 V
+};
+
+// Link layer seam — the radio on the device, a simulated link in native tests.
+struct EspNowLink {
+    bool (*send)(void* ctx, const uint8_t* mac, const uint8_t* data, size_t len);
+    // Returns true once the peer acknowledged the frame at the MAC layer.
+    void* ctx;
+};
+
+typedef bool (*GatewayPublishFn)(void* ctx, const char* topic, const char* payload,
+                                 bool is_status);
+// Called by espnow_gateway_handle for each topic it republishes.
+// is_status selects mqtt_publish_status vs mqtt_publish_measurement.
+
+uint8_t frame_status_from_str(const char* status);
+// Maps "OK" / "NOK" / "BAT_LOW" / "BAT_CRIT" to FrameStatus (unknown -> NOK).
+
+const char* frame_status_str(uint8_t status);
+// Inverse of frame_status_from_str; returns "NOK" for unknown codes.
+
+size_t espnow_encode_frame(const SensorFrame& f, uint8_t* buf, size_t len);
+// Returns ESPNOW_FRAME_LEN on success, 0 if buf is too small.
+
+bool espnow_decode_frame(const uint8_t* buf, size_t len, SensorFrame& f);
+// Returns false on wrong length, magic or version.
+
+bool espnow_send_readings(const EspNowLink& link, const uint8_t* gateway_mac,
+                          const SensorFrame& f, int max_attempts);
+// Sender side: encodes f and sends it, retrying until acknowledged.
+
+bool espnow_sender_allowed(const uint8_t* mac, const uint8_t (*allow)[6], size_t count);
+// True when mac is one of the count entries of allow.
+
+bool espnow_gateway_handle(const uint8_t* data, size_t len, const char* topic_root,
+                           GatewayPublishFn publish, void* ctx,
+                           const uint8_t* sender_mac = nullptr);
+// Gateway side: decodes one frame and publishes status, temperature and
+// humidity (when sensor_ok) and voltage — the same topics and payload
+// formats setup() uses for a directly connected sensor. With sender_mac,
+// a frame whose chip ID is not the MAC's low 24 bits is rejected.
+// Returns false if the frame is rejected or any publish fails.
+
+#ifndef NATIVE_TEST
+
+bool espnow_sensor_begin(const uint8_t* gateway_mac, int channel);
+// Brings the radio up in STA mode on the gateway's channel without
+// associating, initialises ESP-NOW and registers the gateway as peer.
+
+void espnow_sensor_end();
+// Releases ESP-NOW so the regular WiFi path can run as a fallback.
+
+EspNowLink espnow_radio_link();
+// Link backed by esp_now_send(); waits up to 50ms for the MAC-layer ack.
+
+bool espnow_gateway_begin(const uint8_t (*sensors)[6], size_t count);
+// Initialises ESP-NOW receive on the already-connected STA interface and
+// accepts frames from the count sensor MACs only (copied). Accepted frames
+// are queued from the receive callback and drained by espnow_gateway_poll.
+// Turns STA power save off (WIFI_NONE_SLEEP): the gateway is mains-powered,
+// and with modem sleep its radio would miss frames sent between DTIM beacons.
+
+int espnow_gateway_poll(const char* topic_root, GatewayPublishFn publish, void* ctx);
+// Republishes all queued frames and logs senders dropped since the last
+// poll. Returns the number handled.
+
+#endif // NATIVE_TEST
@@ -1,83 +1,165 @@
+// Pattern tables and stepping have no Arduino dependencies — compiled on all
+// platforms; the timer1 driver is device-only.
 #include "LedIndicator.h"
 
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+struct LedPhase {
+    uint16_t ms;
+    bool     on;
+};
+
+struct LedPatternDef {
+    const LedPhase* phases;
+    uint8_t         count;
+};
+
+static const LedPhase kWifi[]   = { {500, true}, {500, false} };
+static const LedPhase kSensor[] = { {500, true}, {500, false}, {500, true}, {1000, false} };
+static const LedPhase kMqtt[]   = { {500, true}, {500, false}, {1000, true} };
+static const LedPhase kPortal[] = { {1000, true}, {1000, false} };
+static const LedPhase kError[]  = { {100, true}, {100, false} };
+
+// Indexed by LedPattern
+static const LedPatternDef kPatterns[] = {
+    { nullptr, 0 },
+    { kWifi,   2 },
+    { kSensor, 4 },
+    { kMqtt,   3 },
+    { kPortal, 2 },
+    { kError,  2 },
+};
+
+IRAM_ATTR uint8_t led_pattern_steps(LedPattern pattern) {
+    return (uint8_t)(kPatterns[pattern].count * 2);
+}
+
+IRAM_ATTR bool led_pattern_step(LedPattern pattern, LedMode mode, uint8_t step, uint16_t& hold_ms) {
+    const LedPatternDef& def = kPatterns[pattern];
+    hold_ms = 0;
+    if (def.count == 0) return false;
+
+    const LedPhase& phase = def.phases[(step / 2) % def.count];
+    bool pulsed = phase.on && mode == LED_MODE_PULSE && phase.ms > LED_PULSE_MS;
+
+    if (step % 2 == 0) {
+        hold_ms = pulsed ? LED_PULSE_MS : phase.ms;
+        return phase.on && mode != LED_MODE_OFF;
+    }
+    // Off-remainder of a shortened on-phase
+    hold_ms = pulsed ? (uint16_t)(phase.ms - LED_PULSE_MS) : 0;
+    return false;
+}
+
+#ifndef NATIVE_TEST
+
+#include <Arduino.h>
+
+// 80 MHz / TIM_DIV256 = 312.5 ticks per ms. Integer maths only: led_advance()
+// runs in the timer1 ISR and the soft-float helpers are not in IRAM.
+#define TIMER1_TICKS(ms)    ((uint32_t)(ms) * 625u / 2u)
+#define TIMER1_TICKS_US(us) ((uint32_t)(us) * 5u / 16u)   // us < 858 s
+
+static volatile LedPattern led_pattern = LED_PATTERN_NONE;
+static volatile LedMode    led_mode    = LED_MODE_FULL;
+static volatile uint8_t    led_step    = 0;
+static volatile uint32_t   led_due_us  = 0;  // micros() of the next step
+static uint32_t            led_left_us = 0;  // time left in the step, set by led_hold()
+
+static IRAM_ATTR void led_write(bool on) {
+    digitalWrite(LED_BUILTIN, on ? LOW : HIGH); // active LOW
+}
+
+// Drives the current step and arms timer1 for its hold time. Zero-length
+// steps are skipped; at most one full period is scanned.
+static IRAM_ATTR void led_advance() {
+    LedPattern pattern = led_pattern;
+    uint8_t steps = led_pattern_steps(pattern);
+    for (uint8_t i = 0; i < steps; i++) {
+        uint16_t hold_ms;
+        bool on = led_pattern_step(pattern, led_mode, led_step, hold_ms);
+        led_step = (uint8_t)((led_step + 1) % steps);
+        if (hold_ms == 0) continue;
+        led_write(on);
+        led_due_us = micros() + hold_ms * 1000UL;
+        timer1_write(TIMER1_TICKS(hold_ms));
+        return;
+    }
+    led_write(false);
+}
+
+static IRAM_ATTR void led_timer_isr() {
+    if (led_pattern != LED_PATTERN_NONE) led_advance();
+}
+
 void led_init() {
     pinMode(LED_BUILTIN, OUTPUT);
     digitalWrite(LED_BUILTIN, HIGH); // active LOW — HIGH = off
+    timer1_attachInterrupt(led_timer_isr);
 }
 
 void led_off() {
+    timer1_disable();
+    led_pattern = LED_PATTERN_NONE;
     digitalWrite(LED_BUILTIN, HIGH); // active LOW — HIGH = off
 }
 
-// 500ms on / 500ms off, repeating (period = 1000ms)
-void led_update_wifi(uint32_t now) {
-    static uint32_t phase_start = 0;
-    static uint8_t phase = 0;
-    static const uint16_t durations[2] = {500, 500};
-
-    if (now - phase_start >= durations[phase]) {
-        phase = (phase + 1) % 2;
-        phase_start = now;
-    }
-    // phase 0 = on, phase 1 = off
-    bool on = (phase == 0);
-    digitalWrite(LED_BUILTIN, on ? LOW : HIGH);
+void led_set_mode(LedMode mode) {
+    led_mode = mode;
 }
 
-// 500ms on / 500ms off / 500ms on / 1000ms off, repeating (period = 2500ms)
-void led_update_sensor(uint32_t now) {
-    static uint32_t phase_start = 0;
-    static uint8_t phase = 0;
-    static const uint16_t durations[4] = {500, 500, 500, 1000};
+LedMode led_get_mode() {
+    return led_mode;
+}
 
-    if (now - phase_start >= durations[phase]) {
-        phase = (phase + 1) % 4;
-        phase_start = now;
+void led_set_pattern(LedPattern pattern) {
+    if (pattern == led_pattern) return;
+    if (pattern == LED_PATTERN_NONE) {
+        led_off();
+        return;
     }
-    // phases 0 and 2 = on, phases 1 and 3 = off
-    bool on = (phase == 0 || phase == 2);
-    digitalWrite(LED_BUILTIN, on ? LOW : HIGH);
+    timer1_disable();
+    led_pattern = pattern;
+    led_step    = 0;
+    timer1_enable(TIM_DIV256, TIM_EDGE, TIM_SINGLE);
+    led_advance();
 }
 
-// 500ms on / 500ms off / 1000ms on, repeating (period = 2000ms)
-void led_update_mqtt(uint32_t now) {
-    static uint32_t phase_start = 0;
-    static uint8_t phase = 0;
-    static const uint16_t durations[3] = {500, 500, 1000};
-
-    if (now - phase_start >= durations[phase]) {
-        phase = (phase + 1) % 3;
-        phase_start = now;
+uint32_t led_error_begin(uint32_t duration_ms) {
+    if (led_mode == LED_MODE_OFF) return 0;
+    if (led_mode == LED_MODE_PULSE && duration_ms > LED_ERROR_PULSE_MAX_MS) {
+        duration_ms = LED_ERROR_PULSE_MAX_MS;
     }
-    // phase 1 = off, phases 0 and 2 = on
-    bool on = (phase != 1);
-    digitalWrite(LED_BUILTIN, on ? LOW : HIGH);
+    led_set_pattern(LED_PATTERN_ERROR);
+    // Leave the pattern running; caller must call led_off() before sleep
+    return duration_ms;
 }
 
-// 1000ms on / 1000ms off, repeating (period = 2000ms)
-void led_update_portal(uint32_t now) {
-    static uint32_t phase_start = 0;
-    static uint8_t phase = 0;
-    static const uint16_t durations[2] = {1000, 1000};
+uint32_t led_next_change_ms() {
+    if (led_pattern == LED_PATTERN_NONE) return LED_NO_CHANGE;
+    int32_t left_us = (int32_t)(led_due_us - micros());
+    return (left_us > 0) ? (uint32_t)left_us / 1000 : 0;
+}
 
-    if (now - phase_start >= durations[phase]) {
-        phase = (phase + 1) % 2;
-        phase_start = now;
-    }
-    // phase 0 = on, phase 1 = off
-    bool on = (phase == 0);
-    digitalWrite(LED_BUILTIN, on ? LOW : HIGH);
+void led_hold() {
+    timer1_disable();
+    int32_t left_us = (int32_t)(led_due_us - micros());
+    led_left_us = (left_us > 0) ? (uint32_t)left_us : 0;
 }
 
-// Blocking: 100ms on / 100ms off for duration_ms total.
-// Uses delay() to feed the ESP8266 software watchdog (yield() is called inside delay()).
-void led_error_blocking(int duration_ms) {
-    unsigned long end_time = millis() + (unsigned long)duration_ms;
-    bool led_on = true;
-    while (millis() < end_time) {
-        digitalWrite(LED_BUILTIN, led_on ? LOW : HIGH);
-        led_on = !led_on;
-        delay(100); // feeds watchdog via yield() inside delay()
+void led_release(uint32_t slept_ms) {
+    if (led_pattern == LED_PATTERN_NONE) return;
+    uint32_t slept_us = slept_ms * 1000UL;
+    timer1_enable(TIM_DIV256, TIM_EDGE, TIM_SINGLE);
+    if (led_left_us <= slept_us) {
+        led_advance();
+        return;
     }
-    // Leave LED state as-is; caller must call led_off() before sleep
+    uint32_t left_us = led_left_us - slept_us;
+    led_due_us = micros() + left_us;
+    timer1_write(TIMER1_TICKS_US(left_us));
 }
+
+#endif // NATIVE_TEST
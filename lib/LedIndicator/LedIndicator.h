@@ -1,29 +1,72 @@
 #pragma once
 
-#include <Arduino.h>
+#include <stdint.h>
+
+// Data-driven LED pattern engine. Patterns run from the hardware timer
+// (timer1) once set, so callers no longer poll from their wait loops.
+
+enum LedPattern {
+    LED_PATTERN_NONE,    // LED off, timer stopped
+    LED_PATTERN_WIFI,    // 500ms on / 500ms off
+    LED_PATTERN_SENSOR,  // 500ms on / 500ms off / 500ms on / 1000ms off
+    LED_PATTERN_MQTT,    // 500ms on / 500ms off / 1000ms on
+    LED_PATTERN_PORTAL,  // 1000ms on / 1000ms off
+    LED_PATTERN_ERROR    // 100ms on / 100ms off
+};
+
+enum LedMode {
+    LED_MODE_FULL,   // patterns as listed above
+    LED_MODE_PULSE,  // every on-phase shortened to an LED_PULSE_MS flash;
+                     // phase timing (and so pattern recognition) unchanged
+    LED_MODE_OFF     // no indication at all
+};
+
+#define LED_PULSE_MS          20
+#define LED_ERROR_PULSE_MAX_MS 5000  // led_error_begin cap in LED_MODE_PULSE
+#define LED_NO_CHANGE         0xFFFFFFFF  // led_next_change_ms: no pattern running
+
+uint8_t led_pattern_steps(LedPattern pattern);
+// Number of timer steps in one period of pattern (two per phase).
+
+bool led_pattern_step(LedPattern pattern, LedMode mode, uint8_t step, uint16_t& hold_ms);
+// Returns the LED state (true = on) for step and sets hold_ms to how long it
+// is held. Each phase is two steps: the (possibly shortened) phase itself and
+// the off-remainder that LED_MODE_PULSE adds; hold_ms == 0 steps are skipped.
+// No Arduino dependencies — unit-tested in the native env.
+
+#ifndef NATIVE_TEST
 
 void led_init();
 // Configures LED_BUILTIN as OUTPUT and sets it HIGH (off, active LOW).
+// Attaches the timer1 interrupt that advances patterns.
 
 void led_off();
-// Sets LED_BUILTIN HIGH (off).
+// Stops the running pattern and sets LED_BUILTIN HIGH (off).
+
+void led_set_mode(LedMode mode);
+// Selects full / pulse / off indication. Takes effect at the next step.
+
+LedMode led_get_mode();
+
+void led_set_pattern(LedPattern pattern);
+// Starts pattern from its first phase (no-op if already running).
+// LED_PATTERN_NONE is equivalent to led_off().
 
-void led_update_wifi(uint32_t now);
-// Non-blocking: 500ms on / 500ms off repeating toggle.
-// Call repeatedly in a loop, passing millis().
+uint32_t led_error_begin(uint32_t duration_ms);
+// Starts LED_PATTERN_ERROR and returns how long to show it: duration_ms,
+// capped at LED_ERROR_PULSE_MAX_MS in LED_MODE_PULSE, 0 (pattern not
+// started) in LED_MODE_OFF. The caller waits, typically
+// power_wait(led_error_begin(ms), WAIT_RADIO_OFF), then calls led_off().
 
-void led_update_sensor(uint32_t now);
-// Non-blocking: 500ms on / 500ms off / 500ms on / 1000ms off repeating.
-// Call repeatedly in a loop, passing millis().
+uint32_t led_next_change_ms();
+// Time until the running pattern's next step, LED_NO_CHANGE when none runs.
 
-void led_update_mqtt(uint32_t now);
-// Non-blocking: 500ms on / 500ms off / 1000ms on repeating.
-// Call repeatedly in a loop, passing millis().
+void led_hold();
+// Stops timer1 and remembers the time left in the current step. For forced
+// light sleep, which stops timer1 and the millis()/micros() clock with it.
 
-void led_update_portal(uint32_t now);
-// Non-blocking: 1000ms on / 1000ms off repeating toggle.
-// Call repeatedly in a loop, passing millis().
+void led_release(uint32_t slept_ms);
+// Undoes led_hold() after slept_ms asleep: steps the pattern if the step
+// ran out meanwhile, otherwise finishes it, and restarts timer1.
 
-void led_error_blocking(int duration_ms);
-// Blocking: 100ms on / 100ms off for duration_ms total.
-// Uses delay() to feed the ESP8266 software watchdog.
+#endif // NATIVE_TEST
@@ -0,0 +1,147 @@
+// Event ring logic has no Arduino dependencies — compiles on all platforms
+#include "Log.h"
+#include "RtcLayout.h"
+#include <stdio.h>
+#include <string.h>
+
+static_assert(sizeof(LogEvent) == 8, "LogEvent must stay 8 bytes");
+static_assert(sizeof(EventLog) == RTC_BLOCKS_EVENT_LOG * RTC_BLOCK_SIZE,
+              "EventLog must fill its RTC region exactly");
+
+static const char* const kEventNames[EV_COUNT] = {
+    "NONE", "BOOT", "CONFIG_FAIL", "PORTAL", "ESPNOW_OK", "ESPNOW_FAIL",
+    "WIFI_OK", "WIFI_FAIL", "SENSOR_FAIL", "MQTT_OK", "MQTT_FAIL", "SLEEP",
+    "DEGRADED"
+};
+
+const char* event_code_name(uint8_t code) {
+    return (code < EV_COUNT) ? kEventNames[code] : "?";
+}
+
+void event_log_reset(EventLog& log) {
+    memset(&log, 0, sizeof(log));
+    log.magic = EVENT_LOG_MAGIC;
+}
+
+void event_log_begin_wake(EventLog& log) {
+    if (log.magic != EVENT_LOG_MAGIC || log.count > EVENT_LOG_CAPACITY ||
+        log.head >= EVENT_LOG_CAPACITY || log.unsent > log.count) {
+        event_log_reset(log);
+    }
+    log.wake++;
+}
+
+const LogEvent& event_log_push(EventLog& log, uint8_t code, int32_t value, uint32_t t_ms) {
+    LogEvent& ev = log.events[log.head];
+    ev.code  = code;
+    ev.wake  = (uint8_t)log.wake;
+    ev.t_ms  = (t_ms > 0xFFFF) ? 0xFFFF : (uint16_t)t_ms;
+    ev.value = value;
+    log.head = (uint8_t)((log.head + 1) % EVENT_LOG_CAPACITY);
+    if (log.count < EVENT_LOG_CAPACITY) log.count++;
+    if (log.unsent < log.count) log.unsent++;
+    return ev;
+}
+
+const LogEvent& event_log_get(const EventLog& log, size_t i) {
+    size_t oldest = (log.head + EVENT_LOG_CAPACITY - log.count) % EVENT_LOG_CAPACITY;
+    return log.events[(oldest + i) % EVENT_LOG_CAPACITY];
+}
+
+size_t event_log_format(const LogEvent& ev, char* buf, size_t len) {
+    int n = snprintf(buf, len, "w%u+%ums %s=%ld", (unsigned)ev.wake, (unsigned)ev.t_ms,
+                     event_code_name(ev.code), (long)ev.value);
+    return (n < 0) ? 0 : (size_t)n;
+}
+
+size_t event_log_drain(EventLog& log, EventSinkFn sink, void* ctx, size_t chunk_len) {
+    char payload[256];
+    if (chunk_len > sizeof(payload)) chunk_len = sizeof(payload);
+
+    size_t sent    = 0;
+    size_t pending = 0;  // entries packed into payload
+    size_t used    = 0;
+    size_t first   = log.count - log.unsent;
+
+    for (size_t i = first; i < log.count; i++) {
+        char line[48];
+        size_t n = event_log_format(event_log_get(log, i), line, sizeof(line));
+        if (pending > 0 && used + 1 + n >= chunk_len) {
+            if (!sink(ctx, payload)) break;
+            sent += pending;
+            log.unsent -= (uint8_t)pending;
+            pending = 0;
+            used    = 0;
+        }
+        if (pending > 0) payload[used++] = ';';
+        size_t room = chunk_len - 1 - used;
+        if (n > room) n = room;
+        memcpy(payload + used, line, n);
+        used += n;
+        payload[used] = '\0';
+        pending++;
+    }
+    if (pending > 0 && sink(ctx, payload)) {
+        sent += pending;
+        log.unsent -= (uint8_t)pending;
+    }
+    return sent;
+}
+
+#ifndef NATIVE_TEST
+
+// Header (magic..reserved) is the first 3 blocks; each entry is 2 blocks.
+#define EVENT_LOG_HEADER_BLOCKS 3
+
+static EventLog s_log;
+static bool     s_serial_started = false;
+
+static void log_serial_begin() {
+    if (s_serial_started) return;
+    Serial.begin(115200);
+    s_serial_started = true;
+}
+
+void log_begin() {
+#if LOG_LEVEL > LOG_LEVEL_NONE
+    log_serial_begin();
+#endif
+    ESP.rtcUserMemoryRead(RTC_BLOCK_EVENT_LOG, (uint32_t*)&s_log, sizeof(s_log));
+    event_log_begin_wake(s_log);
+    ESP.rtcUserMemoryWrite(RTC_BLOCK_EVENT_LOG, (uint32_t*)&s_log, sizeof(s_log));
+}
+
+void log_event(EventCode code, int32_t value) {
+    const LogEvent& ev = event_log_push(s_log, code, value, millis());
+    size_t slot = (size_t)(&ev - s_log.events);
+    ESP.rtcUserMemoryWrite(RTC_BLOCK_EVENT_LOG, (uint32_t*)&s_log,
+                           EVENT_LOG_HEADER_BLOCKS * RTC_BLOCK_SIZE);
+    ESP.rtcUserMemoryWrite(RTC_BLOCK_EVENT_LOG + EVENT_LOG_HEADER_BLOCKS + slot * 2,
+                           (uint32_t*)&s_log.events[slot], sizeof(LogEvent));
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+    char line[48];
+    event_log_format(ev, line, sizeof(line));
+    LOG_D("[Event] %s\n", line);
+#endif
+}
+
+EventLog& log_events() {
+    return s_log;
+}
+
+void log_events_commit() {
+    ESP.rtcUserMemoryWrite(RTC_BLOCK_EVENT_LOG, (uint32_t*)&s_log, sizeof(s_log));
+}
+
+void log_dump_serial() {
+    log_serial_begin();
+    Serial.printf("[Log] %u events (wake %u, %u unsent):\n",
+                  (unsigned)s_log.count, (unsigned)s_log.wake, (unsigned)s_log.unsent);
+    for (size_t i = 0; i < s_log.count; i++) {
+        char line[48];
+        event_log_format(event_log_get(s_log, i), line, sizeof(line));
+        Serial.printf("  %s\n", line);
+    }
+}
+
+#endif // NATIVE_TEST
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Logging: compile-time filtered serial text plus a binary event ring in
+// RTC user memory.
+//
+// Serial: LOG_E/W/I/D take printf arguments (include the trailing "\n").
+// Calls above LOG_LEVEL expand to ((void)0), so their arguments are never
+// evaluated and their format strings never reach flash. Select with
+// -D LOG_LEVEL=LOG_LEVEL_xxx (default INFO).
+//
+// Events: log_event() records a fixed 8-byte entry whatever LOG_LEVEL is,
+// so production builds (LOG_LEVEL_NONE) still keep a history across deep
+// sleep that can be dumped over serial or MQTT later.
+
+#define LOG_LEVEL_NONE   0
+#define LOG_LEVEL_ERROR  1
+#define LOG_LEVEL_WARN   2
+#define LOG_LEVEL_INFO   3
+#define LOG_LEVEL_DEBUG  4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#ifdef NATIVE_TEST
+#define LOG_PRINTF(...) ((void)0)
+#else
+#include <Arduino.h>
+#define LOG_PRINTF(...) Serial.printf(__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_E(...) LOG_PRINTF(__VA_ARGS__)
+#else
+#define LOG_E(...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_W(...) LOG_PRINTF(__VA_ARGS__)
+#else
+#define LOG_W(...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_I(...) LOG_PRINTF(__VA_ARGS__)
+#else
+#define LOG_I(...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_D(...) LOG_PRINTF(__VA_ARGS__)
+#else
+#define LOG_D(...) ((void)0)
+#endif
+
+// -- Binary event ring ────────────────────────────────────────────────────────
+
+#define EVENT_LOG_MAGIC     0x45564C47  // "EVLG"
+#define EVENT_LOG_CAPACITY  24
+
+enum EventCode {
+    EV_NONE = 0,
+    EV_BOOT,          // value: reset reason (rst_info.reason)
+    EV_CONFIG_FAIL,   // config.json missing or invalid
+    EV_PORTAL,        // value: scenario 1/2/3
+    EV_ESPNOW_OK,     // value: ms since boot at delivery
+    EV_ESPNOW_FAIL,
+    EV_WIFI_OK,       // value: attempt that connected
+    EV_WIFI_FAIL,
+    EV_SENSOR_FAIL,
+    EV_MQTT_OK,       // value: attempt that connected
+    EV_MQTT_FAIL,     // value: PubSubClient state()
+    EV_SLEEP,         // value: seconds in this sleep segment
+    EV_DEGRADED,      // value: CpuPhase skipped after a crash loop
+    EV_COUNT
+};
+
+struct LogEvent {
+    uint8_t  code;    // EventCode
+    uint8_t  wake;    // low 8 bits of the wake counter
+    uint16_t t_ms;    // millis() when recorded, saturated at 65535
+    int32_t  value;   // code-specific, see EventCode
+};
+
+struct EventLog {
+    uint32_t magic;
+    uint16_t wake;    // incremented by event_log_begin_wake()
+    uint8_t  head;    // next slot to write
+    uint8_t  count;   // valid entries, <= EVENT_LOG_CAPACITY
+    uint8_t  unsent;  // newest entries not yet drained
+    uint8_t  reserved[3];
+    LogEvent events[EVENT_LOG_CAPACITY];
+};
+
+// Sink for event_log_drain(): publishes one payload, returns false to stop.
+typedef bool (*EventSinkFn)(void* ctx, const char* payload);
+
+const char* event_code_name(uint8_t code);
+
+void event_log_reset(EventLog& log);
+// Clears every entry and stamps the magic.
+
+void event_log_begin_wake(EventLog& log);
+// Resets a log without a valid magic (power-on, flash), then bumps the wake counter.
+
+const LogEvent& event_log_push(EventLog& log, uint8_t code, int32_t value, uint32_t t_ms);
+// Appends an entry, overwriting the oldest once full. Returns the stored entry.
+
+const LogEvent& event_log_get(const EventLog& log, size_t i);
+// i-th entry, oldest first; i must be < log.count.
+
+size_t event_log_format(const LogEvent& ev, char* buf, size_t len);
+// "w12+340ms WIFI_OK=2". Returns characters written (snprintf semantics).
+
+size_t event_log_drain(EventLog& log, EventSinkFn sink, void* ctx, size_t chunk_len);
+// Sends unsent entries oldest first, packed into ';'-separated payloads of
+// at most chunk_len - 1 characters. Entries are marked sent only when the
+// sink accepts their payload. Returns entries sent.
+// No Arduino dependencies — unit-tested in the native env.
+
+#ifndef NATIVE_TEST
+
+void log_begin();
+// Starts Serial when LOG_LEVEL > NONE, loads the event ring from RTC
+// memory and starts a new wake in it.
+
+void log_event(EventCode code, int32_t value = 0);
+// Records an event and writes the changed RTC blocks straight away, so the
+// entry survives a crash or watchdog reset.
+
+EventLog& log_events();
+// RAM copy of the ring (valid after log_begin()).
+
+void log_events_commit();
+// Writes the whole ring back to RTC memory (after event_log_drain()).
+
+void log_dump_serial();
+// Prints every entry, oldest first. Starts Serial if the build did not.
+
+#endif // NATIVE_TEST
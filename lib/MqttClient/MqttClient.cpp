@@ -1,6 +1,8 @@
 #include "MqttClient.h"
 #include <Arduino.h>
 #include <ESP8266WiFi.h>
+#include "PowerWait.h"
+#include "Log.h"
 
 bool mqtt_connect(PubSubClient& client,
                   const char* server, int port,
@@ -14,20 +16,19 @@ bool mqtt_connect(PubSubClient& client,
     client.setKeepAlive(60);
 
     for (int attempt = 1; attempt <= max_attempts; attempt++) {
-        Serial.printf("[MQTT] Connect attempt %d/%d...\n", attempt, max_attempts);
+        LOG_D("[MQTT] Connect attempt %d/%d...\n", attempt, max_attempts);
         client.connect(client_id, username, password,
                        lwt_topic, 1, true, "OFFLINE");
         unsigned long deadline = millis() + (unsigned long)attempt_timeout_s * 1000;
         while (millis() < deadline) {
             if (client.connected()) {
-                Serial.println("[MQTT] Connected");
+                LOG_I("[MQTT] Connected\n");
                 return true;
             }
-            delay(100);
-            yield();
+            power_wait(100, WAIT_NETWORK);
         }
-        Serial.printf("[MQTT] Attempt %d failed, state=%d\n", attempt, client.state());
-        if (attempt < max_attempts) delay(2000);
+        LOG_D("[MQTT] Attempt %d failed, state=%d\n", attempt, client.state());
+        if (attempt < max_attempts) power_wait(2000, WAIT_RETRY_GAP);
     }
     return false;
 }
@@ -41,8 +42,107 @@ bool mqtt_publish_measurement(PubSubClient& client, const char* topic, const cha
     return client.publish(topic, payload, true);
 }
 
-void mqtt_flush_and_disconnect(PubSubClient& client) {
-    client.loop();
-    delay(100);
+bool mqtt_flush_and_disconnect(PubSubClient& client) {
+    // disconnect() stops the transport: a CoalescingClient writes the burst
+    // then, and WiFiClient::stop() waits for it to be acknowledged
+    bool ok = client.connected();
     client.disconnect();
+    return ok;
+}
+
+// -- MQTT-SN transport ────────────────────────────────────────────────────────
+
+bool mqtt_connect(MqttSnClient& client, const char* client_id,
+                  int max_attempts, int attempt_timeout_s) {
+    bool resume = mqttsn_session_held();
+    for (int attempt = 1; attempt <= max_attempts; attempt++) {
+        LOG_D("[MQTT-SN] Connect attempt %d/%d...\n", attempt, max_attempts);
+        if (mqttsn_connect(client, client_id, MQTTSN_KEEPALIVE_S,
+                           (uint32_t)attempt_timeout_s * 1000, !resume)) {
+            mqttsn_session_record(false);
+            LOG_I("[MQTT-SN] Connected (%s session)\n", resume ? "resumed" : "clean");
+            return true;
+        }
+        LOG_D("[MQTT-SN] Attempt %d failed, rc=%u\n", attempt, client.last_rc);
+        if (attempt < max_attempts) power_wait(2000, WAIT_RETRY_GAP);
+    }
+    return false;
+}
+
+bool mqtt_publish_status(MqttSnClient& client, const char* topic, const char* payload) {
+    return mqttsn_publish(client, mqttsn_topic_id(topic, client.channels, client.channel_count),
+                          payload, 0, true, MQTTSN_ACK_TIMEOUT_MS);
+}
+
+bool mqtt_publish_measurement(MqttSnClient& client, const char* topic, const char* payload) {
+    return mqttsn_publish(client, mqttsn_topic_id(topic, client.channels, client.channel_count),
+                          payload, 0, true, MQTTSN_ACK_TIMEOUT_MS);
+}
+
+bool mqtt_flush_and_disconnect(MqttSnClient& client, int sleep_s) {
+    uint16_t duration = (sleep_s > 0xFFFF) ? 0xFFFF : (uint16_t)sleep_s;
+    if (mqttsn_disconnect(client, duration, MQTTSN_ACK_TIMEOUT_MS)) {
+        mqttsn_session_record(duration > 0);
+        return true;
+    }
+    LOG_W("[MQTT-SN] No DISCONNECT reply from gateway\n");
+    return false;
+}
+
+// -- CoalescingClient ─────────────────────────────────────────────────────────
+
+CoalescingClient::CoalescingClient(WiFiClient& inner) : _inner(inner) {
+    coalescer_init(_co, _buf, sizeof(_buf), sink, this);
+}
+
+size_t CoalescingClient::sink(void* ctx, const uint8_t* data, size_t len) {
+    return static_cast<CoalescingClient*>(ctx)->_inner.write(data, len);
+}
+
+void CoalescingClient::begin_burst() {
+    _inner.setNoDelay(true);
+    _burst_ok = true;
+    coalescer_begin_burst(_co);
+}
+
+bool CoalescingClient::end_burst() {
+    _burst_ok &= coalescer_flush(_co);
+    return _burst_ok;
+}
+
+int CoalescingClient::connect(IPAddress ip, uint16_t port) {
+    int rc = _inner.connect(ip, port);
+    _inner.setNoDelay(true);
+    return rc;
+}
+
+int CoalescingClient::connect(const char* host, uint16_t port) {
+    int rc = _inner.connect(host, port);
+    _inner.setNoDelay(true);
+    return rc;
+}
+
+size_t CoalescingClient::write(uint8_t b) {
+    return coalescer_write(_co, &b, 1);
+}
+
+size_t CoalescingClient::write(const uint8_t* buf, size_t size) {
+    return coalescer_write(_co, buf, size);
+}
+
+int CoalescingClient::available()                    { return _inner.available(); }
+int CoalescingClient::read()                         { return _inner.read(); }
+int CoalescingClient::read(uint8_t* buf, size_t size) { return _inner.read(buf, size); }
+int CoalescingClient::peek()                         { return _inner.peek(); }
+uint8_t CoalescingClient::connected()                { return _inner.connected(); }
+CoalescingClient::operator bool()                    { return (bool)_inner; }
+
+void CoalescingClient::flush() {
+    _burst_ok &= coalescer_flush(_co);
+    _inner.flush();
+}
+
+void CoalescingClient::stop() {
+    _burst_ok &= coalescer_flush(_co);
+    _inner.stop();
 }
@@ -1,6 +1,61 @@
 #pragma once
 
 #include <PubSubClient.h>
+#include "WriteCoalescer.h"
+#include "MqttSn.h"
+#include "ConfigManager.h"
+
+// One wake's burst: status and fault (payloads up to 63 bytes), voltage,
+// rssi, tx_power and temperature + humidity per channel (up to 15), each
+// PUBLISH at most 1 + 2 (remaining length) + 2 (topic length) + a 95-byte
+// topic, then the 2-byte DISCONNECT. Event log chunks (log.dump = "mqtt")
+// are not counted: a long dump flushes early and takes extra segments.
+#define MQTT_PUBLISH_WIRE_MAX(payload) (5 + 95 + (payload))
+#define MQTT_COALESCE_BUF_SIZE (2 * MQTT_PUBLISH_WIRE_MAX(63) +                           \
+                                (3 + 2 * SENSOR_CHANNELS_MAX) * MQTT_PUBLISH_WIRE_MAX(15) + 2)
+
+// Client wrapper that lets a whole publish burst leave in one TCP segment.
+// CONNECT/CONNACK pass straight through; after begin_burst() every PUBLISH
+// PubSubClient writes is appended to one buffer, and the DISCONNECT written
+// by client.disconnect() is flushed with it in a single write (Nagle off).
+class CoalescingClient : public Client {
+public:
+    explicit CoalescingClient(WiFiClient& inner);
+
+    void begin_burst();
+    // Enables coalescing; call once the MQTT session is connected.
+
+    bool end_burst();
+    // Writes everything buffered so far in one segment and stops coalescing.
+
+    uint32_t segments() const { return _co.sink_writes; }
+    // Writes handed to the TCP stack since construction.
+
+    bool burst_ok() const { return _burst_ok; }
+    // False once a flush since begin_burst() (end_burst, flush or stop)
+    // could not hand every buffered byte to the TCP stack.
+
+    int     connect(IPAddress ip, uint16_t port) override;
+    int     connect(const char* host, uint16_t port) override;
+    size_t  write(uint8_t b) override;
+    size_t  write(const uint8_t* buf, size_t size) override;
+    int     available() override;
+    int     read() override;
+    int     read(uint8_t* buf, size_t size) override;
+    int     peek() override;
+    void    flush() override;   // flushes the burst, then the socket
+    void    stop() override;    // flushes the burst, then closes
+    uint8_t connected() override;
+    operator bool() override;
+
+private:
+    static size_t sink(void* ctx, const uint8_t* data, size_t len);
+
+    WiFiClient&    _inner;
+    WriteCoalescer _co;
+    uint8_t        _buf[MQTT_COALESCE_BUF_SIZE];
+    bool           _burst_ok = true;
+};
 
 bool mqtt_connect(PubSubClient& client,
                   const char* server, int port,
@@ -11,7 +66,7 @@ bool mqtt_connect(PubSubClient& client,
 // Connects to MQTT broker with LWT.
 // Sets client.setKeepAlive(60) before connecting.
 // LWT: lwt_topic, payload "OFFLINE", QoS 1, retain true.
-// Retry loop: up to max_attempts, millis() deadline per attempt, 2s delay between.
+// Retry loop: up to max_attempts, millis() deadline per attempt, 2s auto-light-sleep gap between.
 // Returns true on success.
 
 bool mqtt_publish_status(PubSubClient& client, const char* topic, const char* payload);
@@ -22,5 +77,32 @@ bool mqtt_publish_measurement(PubSubClient& client, const char* topic, const cha
 // Publishes to topic with QoS 0, retain true.
 // Returns client.publish() result.
 
-void mqtt_flush_and_disconnect(PubSubClient& client);
-// Calls client.loop() then delay(100) then client.disconnect().
+bool mqtt_flush_and_disconnect(PubSubClient& client);
+// Sends DISCONNECT right away; the burst buffered so far leaves with it.
+// Returns false if the session had already dropped before the DISCONNECT.
+
+// -- MQTT-SN transport ────────────────────────────────────────────────────────
+// Same calls over MqttSnClient (UDP, predefined topic IDs). Topics must follow
+// the build_topic / build_telemetry_topic layout; others fail to publish.
+// No LWT: registering a will costs two extra round trips per wake.
+
+#define MQTTSN_KEEPALIVE_S    60
+#define MQTTSN_ACK_TIMEOUT_MS 500
+
+bool mqtt_connect(MqttSnClient& client, const char* client_id,
+                  int max_attempts, int attempt_timeout_s);
+// CONNECT/CONNACK retry loop, 2s auto-light-sleep gap between attempts. Returns true on success.
+// Resumes the gateway session (clean = false) when mqttsn_session_held().
+
+bool mqtt_publish_status(MqttSnClient& client, const char* topic, const char* payload);
+// QoS 0, retain true — as on TCP. The gateway's DISCONNECT reply is what
+// confirms the burst arrived, so a wake costs two round trips in total.
+
+bool mqtt_publish_measurement(MqttSnClient& client, const char* topic, const char* payload);
+// QoS 0, retain true.
+
+bool mqtt_flush_and_disconnect(MqttSnClient& client, int sleep_s);
+// Sleeping-client DISCONNECT announcing sleep_s (capped at 65535); waits up
+// to MQTTSN_ACK_TIMEOUT_MS for the gateway's reply. Returns false without
+// one: the burst is not confirmed. An acknowledged one records the held
+// session for the next wake's CONNECT.
@@ -0,0 +1,334 @@
+// Codec, client and gateway stand-in have no Arduino dependencies — compile on all platforms
+#include "MqttSn.h"
+#include <stdio.h>
+#include <string.h>
+#include "utils.h"
+
+#define MQTTSN_PROTOCOL_ID   0x01
+#define MQTTSN_FLAG_RETAIN   0x10
+#define MQTTSN_FLAG_CLEAN    0x04
+#define MQTTSN_FLAG_QOS1     0x20
+#define MQTTSN_QOS_MASK      0x60
+#define MQTTSN_TOPIC_PREDEF  0x01
+#define MQTTSN_TOPIC_MASK    0x03
+#define MQTTSN_STRAY_LIMIT   4     // unrelated datagrams tolerated per wait
+
+static void put_u16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static uint16_t get_u16(const uint8_t* p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+// -- Codec ────────────────────────────────────────────────────────────────────
+
+size_t mqttsn_encode_connect(const char* client_id, uint16_t keepalive_s, bool clean,
+                             uint8_t* buf, size_t cap) {
+    size_t id_len = strlen(client_id);
+    size_t n = 6 + id_len;
+    if (id_len == 0 || n > cap || n > MQTTSN_MAX_PACKET) return 0;
+    buf[0] = (uint8_t)n;
+    buf[1] = MQTTSN_CONNECT;
+    buf[2] = clean ? MQTTSN_FLAG_CLEAN : 0;
+    buf[3] = MQTTSN_PROTOCOL_ID;
+    put_u16(buf + 4, keepalive_s);
+    memcpy(buf + 6, client_id, id_len);
+    return n;
+}
+
+size_t mqttsn_encode_connack(uint8_t rc, uint8_t* buf, size_t cap) {
+    if (cap < 3) return 0;
+    buf[0] = 3;
+    buf[1] = MQTTSN_CONNACK;
+    buf[2] = rc;
+    return 3;
+}
+
+size_t mqttsn_encode_publish(uint16_t topic_id, uint16_t msg_id, uint8_t qos, bool retain,
+                             const uint8_t* data, size_t len, uint8_t* buf, size_t cap) {
+    size_t n = MQTTSN_PUBLISH_HEADER + len;
+    if (qos > 1 || n > cap || n > MQTTSN_MAX_PACKET) return 0;
+    buf[0] = (uint8_t)n;
+    buf[1] = MQTTSN_PUBLISH;
+    buf[2] = (uint8_t)((qos ? MQTTSN_FLAG_QOS1 : 0) | (retain ? MQTTSN_FLAG_RETAIN : 0) |
+                       MQTTSN_TOPIC_PREDEF);
+    put_u16(buf + 3, topic_id);
+    put_u16(buf + 5, qos ? msg_id : 0);
+    memcpy(buf + MQTTSN_PUBLISH_HEADER, data, len);
+    return n;
+}
+
+size_t mqttsn_encode_puback(uint16_t topic_id, uint16_t msg_id, uint8_t rc,
+                            uint8_t* buf, size_t cap) {
+    if (cap < 7) return 0;
+    buf[0] = 7;
+    buf[1] = MQTTSN_PUBACK;
+    put_u16(buf + 2, topic_id);
+    put_u16(buf + 4, msg_id);
+    buf[6] = rc;
+    return 7;
+}
+
+size_t mqttsn_encode_disconnect(uint16_t sleep_s, uint8_t* buf, size_t cap) {
+    size_t n = sleep_s ? 4 : 2;
+    if (cap < n) return 0;
+    buf[0] = (uint8_t)n;
+    buf[1] = MQTTSN_DISCONNECT;
+    if (sleep_s) put_u16(buf + 2, sleep_s);
+    return n;
+}
+
+uint8_t mqttsn_msg_type(const uint8_t* buf, size_t len) {
+    if (len < 2 || buf[0] != len) return 0;
+    return buf[1];
+}
+
+bool mqttsn_decode_publish(const uint8_t* buf, size_t len, MqttSnPublish& out) {
+    if (mqttsn_msg_type(buf, len) != MQTTSN_PUBLISH || len < MQTTSN_PUBLISH_HEADER) return false;
+    uint8_t flags = buf[2];
+    if ((flags & MQTTSN_TOPIC_MASK) != MQTTSN_TOPIC_PREDEF) return false;
+    uint8_t qos_bits = flags & MQTTSN_QOS_MASK;
+    if (qos_bits != 0 && qos_bits != MQTTSN_FLAG_QOS1) return false;
+    out.qos      = qos_bits ? 1 : 0;
+    out.retain   = (flags & MQTTSN_FLAG_RETAIN) != 0;
+    out.topic_id = get_u16(buf + 3);
+    out.msg_id   = get_u16(buf + 5);
+    out.data     = buf + MQTTSN_PUBLISH_HEADER;
+    out.len      = len - MQTTSN_PUBLISH_HEADER;
+    return true;
+}
+
+// -- Topic mapping ────────────────────────────────────────────────────────────
+
+static const char* const kTopicSuffixes[MQTTSN_TOPIC_COUNT] = {
+    nullptr, "status", "telemetry/temperature", "telemetry/humidity",
+    "telemetry/voltage", "log", "telemetry/rssi", "telemetry/tx_power", "fault"
+};
+
+uint16_t mqttsn_topic_id(const char* topic, const char* const* channels, size_t channel_count) {
+    size_t len = strlen(topic);
+    ParsedTopic t;
+    if (parse_topic(topic, len, t)) {
+        if (t.kind == TOPIC_STATUS) return MQTTSN_TOPIC_STATUS;
+        if (t.channel.len > 0) {
+            uint16_t metric = topic_span_equals(t.metric, "temperature") ? 0
+                            : topic_span_equals(t.metric, "humidity")    ? 1
+                            : 2;
+            if (metric > 1) return MQTTSN_TOPIC_NONE;
+            for (size_t ch = 0; ch < channel_count; ch++) {
+                if (topic_span_equals(t.channel, channels[ch]))
+                    return (uint16_t)(MQTTSN_TOPIC_CHANNEL_BASE + ch * 2 + metric);
+            }
+            return MQTTSN_TOPIC_NONE;
+        }
+        if (topic_span_equals(t.metric, "temperature")) return MQTTSN_TOPIC_TEMPERATURE;
+        if (topic_span_equals(t.metric, "humidity"))    return MQTTSN_TOPIC_HUMIDITY;
+        if (topic_span_equals(t.metric, "voltage"))     return MQTTSN_TOPIC_VOLTAGE;
+        if (topic_span_equals(t.metric, "rssi"))        return MQTTSN_TOPIC_RSSI;
+        if (topic_span_equals(t.metric, "tx_power"))    return MQTTSN_TOPIC_TX_POWER;
+        return MQTTSN_TOPIC_NONE;
+    }
+    // {root}/{device}/log and /fault — outside parse_topic's status/telemetry layout
+    TopicSpan last = topic_prev_segment(topic, topic + len);
+    uint16_t  id   = topic_span_equals(last, "log")   ? MQTTSN_TOPIC_LOG
+                   : topic_span_equals(last, "fault") ? MQTTSN_TOPIC_FAULT
+                   : MQTTSN_TOPIC_NONE;
+    if (id == MQTTSN_TOPIC_NONE || last.ptr == topic) return MQTTSN_TOPIC_NONE;
+    TopicSpan device = topic_prev_segment(topic, last.ptr - 1);
+    if (device.len == 0 || device.ptr == topic || device.ptr - 1 == topic) return MQTTSN_TOPIC_NONE;
+    return id;
+}
+
+bool mqttsn_topic_name(uint16_t topic_id, const char* root, const char* device,
+                       char* buf, size_t len, const char* const* channels,
+                       size_t channel_count) {
+    if (topic_id >= MQTTSN_TOPIC_CHANNEL_BASE) {
+        size_t ch = (size_t)(topic_id - MQTTSN_TOPIC_CHANNEL_BASE) / 2;
+        if (ch >= channel_count) return false;
+        build_channel_topic(root, device, channels[ch],
+                            (topic_id & 1) ? "humidity" : "temperature", buf, len);
+        return true;
+    }
+    if (topic_id == MQTTSN_TOPIC_NONE || topic_id >= MQTTSN_TOPIC_COUNT) return false;
+    build_topic(root, device, kTopicSuffixes[topic_id], buf, len);
+    return true;
+}
+
+// -- Client ───────────────────────────────────────────────────────────────────
+
+void mqttsn_client_init(MqttSnClient& c, const MqttSnTransport& io) {
+    memset(&c, 0, sizeof(c));
+    c.io          = io;
+    c.next_msg_id = 1;
+}
+
+static bool client_send(MqttSnClient& c, const uint8_t* data, size_t len) {
+    if (len == 0 || !c.io.send(c.io.ctx, data, len)) return false;
+    c.datagrams++;
+    return true;
+}
+
+// Waits for a reply of the given type; stray datagrams are skipped.
+static size_t client_await(MqttSnClient& c, uint8_t type, uint8_t* buf, size_t cap,
+                           uint32_t timeout_ms) {
+    for (int i = 0; i < MQTTSN_STRAY_LIMIT; i++) {
+        size_t n = c.io.recv(c.io.ctx, buf, cap, timeout_ms);
+        if (n == 0) return 0;
+        if (mqttsn_msg_type(buf, n) == type) {
+            c.round_trips++;
+            return n;
+        }
+    }
+    return 0;
+}
+
+bool mqttsn_connect(MqttSnClient& c, const char* client_id, uint16_t keepalive_s,
+                    uint32_t timeout_ms, bool clean) {
+    uint8_t buf[MQTTSN_MAX_PACKET];
+    c.connected = false;
+    if (!client_send(c, buf, mqttsn_encode_connect(client_id, keepalive_s, clean, buf, sizeof(buf))))
+        return false;
+    size_t n = client_await(c, MQTTSN_CONNACK, buf, sizeof(buf), timeout_ms);
+    if (n != 3) return false;
+    c.last_rc   = buf[2];
+    c.connected = (buf[2] == MQTTSN_RC_ACCEPTED);
+    return c.connected;
+}
+
+bool mqttsn_publish(MqttSnClient& c, uint16_t topic_id, const char* payload,
+                    uint8_t qos, bool retain, uint32_t timeout_ms) {
+    if (!c.connected || topic_id == MQTTSN_TOPIC_NONE) return false;
+    uint8_t  buf[MQTTSN_MAX_PACKET];
+    uint16_t msg_id = qos ? c.next_msg_id++ : 0;
+    if (c.next_msg_id == 0) c.next_msg_id = 1;
+    size_t n = mqttsn_encode_publish(topic_id, msg_id, qos, retain,
+                                     (const uint8_t*)payload, strlen(payload), buf, sizeof(buf));
+    if (!client_send(c, buf, n)) return false;
+    if (qos == 0) return true;
+
+    n = client_await(c, MQTTSN_PUBACK, buf, sizeof(buf), timeout_ms);
+    if (n != 7 || get_u16(buf + 4) != msg_id) return false;
+    c.last_rc = buf[6];
+    return c.last_rc == MQTTSN_RC_ACCEPTED;
+}
+
+bool mqttsn_disconnect(MqttSnClient& c, uint16_t sleep_s, uint32_t timeout_ms) {
+    uint8_t buf[MQTTSN_MAX_PACKET];
+    c.connected = false;
+    if (!client_send(c, buf, mqttsn_encode_disconnect(sleep_s, buf, sizeof(buf)))) return false;
+    return client_await(c, MQTTSN_DISCONNECT, buf, sizeof(buf), timeout_ms) > 0;
+}
+
+// -- Gateway stand-in ─────────────────────────────────────────────────────────
+
+void mqttsn_gateway_init(MqttSnGatewaySim& gw, const char* root,
+                         MqttSnForwardFn forward, void* ctx) {
+    memset(&gw, 0, sizeof(gw));
+    gw.root    = root;
+    gw.forward = forward;
+    gw.ctx     = ctx;
+}
+
+size_t mqttsn_gateway_handle(MqttSnGatewaySim& gw, const uint8_t* in, size_t len,
+                             uint8_t* out, size_t cap) {
+    switch (mqttsn_msg_type(in, len)) {
+        case MQTTSN_CONNECT: {
+            if (len < 7 || in[3] != MQTTSN_PROTOCOL_ID)
+                return mqttsn_encode_connack(MQTTSN_RC_NOT_SUPPORTED, out, cap);
+            size_t id_len = len - 6;
+            if (id_len >= sizeof(gw.client_id)) id_len = sizeof(gw.client_id) - 1;
+            bool same = gw.session && strncmp(gw.client_id, (const char*)(in + 6), id_len) == 0 &&
+                        gw.client_id[id_len] == '\0';
+            memcpy(gw.client_id, in + 6, id_len);
+            gw.client_id[id_len] = '\0';
+            gw.resumed   = same && !(in[2] & MQTTSN_FLAG_CLEAN);
+            gw.session   = true;
+            gw.connected = true;
+            gw.sleep_s   = 0;
+            return mqttsn_encode_connack(MQTTSN_RC_ACCEPTED, out, cap);
+        }
+        case MQTTSN_PUBLISH: {
+            MqttSnPublish p;
+            if (!mqttsn_decode_publish(in, len, p)) return 0;
+            char topic[128];
+            uint8_t rc = MQTTSN_RC_ACCEPTED;
+            if (!gw.connected) {
+                rc = MQTTSN_RC_NOT_SUPPORTED;
+            } else if (!mqttsn_topic_name(p.topic_id, gw.root, gw.client_id, topic, sizeof(topic),
+                                         gw.channels, gw.channel_count)) {
+                rc = MQTTSN_RC_INVALID_TOPIC;
+            } else {
+                char payload[MQTTSN_MAX_PACKET];
+                memcpy(payload, p.data, p.len);
+                payload[p.len] = '\0';
+                gw.publishes++;
+                if (gw.forward) gw.forward(gw.ctx, topic, payload, p.retain);
+            }
+            if (p.qos == 0 && rc == MQTTSN_RC_ACCEPTED) return 0;
+            return mqttsn_encode_puback(p.topic_id, p.msg_id, rc, out, cap);
+        }
+        case MQTTSN_DISCONNECT:
+            gw.connected = false;
+            gw.sleep_s   = (len == 4) ? get_u16(in + 2) : 0;
+            gw.session   = gw.sleep_s > 0;
+            return mqttsn_encode_disconnect(0, out, cap);
+        default:
+            return 0;
+    }
+}
+
+#ifndef NATIVE_TEST
+
+#include <Arduino.h>
+#include "PowerWait.h"
+#include "RtcLayout.h"
+
+#define MQTTSN_LOCAL_PORT    10001
+#define MQTTSN_SESSION_MAGIC 0x534E5A5Au   // "SNZZ": asleep at the gateway
+
+static bool udp_send(void* ctx, const uint8_t* data, size_t len) {
+    MqttSnUdp& u = *static_cast<MqttSnUdp*>(ctx);
+    if (!u.udp.beginPacket(u.gateway, u.port)) return false;
+    u.udp.write(data, len);
+    return u.udp.endPacket() == 1;
+}
+
+static size_t udp_recv(void* ctx, uint8_t* buf, size_t cap, uint32_t timeout_ms) {
+    MqttSnUdp& u = *static_cast<MqttSnUdp*>(ctx);
+    unsigned long start = millis();
+    while (millis() - start < timeout_ms) {
+        int n = u.udp.parsePacket();
+        if (n > 0) {
+            if (u.udp.remoteIP() != u.gateway) continue;  // next parsePacket() drops it
+            return (size_t)u.udp.read(buf, cap);
+        }
+        power_wait(1, WAIT_NETWORK);
+    }
+    return 0;
+}
+
+bool mqttsn_udp_begin(MqttSnUdp& u, const char* host, uint16_t port) {
+    if (!WiFi.hostByName(host, u.gateway)) return false;
+    u.port = port;
+    return u.udp.begin(MQTTSN_LOCAL_PORT) == 1;
+}
+
+MqttSnTransport mqttsn_udp_transport(MqttSnUdp& u) {
+    MqttSnTransport io = { udp_send, udp_recv, &u };
+    return io;
+}
+
+bool mqttsn_session_held() {
+    uint32_t marker = 0;
+    ESP.rtcUserMemoryRead(RTC_BLOCK_MQTTSN, &marker, sizeof(marker));
+    return marker == MQTTSN_SESSION_MAGIC;
+}
+
+void mqttsn_session_record(bool held) {
+    uint32_t marker = held ? MQTTSN_SESSION_MAGIC : 0;
+    ESP.rtcUserMemoryWrite(RTC_BLOCK_MQTTSN, &marker, sizeof(marker));
+}
+
+#endif // NATIVE_TEST
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// MQTT-SN v1.2 over UDP: the subset a sleeping sensor needs.
+// CONNECT/CONNACK, PUBLISH to predefined topic IDs (no REGISTER round
+// trips), PUBACK for QoS 1, and DISCONNECT with a sleep duration so the
+// gateway treats the client as asleep rather than lost. The next wake
+// CONNECTs without CleanSession and so resumes that session; only a wake
+// that follows no acknowledged sleeping DISCONNECT starts a clean one.
+//
+// Topic IDs are fixed per client and cover the build_topic /
+// build_telemetry_topic layout. A gateway needs one predefined entry per
+// device and ID; mqttsn_topic_name() produces the topic names, e.g. for the
+// Paho MQTT-SN gateway's predefinedTopic.conf:
+//   esp-a1b2c3, devices/esp-a1b2c3/status, 1
+// Named sensor channels (telemetry/{channel}/{metric}) get IDs from
+// MQTTSN_TOPIC_CHANNEL_BASE up, two per channel in configuration order, so
+// client and gateway must be given the same channel list.
+//
+// Codec, client state machine and a gateway stand-in have no Arduino
+// dependencies — unit-tested in the native env and reused by tools/mqttsn_gateway.
+
+#define MQTTSN_DEFAULT_PORT   10000
+#define MQTTSN_MAX_PACKET     255   // single-byte length form only
+#define MQTTSN_PUBLISH_HEADER 7
+
+enum MqttSnMsgType {
+    MQTTSN_CONNECT    = 0x04,
+    MQTTSN_CONNACK    = 0x05,
+    MQTTSN_PUBLISH    = 0x0C,
+    MQTTSN_PUBACK     = 0x0D,
+    MQTTSN_DISCONNECT = 0x18
+};
+
+enum MqttSnReturnCode {
+    MQTTSN_RC_ACCEPTED        = 0,
+    MQTTSN_RC_CONGESTION      = 1,
+    MQTTSN_RC_INVALID_TOPIC   = 2,
+    MQTTSN_RC_NOT_SUPPORTED   = 3
+};
+
+// Predefined topic IDs, relative to {root}/{device}/
+enum MqttSnTopicId {
+    MQTTSN_TOPIC_NONE        = 0,
+    MQTTSN_TOPIC_STATUS      = 1,  // status
+    MQTTSN_TOPIC_TEMPERATURE = 2,  // telemetry/temperature
+    MQTTSN_TOPIC_HUMIDITY    = 3,  // telemetry/humidity
+    MQTTSN_TOPIC_VOLTAGE     = 4,  // telemetry/voltage
+    MQTTSN_TOPIC_LOG         = 5,  // log
+    MQTTSN_TOPIC_RSSI        = 6,  // telemetry/rssi
+    MQTTSN_TOPIC_TX_POWER    = 7,  // telemetry/tx_power
+    MQTTSN_TOPIC_FAULT       = 8,  // fault
+    MQTTSN_TOPIC_COUNT
+};
+
+#define MQTTSN_TOPIC_CHANNEL_BASE 16  // + 2*channel: temperature, +1: humidity
+
+struct MqttSnPublish {
+    uint16_t       topic_id;
+    uint16_t       msg_id;
+    uint8_t        qos;      // 0 or 1
+    bool           retain;
+    const uint8_t* data;     // points into the decoded packet
+    size_t         len;
+};
+
+// -- Codec ────────────────────────────────────────────────────────────────────
+
+size_t mqttsn_encode_connect(const char* client_id, uint16_t keepalive_s, bool clean,
+                             uint8_t* buf, size_t cap);
+size_t mqttsn_encode_connack(uint8_t rc, uint8_t* buf, size_t cap);
+size_t mqttsn_encode_publish(uint16_t topic_id, uint16_t msg_id, uint8_t qos, bool retain,
+                             const uint8_t* data, size_t len, uint8_t* buf, size_t cap);
+size_t mqttsn_encode_puback(uint16_t topic_id, uint16_t msg_id, uint8_t rc,
+                            uint8_t* buf, size_t cap);
+size_t mqttsn_encode_disconnect(uint16_t sleep_s, uint8_t* buf, size_t cap);
+// sleep_s = 0 omits the Duration field (plain disconnect).
+// All encoders return the packet length, or 0 if it does not fit in cap
+// (or exceeds MQTTSN_MAX_PACKET).
+
+uint8_t mqttsn_msg_type(const uint8_t* buf, size_t len);
+// MsgType of a well-formed packet (Length field matches len), else 0.
+
+bool mqttsn_decode_publish(const uint8_t* buf, size_t len, MqttSnPublish& out);
+// Accepts predefined-topic PUBLISH at QoS 0 or 1 only.
+
+// -- Topic mapping ────────────────────────────────────────────────────────────
+
+uint16_t mqttsn_topic_id(const char* topic, const char* const* channels = nullptr,
+                         size_t channel_count = 0);
+// Maps a topic built by build_topic / build_telemetry_topic /
+// build_channel_topic to its predefined ID. Channel topics resolve only for
+// names in channels[]. MQTTSN_TOPIC_NONE for anything else.
+
+bool mqttsn_topic_name(uint16_t topic_id, const char* root, const char* device,
+                       char* buf, size_t len, const char* const* channels = nullptr,
+                       size_t channel_count = 0);
+// Inverse of mqttsn_topic_id. Returns false for unknown IDs.
+
+// -- Client ───────────────────────────────────────────────────────────────────
+
+// Datagram seam — WiFiUDP on the device, the gateway stand-in in native tests.
+struct MqttSnTransport {
+    bool   (*send)(void* ctx, const uint8_t* data, size_t len);
+    size_t (*recv)(void* ctx, uint8_t* buf, size_t cap, uint32_t timeout_ms);
+    // Returns the next datagram's length, or 0 once timeout_ms passes.
+    void*  ctx;
+};
+
+struct MqttSnClient {
+    MqttSnTransport io;
+    uint16_t next_msg_id;
+    bool     connected;
+    uint8_t  last_rc;      // MqttSnReturnCode from the last CONNACK/PUBACK
+    uint16_t datagrams;    // sent since init
+    uint16_t round_trips;  // request/response exchanges completed since init
+    const char* const* channels;   // sensor channel names for topic mapping
+    uint8_t            channel_count;
+};
+
+void mqttsn_client_init(MqttSnClient& c, const MqttSnTransport& io);
+
+bool mqttsn_connect(MqttSnClient& c, const char* client_id, uint16_t keepalive_s,
+                    uint32_t timeout_ms, bool clean = true);
+// No will. clean = false wakes a sleeping client back into the session its
+// last DISCONNECT left on the gateway. One round trip; false on timeout or
+// rejection.
+
+bool mqttsn_publish(MqttSnClient& c, uint16_t topic_id, const char* payload,
+                    uint8_t qos, bool retain, uint32_t timeout_ms);
+// QoS 0 returns once the datagram is handed over; QoS 1 waits for PUBACK.
+
+bool mqttsn_disconnect(MqttSnClient& c, uint16_t sleep_s, uint32_t timeout_ms);
+// Sleeping-client DISCONNECT: the gateway keeps the session for sleep_s
+// seconds. Waits for the gateway's DISCONNECT; connected is cleared either way.
+
+// -- Gateway stand-in ─────────────────────────────────────────────────────────
+
+typedef void (*MqttSnForwardFn)(void* ctx, const char* topic, const char* payload,
+                                bool retain);
+
+struct MqttSnGatewaySim {
+    const char*     root;          // topic root for predefined IDs
+    char            client_id[32]; // from the last CONNECT
+    bool            connected;
+    uint16_t        sleep_s;       // from the last sleeping DISCONNECT, 0 = awake
+    bool            session;       // held: connected, or asleep after a sleeping DISCONNECT
+    bool            resumed;       // the last CONNECT picked up a held session
+    uint32_t        publishes;
+    MqttSnForwardFn forward;       // may be nullptr
+    void*           ctx;
+    const char* const* channels;   // same list as the client's, may be nullptr
+    uint8_t            channel_count;
+};
+
+void mqttsn_gateway_init(MqttSnGatewaySim& gw, const char* root,
+                         MqttSnForwardFn forward, void* ctx);
+
+size_t mqttsn_gateway_handle(MqttSnGatewaySim& gw, const uint8_t* in, size_t len,
+                             uint8_t* out, size_t cap);
+// Handles one datagram from the client. PUBLISHes to known IDs are forwarded
+// as {root}/{client_id}/... A sleeping DISCONNECT keeps the session; a
+// CONNECT without CleanSession from the same client resumes it, any other
+// CONNECT starts a new one. Returns the reply length (0 = no reply).
+
+#ifndef NATIVE_TEST
+
+#include <ESP8266WiFi.h>
+#include <WiFiUdp.h>
+
+struct MqttSnUdp {
+    WiFiUDP   udp;
+    IPAddress gateway;
+    uint16_t  port;
+};
+
+bool mqttsn_udp_begin(MqttSnUdp& u, const char* host, uint16_t port);
+// Resolves host and opens a local UDP port. False if the name does not resolve.
+
+MqttSnTransport mqttsn_udp_transport(MqttSnUdp& u);
+
+bool mqttsn_session_held();
+// True if the previous wake ended with an acknowledged sleeping DISCONNECT
+// (RTC_BLOCK_MQTTSN), so this wake should CONNECT with clean = false.
+
+void mqttsn_session_record(bool held);
+// Sets the marker: true after an acknowledged sleeping DISCONNECT, false
+// once a CONNECT has been accepted.
+
+#endif // NATIVE_TEST
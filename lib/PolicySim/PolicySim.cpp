@@ -0,0 +1,139 @@
+#include "PolicySim.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "utils.h"
+
+static const char* const kStatusNames[4] = { "OK", "NOK", "BAT_LOW", "BAT_CRIT" };
+
+void policy_default_energy_model(EnergyModel& model) {
+    model.supply_v        = 3.7f;
+    model.boot_ms         = 250.0f;
+    model.wifi_connect_ms = 3000.0f;
+    model.read_gap_ms     = 1000.0f;
+    model.mqtt_ms         = 400.0f;
+    model.active_ma       = 75.0f;
+    model.continuation_ms = 40.0f;
+    model.continuation_ma = 15.0f;
+    model.sleep_ma        = 0.15f;
+}
+
+void policy_default(Policy& policy) {
+    snprintf(policy.name, sizeof(policy.name), "firmware");
+    config_apply_defaults(policy.cfg);
+    policy.num_reads = 3;
+}
+
+bool policy_parse(const char* spec, Policy& policy) {
+    policy_default(policy);
+    const char* colon = strchr(spec, ':');
+    if (!colon || colon == spec) return false;
+    size_t name_len = (size_t)(colon - spec);
+    if (name_len >= sizeof(policy.name)) name_len = sizeof(policy.name) - 1;
+    memcpy(policy.name, spec, name_len);
+    policy.name[name_len] = '\0';
+
+    Config& c = policy.cfg;
+    int n = sscanf(colon + 1, "%d,%d,%d,%f,%f,%d",
+                   &c.sleep_normal_s, &c.sleep_low_battery_s, &c.sleep_critical_battery_s,
+                   &c.battery_low_v, &c.battery_critical_v, &policy.num_reads);
+    if (n < 1 && colon[1] != '\0') return false;
+    return c.sleep_normal_s > 0 && policy.num_reads > 0;
+}
+
+static float quantize_0_1(float v) {
+    return roundf(v * 10.0f) / 10.0f;
+}
+
+// Sample-and-hold reconstruction error against the last published values
+struct ErrorAcc {
+    double temp_sq;
+    double hum_sq;
+    double temp_max;
+    size_t count;
+
+    void add(const TraceSample& s, float pub_temp, float pub_hum) {
+        if (isnan(s.temp) || isnan(s.hum)) return;
+        double dt = s.temp - pub_temp;
+        double dh = s.hum  - pub_hum;
+        temp_sq += dt * dt;
+        hum_sq  += dh * dh;
+        if (fabs(dt) > temp_max) temp_max = fabs(dt);
+        count++;
+    }
+};
+
+void policy_simulate(const TraceSample* trace, size_t count,
+                     const Policy& policy, const EnergyModel& model,
+                     PolicyResult& result) {
+    memset(&result, 0, sizeof(result));
+    if (count == 0) return;
+
+    const Config& cfg = policy.cfg;
+    const double full_awake_s = (model.boot_ms + model.wifi_connect_ms + model.mqtt_ms
+                                 + (policy.num_reads - 1) * model.read_gap_ms) / 1000.0;
+    const double cont_awake_s = model.continuation_ms / 1000.0;
+
+    double active_mas = 0.0;  // mA·s
+    double cont_mas   = 0.0;
+
+    bool     have_pub = false;
+    float    pub_temp = 0.0f;
+    float    pub_hum  = 0.0f;
+    ErrorAcc err      = {};
+
+    size_t scored = 0;      // next sample to score against the held value
+    size_t cursor = 0;      // last sample at or before the current wake
+    double t     = trace[0].t_s;
+    double t_end = trace[count - 1].t_s;
+
+    while (t <= t_end) {
+        // Score samples that fell before this wake against the held value
+        for (; scored < count && trace[scored].t_s < t; scored++) {
+            if (have_pub) err.add(trace[scored], pub_temp, pub_hum);
+        }
+        while (cursor + 1 < count && trace[cursor + 1].t_s <= t) cursor++;
+        const TraceSample& s = trace[cursor];
+
+        // Full publish cycle
+        bool sensor_ok = !isnan(s.temp) && !isnan(s.hum);
+        const char* status = cycle_status_str(s.battery_v, cfg.battery_low_v,
+                                              cfg.battery_critical_v, sensor_ok);
+        for (int i = 0; i < 4; i++) {
+            if (strcmp(status, kStatusNames[i]) == 0) result.status_counts[i]++;
+        }
+        if (sensor_ok) {
+            pub_temp = quantize_0_1(s.temp);
+            pub_hum  = quantize_0_1(s.hum);
+            have_pub = true;
+            result.publishes++;
+        }
+        result.full_wakes++;
+        result.awake_s += full_awake_s;
+        active_mas     += full_awake_s * model.active_ma;
+        t              += full_awake_s;
+
+        // Chained sleep — same segmentation as sleep_chained()
+        uint32_t remaining = (uint32_t)config_sleep_for_battery(cfg, s.battery_v);
+        t += sleep_next_chunk(remaining, SLEEP_MAX_S);
+        while (remaining > 0) {
+            result.continuation_wakes++;
+            result.awake_s += cont_awake_s;
+            cont_mas       += cont_awake_s * model.continuation_ma;
+            t              += cont_awake_s + sleep_next_chunk(remaining, SLEEP_MAX_S);
+        }
+    }
+
+    for (; scored < count; scored++) {
+        if (have_pub) err.add(trace[scored], pub_temp, pub_hum);
+    }
+
+    result.simulated_s = t - trace[0].t_s;
+    double sleep_s     = result.simulated_s - result.awake_s;
+    double total_mas   = active_mas + cont_mas + (sleep_s > 0 ? sleep_s : 0) * model.sleep_ma;
+    result.energy_j       = total_mas / 1000.0 * model.supply_v;
+    result.avg_current_ma = result.simulated_s > 0 ? total_mas / result.simulated_s : 0.0;
+    result.temp_rmse      = err.count ? sqrt(err.temp_sq / err.count) : 0.0;
+    result.hum_rmse       = err.count ? sqrt(err.hum_sq  / err.count) : 0.0;
+    result.temp_max_err   = err.temp_max;
+}
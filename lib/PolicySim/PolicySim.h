@@ -0,0 +1,69 @@
+#pragma once
+
+// Trace-driven replay of the firmware's reporting policy. Feeds recorded
+// temperature / humidity / battery samples through the same decision logic
+// setup() uses (config_sleep_for_battery, cycle_status_str, chained sleep
+// segments) and estimates radio sessions, energy and reconstruction error.
+// No Arduino dependencies — native envs only.
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ConfigManager.h"
+
+struct TraceSample {
+    uint32_t t_s;        // seconds since trace start, strictly increasing
+    float    temp;       // °C, NaN = sensor read fails at this time
+    float    hum;        // %RH
+    float    battery_v;
+};
+
+struct Policy {
+    char   name[32];
+    Config cfg;          // sleep_* and battery_* fields are used
+    int    num_reads;    // NUM_READS
+};
+
+// Per-phase durations and currents. Defaults are typical ESP8266 datasheet
+// figures for a D1 mini + battery shield at full TX power — replace them
+// with measurements from your own hardware for absolute numbers.
+struct EnergyModel {
+    float supply_v;
+    float boot_ms;            // ROM + SDK + config load
+    float wifi_connect_ms;    // association + DHCP
+    float read_gap_ms;        // between DHT reads (NUM_READS - 1 gaps)
+    float mqtt_ms;            // connect + publish + disconnect
+    float active_ma;          // radio on
+    float continuation_ms;    // chained-sleep continuation wake, RF disabled
+    float continuation_ma;
+    float sleep_ma;           // deep sleep, whole board
+};
+
+struct PolicyResult {
+    uint32_t full_wakes;        // full publish cycles = radio sessions
+    uint32_t continuation_wakes;
+    uint32_t publishes;         // cycles where temp/hum were published
+    uint32_t status_counts[4];  // OK, NOK, BAT_LOW, BAT_CRIT
+    double   awake_s;
+    double   energy_j;
+    double   avg_current_ma;
+    double   temp_rmse;         // published (sample-and-hold) vs ground truth
+    double   hum_rmse;
+    double   temp_max_err;
+    double   simulated_s;
+};
+
+void policy_default_energy_model(EnergyModel& model);
+
+void policy_default(Policy& policy);
+// config_apply_defaults() + NUM_READS 3, named "firmware".
+
+bool policy_parse(const char* spec, Policy& policy);
+// "name:normal_s,low_s,crit_s,low_v,crit_v,num_reads" — any trailing fields
+// may be omitted and keep the firmware defaults.
+
+void policy_simulate(const TraceSample* trace, size_t count,
+                     const Policy& policy, const EnergyModel& model,
+                     PolicyResult& result);
+// Replays wakes from trace[0].t_s until the end of the trace. Sensor
+// readings are ground truth at the wake instant (last sample at or before
+// it) rounded to the 0.1 resolution of the published payload.
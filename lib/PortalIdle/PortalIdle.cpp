@@ -0,0 +1,31 @@
+#include "PortalIdle.h"
+#include <string.h>
+
+void portal_duty_begin(PortalDuty& d) {
+    memset(&d, 0, sizeof(d));
+}
+
+uint32_t portal_idle_ms(const PortalDuty& d, uint8_t stations, uint32_t now_ms) {
+    if (stations == 0) return PORTAL_IDLE_EMPTY_MS;
+    if (d.any_busy && now_ms - d.last_busy_ms < PORTAL_ACTIVE_HOLD_MS) return 0;
+    return PORTAL_IDLE_QUIET_MS;
+}
+
+void portal_duty_poll(PortalDuty& d, uint32_t poll_us, uint32_t now_ms) {
+    d.polls++;
+    if (poll_us < PORTAL_BUSY_POLL_US) return;
+    d.busy_polls++;
+    d.last_busy_ms = now_ms;
+    d.any_busy     = true;
+}
+
+void portal_duty_idle(PortalDuty& d, uint32_t slept_ms, uint32_t total_ms) {
+    d.idle_ms += slept_ms;
+    d.total_ms = total_ms;
+}
+
+uint8_t portal_duty_idle_pct(const PortalDuty& d) {
+    if (d.total_ms == 0) return 0;
+    uint32_t idle = d.idle_ms < d.total_ms ? d.idle_ms : d.total_ms;
+    return (uint8_t)((uint64_t)idle * 100 / d.total_ms);
+}
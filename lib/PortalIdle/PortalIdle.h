@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+
+// Idle policy for the captive portal loop. The portal can run for up to
+// 10 minutes on battery with nobody connected; a tight process()/yield()
+// loop keeps the CPU busy the whole time. Between polls the loop now
+// sleeps for as long as nothing can be waiting for it:
+//
+//   no station associated           PORTAL_IDLE_EMPTY_MS   nobody can send a request
+//   station, quiet                  PORTAL_IDLE_QUIET_MS   first request waits <= this
+//   station, request within HOLD    0 (yield only)         page loads run as before
+//
+// A poll counts as activity when process() took PORTAL_BUSY_POLL_US or more,
+// i.e. it served DNS or HTTP. AP mode cannot use modem sleep (the AP has to
+// beacon), so the CPU idle time and a lower TX power are the levers.
+
+#define PORTAL_IDLE_EMPTY_MS   100
+#define PORTAL_IDLE_QUIET_MS   20
+#define PORTAL_ACTIVE_HOLD_MS  3000
+#define PORTAL_BUSY_POLL_US    2000
+#define PORTAL_TX_QDBM         40     // 10 dBm: the user is next to the device
+
+struct PortalDuty {
+    uint32_t idle_ms;       // slept between polls
+    uint32_t total_ms;      // since portal_duty_begin
+    uint32_t polls;
+    uint32_t busy_polls;    // polls that served a request
+    uint32_t last_busy_ms;  // loop time of the latest busy poll
+    bool     any_busy;
+};
+
+void portal_duty_begin(PortalDuty& d);
+
+uint32_t portal_idle_ms(const PortalDuty& d, uint8_t stations, uint32_t now_ms);
+// Sleep before the next poll, per the table above.
+
+void portal_duty_poll(PortalDuty& d, uint32_t poll_us, uint32_t now_ms);
+// Records one process() call of poll_us.
+
+void portal_duty_idle(PortalDuty& d, uint32_t slept_ms, uint32_t total_ms);
+// Records a sleep and the elapsed portal time.
+
+uint8_t portal_duty_idle_pct(const PortalDuty& d);
+// Share of portal time spent asleep between polls, 0..100.
+// No Arduino dependencies — unit-tested in the native env.
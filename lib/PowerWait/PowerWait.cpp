@@ -0,0 +1,107 @@
+// Policy and slicing have no Arduino dependencies — compiled on all
+// platforms; the sleep calls are device-only.
+#include "PowerWait.h"
+#include "LedIndicator.h"
+
+static const char* const kModeNames[WAIT_MODE_COUNT] = {
+    "default", "auto-light", "light"
+};
+
+WaitMode power_wait_mode(WaitReason reason, bool associated) {
+    switch (reason) {
+    case WAIT_RETRY_GAP:
+    case WAIT_SENSOR_GAP:
+        return associated ? WAIT_MODE_AUTO_LIGHT : WAIT_MODE_DEFAULT;
+    case WAIT_RADIO_OFF:
+        return WAIT_MODE_LIGHT;
+    default:
+        return WAIT_MODE_DEFAULT;
+    }
+}
+
+uint32_t power_wait_slice_ms(uint32_t remaining_ms, uint32_t led_next_ms, bool& light) {
+    uint32_t slice = remaining_ms;
+    if (led_next_ms < slice) slice = led_next_ms;
+    if (slice > POWER_LIGHT_MAX_MS) slice = POWER_LIGHT_MAX_MS;
+    light = slice >= POWER_LIGHT_MIN_MS;
+    if (slice == 0 && remaining_ms > 0) slice = 1;  // LED step due now: let timer1 fire
+    return slice;
+}
+
+const char* power_wait_mode_name(WaitMode mode) {
+    return mode < WAIT_MODE_COUNT ? kModeNames[mode] : "?";
+}
+
+#ifndef NATIVE_TEST
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <user_interface.h>
+#include "Log.h"
+
+static uint32_t wait_ms[WAIT_MODE_COUNT];
+static uint32_t light_slices = 0;
+static WaitMode sleep_type   = WAIT_MODE_DEFAULT;  // last applied; DEFAULT = SDK untouched
+static bool     radio_off    = false;
+
+static void apply_sleep_type(WaitMode mode) {
+    if (mode == sleep_type) return;
+    WiFi.setSleepMode(mode == WAIT_MODE_AUTO_LIGHT ? WIFI_LIGHT_SLEEP : WIFI_MODEM_SLEEP);
+    sleep_type = mode;
+}
+
+static void power_wake_cb() {}
+
+// Forced light sleep needs the radio in the NULL opmode; the timer is the
+// only wake source. The SDK enters sleep once this task idles in delay().
+static void light_sleep_ms(uint32_t ms) {
+    if (!radio_off) {
+        WiFi.mode(WIFI_OFF);
+        WiFi.forceSleepBegin();
+        radio_off = true;
+    }
+    wifi_fpm_set_sleep_type(LIGHT_SLEEP_T);
+    wifi_fpm_open();
+    wifi_fpm_set_wakeup_cb(power_wake_cb);
+    wifi_fpm_do_sleep(ms * 1000UL);
+    delay(ms + 1);
+    wifi_fpm_close();
+}
+
+void power_wait(uint32_t ms, WaitReason reason) {
+    if (ms == 0) return;
+    WaitMode mode = power_wait_mode(reason, !radio_off && WiFi.status() == WL_CONNECTED);
+    wait_ms[mode] += ms;
+    if (mode != WAIT_MODE_LIGHT) {
+        apply_sleep_type(mode);
+        delay(ms);
+        apply_sleep_type(WAIT_MODE_DEFAULT);
+        return;
+    }
+    for (uint32_t left = ms; left > 0; ) {
+        bool     light;
+        uint32_t slice = power_wait_slice_ms(left, led_next_change_ms(), light);
+        if (light) {
+            led_hold();
+            light_sleep_ms(slice);
+            led_release(slice);
+            light_slices++;
+        } else {
+            delay(slice);
+        }
+        left -= slice;
+    }
+}
+
+void power_wait_report() {
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+    LOG_I("[Power] Waits:");
+    for (uint8_t i = 0; i < WAIT_MODE_COUNT; i++) {
+        if (wait_ms[i] == 0) continue;
+        LOG_I(" %s=%lums", kModeNames[i], (unsigned long)wait_ms[i]);
+    }
+    LOG_I(" | %lu light sleep slices\n", (unsigned long)light_slices);
+#endif
+}
+
+#endif // NATIVE_TEST
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+
+// Central wait primitive for the wake cycle. Every wait loop in setup() and
+// the libraries it drives calls power_wait() with what it is waiting for;
+// the reason decides how far the chip may power down meanwhile:
+//
+//   reason       waiting for                        mode
+//   ASSOCIATION  AP join, DHCP                      DEFAULT     SDK default (modem sleep)
+//   NETWORK      a reply (CONNACK, MQTT-SN ack)     DEFAULT     SDK default (modem sleep)
+//   RETRY_GAP    time only, still associated        AUTO_LIGHT  CPU sleeps between beacons too
+//   SENSOR_GAP   DHT settle time, associated        AUTO_LIGHT  SDK timers still wake it
+//   CAPTURE      a DHT conversion on the wire       DEFAULT     CPU timestamps the edges
+//   RADIO_OFF    LED time only, radio done          LIGHT       forced light sleep
+//
+// AUTO_LIGHT waits without an association run as DEFAULT: automatic light
+// sleep needs an AP's DTIM to wake for, and ESP-NOW needs the radio. The
+// first DEFAULT wait after an AUTO_LIGHT one puts modem sleep back, so
+// association and reply waits always run exactly as the SDK would. An
+// AUTO_LIGHT wait puts modem sleep back as it returns, so whatever follows
+// it (a CONNECT, a DHT capture) never runs with light sleep enabled.
+// Forced light sleep stops the CPU, timer1 and the SDK timers, so it is
+// used only once the radio is no longer needed and no DHT conversion runs.
+// A LIGHT wait sleeps in slices ending at the LED's next step and steps the
+// LED by hand in between, so the pattern keeps its timing.
+
+#define POWER_LIGHT_MIN_MS  10      // shorter slices are not worth the sleep entry/exit
+#define POWER_LIGHT_MAX_MS  60000   // well under the 268 s wifi_fpm_do_sleep() limit
+
+enum WaitReason {
+    WAIT_ASSOCIATION,
+    WAIT_NETWORK,
+    WAIT_RETRY_GAP,
+    WAIT_SENSOR_GAP,
+    WAIT_SENSOR_CAPTURE,
+    WAIT_RADIO_OFF,
+    WAIT_REASON_COUNT
+};
+
+enum WaitMode {
+    WAIT_MODE_DEFAULT,     // delay() with WIFI_MODEM_SLEEP, the SDK's STA default
+    WAIT_MODE_AUTO_LIGHT,  // delay() with WIFI_LIGHT_SLEEP (automatic light sleep)
+    WAIT_MODE_LIGHT,       // forced light sleep, radio off
+    WAIT_MODE_COUNT
+};
+
+WaitMode power_wait_mode(WaitReason reason, bool associated);
+// Mode for reason, per the table above.
+
+uint32_t power_wait_slice_ms(uint32_t remaining_ms, uint32_t led_next_ms, bool& light);
+// Next slice of a LIGHT wait: up to the LED's next step (LED_NO_CHANGE when
+// no pattern runs), at most POWER_LIGHT_MAX_MS. light is false for slices
+// under POWER_LIGHT_MIN_MS, which are delay()ed with timer1 running. Never
+// 0 while remaining_ms > 0.
+
+const char* power_wait_mode_name(WaitMode mode);
+// No Arduino dependencies — unit-tested in the native env.
+
+#ifndef NATIVE_TEST
+
+void power_wait(uint32_t ms, WaitReason reason);
+// Waits ms in the mode power_wait_mode() picks. Feeds the watchdog like
+// delay(). A LIGHT wait turns the radio off for the rest of the wake; the
+// next deep sleep wake starts it again. millis() does not advance while in
+// light sleep.
+
+void power_wait_report();
+// Prints the time waited per mode and the light sleep slices to Serial
+// (LOG_LEVEL INFO and above).
+
+#endif // NATIVE_TEST
@@ -0,0 +1,34 @@
+#pragma once
+
+// ESP8266 RTC user memory map. 128 blocks of 4 bytes (512 bytes) that survive
+// deep sleep but not power loss or a flash. ESP.rtcUserMemoryRead/Write take
+// offsets in blocks, not bytes. Every RTC user goes through this table so
+// regions never overlap.
+
+#define RTC_BLOCK_SIZE      4
+#define RTC_BLOCKS_TOTAL    128
+
+#define RTC_BLOCK_SLEEP     0   // 2 blocks: SLEEP_MAGIC, remaining seconds (main.cpp)
+#define RTC_BLOCKS_SLEEP    2
+
+#define RTC_BLOCK_EVENT_LOG (RTC_BLOCK_SLEEP + RTC_BLOCKS_SLEEP)   // EventLog (Log.h)
+#define RTC_BLOCKS_EVENT_LOG 51
+
+#define RTC_BLOCK_TX_POWER  (RTC_BLOCK_EVENT_LOG + RTC_BLOCKS_EVENT_LOG)   // TxPowerState (TxPower.h)
+#define RTC_BLOCKS_TX_POWER 2
+
+#define RTC_BLOCK_WIFI_CACHE (RTC_BLOCK_TX_POWER + RTC_BLOCKS_TX_POWER)   // WifiCache (WifiStore.h)
+#define RTC_BLOCKS_WIFI_CACHE 14
+
+#define RTC_BLOCK_BOOT_GUARD (RTC_BLOCK_WIFI_CACHE + RTC_BLOCKS_WIFI_CACHE)   // BootGuardState (BootGuard.h)
+#define RTC_BLOCKS_BOOT_GUARD 5
+
+#define RTC_BLOCK_SEQ       (RTC_BLOCK_BOOT_GUARD + RTC_BLOCKS_BOOT_GUARD)   // SeqState (SeqCounter.h)
+#define RTC_BLOCKS_SEQ      4
+
+#define RTC_BLOCK_MQTTSN    (RTC_BLOCK_SEQ + RTC_BLOCKS_SEQ)   // sleeping session marker (MqttSn.h)
+#define RTC_BLOCKS_MQTTSN   1
+
+#define RTC_BLOCKS_USED     (RTC_BLOCK_MQTTSN + RTC_BLOCKS_MQTTSN)
+
+static_assert(RTC_BLOCKS_USED <= RTC_BLOCKS_TOTAL, "RTC user memory overcommitted");
@@ -0,0 +1,101 @@
+// Counter logic and payload suffix have no Arduino dependencies — compiled
+// on all platforms; RTC and flash access are device-only.
+#include "SeqCounter.h"
+#include <stdio.h>
+#include <string.h>
+
+bool seq_restore(SeqState& st, const SeqState* flash) {
+    memset(&st, 0, sizeof(st));
+    st.magic = SEQ_MAGIC;
+    if (flash && flash->magic == SEQ_MAGIC) {
+        st.seq   = flash->checkpoint + SEQ_CHECKPOINT_EVERY;
+        st.epoch = (uint16_t)(flash->epoch + 1);
+    }
+    st.checkpoint = st.seq;
+    return true;
+}
+
+bool seq_advance(SeqState& st) {
+    st.seq++;
+    if (st.seq - st.checkpoint < SEQ_CHECKPOINT_EVERY) return false;
+    st.checkpoint = st.seq;
+    return true;
+}
+
+size_t seq_format(const SeqState& st, uint32_t up_ms, char* buf, size_t len) {
+    int n = snprintf(buf, len, ";seq=%lu;ep=%u;up=%lu", (unsigned long)st.seq,
+                     (unsigned)st.epoch, (unsigned long)up_ms);
+    return (n > 0 && (size_t)n < len) ? (size_t)n : 0;
+}
+
+// Unsigned decimal after "key=" inside payload[0..len), up to ';' or the end
+static bool seq_field(const char* payload, size_t len, const char* key, uint32_t& out) {
+    size_t klen = strlen(key);
+    for (size_t i = 0; i + klen < len; i++) {
+        if (payload[i] != ';' || memcmp(payload + i + 1, key, klen) != 0) continue;
+        size_t   j = i + 1 + klen;
+        uint64_t v = 0;
+        size_t   digits = 0;
+        while (j < len && payload[j] >= '0' && payload[j] <= '9' && digits < 10) {
+            v = v * 10 + (uint64_t)(payload[j++] - '0');
+            digits++;
+        }
+        if (digits == 0 || v > 0xFFFFFFFFull || (j < len && payload[j] != ';')) return false;
+        out = (uint32_t)v;
+        return true;
+    }
+    return false;
+}
+
+bool seq_parse(const char* payload, size_t len, SeqStamp& out) {
+    uint32_t seq, epoch, up;
+    if (!seq_field(payload, len, "seq=", seq) || !seq_field(payload, len, "ep=", epoch) ||
+        !seq_field(payload, len, "up=", up) || epoch > 0xFFFF) return false;
+    out.seq   = seq;
+    out.epoch = (uint16_t)epoch;
+    out.up_ms = up;
+    return true;
+}
+
+#ifndef NATIVE_TEST
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "Log.h"
+#include "RtcLayout.h"
+
+static_assert(sizeof(SeqState) <= RTC_BLOCKS_SEQ * RTC_BLOCK_SIZE,
+              "SeqState outgrew its RTC region");
+
+static SeqState s_seq;
+
+static void seq_checkpoint() {
+    File file = LittleFS.open("/seq.bin", "w");
+    if (!file) {
+        LOG_E("[Seq] ERROR: Failed to open /seq.bin for writing\n");
+        return;
+    }
+    file.write((const uint8_t*)&s_seq, sizeof(s_seq));
+    file.close();
+    LOG_D("[Seq] Checkpoint %lu (epoch %u)\n", (unsigned long)s_seq.seq, s_seq.epoch);
+}
+
+const SeqState& seq_next() {
+    ESP.rtcUserMemoryRead(RTC_BLOCK_SEQ, (uint32_t*)&s_seq, sizeof(s_seq));
+    bool due = false;
+    if (s_seq.magic != SEQ_MAGIC) {
+        SeqState flash;
+        File     file = LittleFS.open("/seq.bin", "r");
+        bool     have = file && file.read((uint8_t*)&flash, sizeof(flash)) == sizeof(flash);
+        if (file) file.close();
+        due = seq_restore(s_seq, have ? &flash : nullptr);
+        LOG_I("[Seq] Restored from %s: next %lu, epoch %u\n", have ? "/seq.bin" : "scratch",
+              (unsigned long)(s_seq.seq + 1), s_seq.epoch);
+    }
+    due = seq_advance(s_seq) || due;
+    ESP.rtcUserMemoryWrite(RTC_BLOCK_SEQ, (uint32_t*)&s_seq, sizeof(s_seq));
+    if (due) seq_checkpoint();
+    return s_seq;
+}
+
+#endif // NATIVE_TEST
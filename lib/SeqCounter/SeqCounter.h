@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Report sequence number that survives deep sleep, so a missing report can
+// be told apart from a longer sleep. The counter lives in RTC memory
+// (RTC_BLOCK_SEQ) and is checkpointed to /seq.bin on LittleFS every
+// SEQ_CHECKPOINT_EVERY reports.
+//
+// After a power loss the RTC copy is gone: the counter resumes at the flash
+// checkpoint plus SEQ_CHECKPOINT_EVERY, which is past any number used since
+// that checkpoint, and the epoch goes up by one so an analyser counts a
+// restart instead of a gap.
+//
+// With report.seq enabled, the status payload carries a suffix:
+//   OK;seq=412;ep=1;up=5234
+// up = ms from reset to the publish: the device's awake time (tools/seqstat
+// adds host-side receive timing).
+
+#define SEQ_MAGIC             0x53455131   // "SEQ1"
+#define SEQ_CHECKPOINT_EVERY  64           // reports between flash writes
+
+struct SeqState {
+    uint32_t magic;
+    uint32_t seq;          // last number handed out
+    uint32_t checkpoint;   // seq at the last flash write
+    uint16_t epoch;        // bumped on every restore from flash
+    uint16_t reserved;
+};
+
+struct SeqStamp {
+    uint32_t seq;
+    uint16_t epoch;
+    uint32_t up_ms;
+};
+
+bool seq_restore(SeqState& st, const SeqState* flash);
+// Rebuilds a lost RTC state from the flash checkpoint (nullptr = none: a
+// fresh counter at epoch 0). Returns true: the new epoch must be written
+// to flash right away.
+
+bool seq_advance(SeqState& st);
+// Hands out the next number (st.seq). Returns true when a flash checkpoint
+// is due; st.checkpoint is already updated.
+
+size_t seq_format(const SeqState& st, uint32_t up_ms, char* buf, size_t len);
+// Writes the payload suffix ";seq=N;ep=E;up=MS" to buf. Returns its
+// length, 0 if it does not fit.
+
+bool seq_parse(const char* payload, size_t len, SeqStamp& out);
+// Finds the seq_format suffix in a payload. False if there is none.
+// No Arduino dependencies — unit-tested in the native env and used by
+// tools/seqstat.
+
+#ifndef NATIVE_TEST
+
+const SeqState& seq_next();
+// Loads the RTC state (restoring from /seq.bin when invalid; LittleFS is
+// already mounted by config_load), advances it, saves it back and writes
+// the checkpoint when due. Call once per report.
+
+#endif // NATIVE_TEST
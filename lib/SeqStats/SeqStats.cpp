@@ -0,0 +1,113 @@
+#include "SeqStats.h"
+#include <string.h>
+
+void seq_stats_init(SeqDeviceStats& d, const char* device, size_t device_len) {
+    memset(&d, 0, sizeof(d));
+    if (device_len >= sizeof(d.device)) device_len = sizeof(d.device) - 1;
+    memcpy(d.device, device, device_len);
+}
+
+static void seq_stats_sample(SeqDeviceStats& d, uint32_t up_ms) {
+    uint32_t b = up_ms / SEQ_STATS_BUCKET_MS;
+    d.up_hist[b < SEQ_STATS_BUCKETS ? b : SEQ_STATS_BUCKETS - 1]++;
+    d.up_sum_ms += up_ms;
+    if (up_ms > d.up_max_ms) d.up_max_ms = up_ms;
+}
+
+// One receive interval covering ahead report periods
+static void seq_stats_rx_sample(SeqDeviceStats& d, uint64_t rx_ms, uint32_t ahead) {
+    if (d.period_ms == 0 || rx_ms < d.last_rx_ms) return;
+    uint64_t interval = (rx_ms - d.last_rx_ms) / ahead;
+    uint32_t delay    = 0;
+    if (interval >= d.period_ms) {
+        uint64_t past = interval - d.period_ms;
+        delay = past > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)past;
+    } else if (d.period_ms - interval > d.rx_early_ms) {
+        d.rx_early_ms = d.period_ms - (uint32_t)interval;
+    }
+    uint32_t b = delay / SEQ_STATS_BUCKET_MS;
+    d.rx_hist[b < SEQ_STATS_BUCKETS ? b : SEQ_STATS_BUCKETS - 1]++;
+    d.rx_samples++;
+    if (delay > d.rx_max_ms) d.rx_max_ms = delay;
+}
+
+SeqVerdict seq_stats_add(SeqDeviceStats& d, const SeqStamp& s, uint64_t rx_ms) {
+    SeqVerdict v;
+    if (d.received == 0 || s.epoch > d.epoch) {
+        v = (d.received == 0) ? SEQ_FIRST : SEQ_RESTART;
+        if (v == SEQ_RESTART) d.restarts++;
+        d.epoch      = s.epoch;
+        d.last       = s.seq;
+        d.window     = 1;
+        d.last_rx_ms = rx_ms;
+    } else if (s.epoch < d.epoch) {
+        d.duplicates++;
+        return SEQ_DUPLICATE;
+    } else if (s.seq > d.last) {
+        uint32_t ahead = s.seq - d.last;
+        d.window = (ahead >= SEQ_STATS_WINDOW) ? 1 : (d.window << ahead) | 1;
+        d.last   = s.seq;
+        if (rx_ms && d.last_rx_ms) seq_stats_rx_sample(d, rx_ms, ahead);
+        d.last_rx_ms = rx_ms;
+        if (ahead > 1) {
+            d.gaps++;
+            d.missing += ahead - 1;
+        }
+        v = (ahead > 1) ? SEQ_GAP : SEQ_IN_ORDER;
+    } else {
+        uint32_t behind = d.last - s.seq;
+        uint64_t bit    = (uint64_t)1 << (behind < SEQ_STATS_WINDOW ? behind : 0);
+        if (behind >= SEQ_STATS_WINDOW || (d.window & bit)) {
+            d.duplicates++;
+            return SEQ_DUPLICATE;
+        }
+        d.window |= bit;
+        d.late++;
+        d.missing--;
+        v = SEQ_LATE;
+    }
+    d.received++;
+    seq_stats_sample(d, s.up_ms);
+    return v;
+}
+
+float seq_stats_loss(const SeqDeviceStats& d) {
+    uint64_t expected = (uint64_t)d.received + d.missing;
+    return expected ? (float)d.missing / (float)expected : 0.0f;
+}
+
+static uint32_t hist_percentile(const uint32_t* hist, uint32_t samples, uint32_t max_ms,
+                                unsigned pct) {
+    if (samples == 0) return 0;
+    uint64_t rank = ((uint64_t)samples * pct + 99) / 100;  // nearest-rank
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < SEQ_STATS_BUCKETS; b++) {
+        seen += hist[b];
+        if (seen < rank) continue;
+        if (b == SEQ_STATS_BUCKETS - 1) return max_ms;
+        uint32_t edge = (b + 1) * SEQ_STATS_BUCKET_MS;
+        return edge < max_ms ? edge : max_ms;
+    }
+    return max_ms;
+}
+
+uint32_t seq_stats_up_percentile(const SeqDeviceStats& d, unsigned pct) {
+    return hist_percentile(d.up_hist, d.received, d.up_max_ms, pct);
+}
+
+uint32_t seq_stats_rx_percentile(const SeqDeviceStats& d, unsigned pct) {
+    return hist_percentile(d.rx_hist, d.rx_samples, d.rx_max_ms, pct);
+}
+
+SeqDeviceStats* seq_stats_lookup(SeqDeviceStats* table, size_t& count, size_t cap,
+                                 const char* device, size_t device_len) {
+    if (device_len >= SEQ_STATS_DEVICE_LEN) device_len = SEQ_STATS_DEVICE_LEN - 1;
+    for (size_t i = 0; i < count; i++) {
+        if (strlen(table[i].device) == device_len &&
+            memcmp(table[i].device, device, device_len) == 0) return &table[i];
+    }
+    if (count == cap) return nullptr;
+    seq_stats_init(table[count], device, device_len);
+    return &table[count++];
+}
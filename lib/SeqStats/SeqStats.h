@@ -0,0 +1,82 @@
+#pragma once
+
+// Host-side per-device report accounting for sequence-stamped status
+// payloads (SeqCounter.h). No Arduino dependencies — built by the native
+// envs only, used by tools/seqstat.
+//
+// Per device and epoch: a number above the highest seen opens a gap of the
+// numbers skipped; a skipped number arriving later is counted as late and
+// no longer missing; a number seen before is a duplicate. A new epoch (the
+// device restored its counter after a power loss) restarts the sequence
+// without counting a gap. Numbers more than SEQ_STATS_WINDOW behind, or
+// from an older epoch, are stale (e.g. a retained status replayed by the
+// broker) and counted as duplicates.
+//
+// Two timing distributions per device. "up" is the device's own reset to
+// status publish time. "rx" is host-side: the interval between receiving
+// consecutive reports, spread over any numbers skipped, minus the expected
+// period; what is left is wake-time drift plus broker transit variation.
+// Reports that arrive early are sampled as 0 and their largest lead is kept
+// separately.
+
+#include <stddef.h>
+#include <stdint.h>
+#include "SeqCounter.h"
+
+#define SEQ_STATS_WINDOW       64     // reorder window, bits of SeqDeviceStats::window
+#define SEQ_STATS_BUCKET_MS    50
+#define SEQ_STATS_BUCKETS      400    // 0..20 s; the last bucket is open-ended
+#define SEQ_STATS_DEVICE_LEN   32
+
+enum SeqVerdict {
+    SEQ_FIRST,       // first report of the device (or of a new epoch)
+    SEQ_IN_ORDER,
+    SEQ_GAP,         // in order after one or more missing numbers
+    SEQ_LATE,        // fills an earlier gap
+    SEQ_DUPLICATE,
+    SEQ_RESTART      // new epoch
+};
+
+struct SeqDeviceStats {
+    char     device[SEQ_STATS_DEVICE_LEN];
+    uint16_t epoch;
+    uint32_t last;          // highest seq seen in this epoch
+    uint64_t window;        // bit i set = last - i seen
+    uint32_t received;      // distinct reports
+    uint32_t duplicates;
+    uint32_t late;
+    uint32_t gaps;          // runs of missing numbers
+    uint32_t missing;       // numbers never received (late ones removed)
+    uint32_t restarts;
+    uint32_t up_hist[SEQ_STATS_BUCKETS];
+    uint32_t up_max_ms;
+    uint64_t up_sum_ms;
+    uint32_t period_ms;     // expected report period; 0 = rx not sampled
+    uint64_t last_rx_ms;    // host receive time of the report that set last
+    uint32_t rx_hist[SEQ_STATS_BUCKETS];  // receive interval past period_ms
+    uint32_t rx_samples;
+    uint32_t rx_max_ms;
+    uint32_t rx_early_ms;   // largest lead of an interval shorter than period_ms
+};
+
+void seq_stats_init(SeqDeviceStats& d, const char* device, size_t device_len);
+
+SeqVerdict seq_stats_add(SeqDeviceStats& d, const SeqStamp& s, uint64_t rx_ms = 0);
+// Accounts one report received at host time rx_ms (0 = unknown). up_ms is
+// sampled for distinct reports; the receive interval for in-order reports
+// of the same epoch, when period_ms is set.
+
+float seq_stats_loss(const SeqDeviceStats& d);
+// missing / (received + missing), 0 before the first report.
+
+uint32_t seq_stats_up_percentile(const SeqDeviceStats& d, unsigned pct);
+// Upper edge of the bucket holding the pct-th percentile of up_ms
+// (SEQ_STATS_BUCKET_MS resolution; up_max_ms for the open-ended bucket).
+
+uint32_t seq_stats_rx_percentile(const SeqDeviceStats& d, unsigned pct);
+// Same for the receive delay past period_ms (rx_max_ms for the open-ended
+// bucket); 0 without samples.
+
+SeqDeviceStats* seq_stats_lookup(SeqDeviceStats* table, size_t& count, size_t cap,
+                                 const char* device, size_t device_len);
+// Finds or appends the device's entry. nullptr when the table is full.
@@ -0,0 +1,190 @@
+#include "TelemetryIngest.h"
+#include <string.h>
+
+// -- Line splitting ───────────────────────────────────────────────────────────
+
+static bool parse_unix_ts(const char* s, size_t len, int64_t& ts_ns) {
+    size_t i = 0;
+    int64_t secs = 0;
+    int64_t frac = 0;
+    int64_t scale = 1000000000LL;
+    size_t digits = 0;
+    while (i < len && s[i] >= '0' && s[i] <= '9') {
+        secs = secs * 10 + (s[i] - '0');
+        i++; digits++;
+    }
+    if (digits == 0) return false;
+    if (i < len && s[i] == '.') {
+        i++;
+        while (i < len && s[i] >= '0' && s[i] <= '9') {
+            if (scale > 1) {
+                scale /= 10;
+                frac += (s[i] - '0') * scale;
+            }
+            i++;
+        }
+    }
+    if (i != len) return false;
+    ts_ns = secs * 1000000000LL + frac;
+    return true;
+}
+
+bool ingest_split_line(const char* line, size_t len, IngestMessage& msg) {
+    while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) len--;
+
+    const char* end = line + len;
+    const char* sp  = (const char*)memchr(line, ' ', len);
+    if (!sp) return false;
+
+    msg.ts_ns = 0;
+    // A leading token without '/' is a timestamp, not a topic
+    if (!memchr(line, '/', (size_t)(sp - line))) {
+        if (!parse_unix_ts(line, (size_t)(sp - line), msg.ts_ns)) return false;
+        line = sp + 1;
+        sp   = (const char*)memchr(line, ' ', (size_t)(end - line));
+        if (!sp) return false;
+    }
+
+    msg.topic       = line;
+    msg.topic_len   = (size_t)(sp - line);
+    msg.payload     = sp + 1;
+    msg.payload_len = (size_t)(end - msg.payload);
+    return msg.topic_len > 0;
+}
+
+// -- Batch decode ─────────────────────────────────────────────────────────────
+
+size_t ingest_decode_batch(const IngestMessage* msgs, size_t count, IngestRecord* out) {
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        const IngestMessage& m = msgs[i];
+        IngestRecord& r = out[n];
+        if (!parse_topic(m.topic, m.topic_len, r.topic)) continue;
+        r.payload = { m.payload, m.payload_len };
+        r.numeric = parse_decimal_payload(m.payload, m.payload_len, r.value);
+        if (r.topic.kind == TOPIC_TELEMETRY && !r.numeric) continue;
+        r.ts_ns = m.ts_ns;
+        n++;
+    }
+    return n;
+}
+
+// -- Output formatting ────────────────────────────────────────────────────────
+
+namespace {
+
+struct Writer {
+    char*  buf;
+    size_t len;
+    size_t pos;
+    bool   ok;
+
+    void put(char c) {
+        if (pos + 1 < len) buf[pos++] = c;
+        else ok = false;
+    }
+    void put(const char* s, size_t n) {
+        if (pos + n < len) { memcpy(buf + pos, s, n); pos += n; }
+        else ok = false;
+    }
+    void put(const char* s) { put(s, strlen(s)); }
+    void put(TopicSpan s)   { put(s.ptr, s.len); }
+
+    void put_i64(int64_t v) {
+        char tmp[24];
+        int  i = 0;
+        bool neg = v < 0;
+        uint64_t u = neg ? (uint64_t)(-(v + 1)) + 1 : (uint64_t)v;
+        do { tmp[i++] = (char)('0' + u % 10); u /= 10; } while (u);
+        if (neg) put('-');
+        while (i) put(tmp[--i]);
+    }
+
+    // Line protocol tag values: escape ',', '=' and ' '
+    void put_tag(TopicSpan s) {
+        for (size_t i = 0; i < s.len; i++) {
+            char c = s.ptr[i];
+            if (c == ',' || c == '=' || c == ' ') put('\\');
+            put(c);
+        }
+    }
+
+    // Line protocol string field: escape '"' and '\'
+    void put_field_str(TopicSpan s) {
+        put('"');
+        for (size_t i = 0; i < s.len; i++) {
+            char c = s.ptr[i];
+            if (c == '"' || c == '\\') put('\\');
+            put(c);
+        }
+        put('"');
+    }
+
+    // CSV cell: quoted only when it contains a separator or quote
+    void put_csv(TopicSpan s) {
+        bool quote = memchr(s.ptr, ',', s.len) || memchr(s.ptr, '"', s.len);
+        if (!quote) { put(s); return; }
+        put('"');
+        for (size_t i = 0; i < s.len; i++) {
+            if (s.ptr[i] == '"') put('"');
+            put(s.ptr[i]);
+        }
+        put('"');
+    }
+};
+
+}  // namespace
+
+size_t ingest_format_record(const IngestRecord& rec, IngestFormat fmt,
+                            char* buf, size_t len) {
+    if (len == 0) return 0;
+    Writer w = { buf, len, 0, true };
+    static const TopicSpan kStatus = { "status", 6 };
+    TopicSpan metric = (rec.topic.kind == TOPIC_STATUS) ? kStatus : rec.topic.metric;
+
+    if (fmt == INGEST_LINE_PROTOCOL) {
+        // env,root=<root>,device=<device>[,channel=<channel>] <metric>=<value> [ts]
+        w.put("env,root=");
+        w.put_tag(rec.topic.root);
+        w.put(",device=");
+        w.put_tag(rec.topic.device);
+        if (rec.topic.channel.len > 0) {
+            w.put(",channel=");
+            w.put_tag(rec.topic.channel);
+        }
+        w.put(' ');
+        w.put_tag(metric);
+        w.put('=');
+        if (rec.topic.kind == TOPIC_TELEMETRY) w.put(rec.payload);
+        else                                   w.put_field_str(rec.payload);
+        if (rec.ts_ns) {
+            w.put(' ');
+            w.put_i64(rec.ts_ns);
+        }
+    } else {
+        if (rec.ts_ns) w.put_i64(rec.ts_ns);
+        w.put(',');
+        w.put_csv(rec.topic.root);
+        w.put(',');
+        w.put_csv(rec.topic.device);
+        w.put(',');
+        if (rec.topic.channel.len > 0) {
+            // "<channel>/<metric>", contiguous in the topic
+            w.put_csv({ rec.topic.channel.ptr,
+                        (size_t)(metric.ptr + metric.len - rec.topic.channel.ptr) });
+        } else {
+            w.put_csv(metric);
+        }
+        w.put(',');
+        w.put_csv(rec.payload);
+    }
+    w.put('\n');
+
+    if (!w.ok) return 0;
+    buf[w.pos] = '\0';
+    return w.pos;
+}
+
+void ingest_format_header(IngestFormat fmt, char* buf, size_t len) {
+    snprintf(buf, len, "%s", fmt == INGEST_CSV ? "ts_ns,root,device,metric,value\n" : "");
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+// Host-side decoder for the device topic layout. No Arduino dependencies —
+// built by the native envs only; topic parsing is shared with the firmware
+// through utils.h.
+
+#include <stddef.h>
+#include <stdint.h>
+#include "utils.h"
+
+enum IngestFormat {
+    INGEST_LINE_PROTOCOL,  // InfluxDB line protocol, channel as a tag
+    INGEST_CSV             // ts_ns,root,device,metric,value; metric = channel/metric
+};
+
+struct IngestMessage {
+    const char* topic;
+    size_t      topic_len;
+    const char* payload;
+    size_t      payload_len;
+    int64_t     ts_ns;      // 0 = no timestamp (sink assigns arrival time)
+};
+
+struct IngestRecord {
+    ParsedTopic topic;
+    TopicSpan   payload;    // raw payload text, emitted verbatim
+    bool        numeric;    // payload parsed by parse_decimal_payload
+    float       value;      // valid when numeric
+    int64_t     ts_ns;
+};
+
+bool ingest_split_line(const char* line, size_t len, IngestMessage& msg);
+// Splits one "[ts] topic payload" line (mosquitto_sub -v, optionally with
+// -F "%U %t %p"). ts is unix seconds with optional fraction. Trailing CR/LF
+// is ignored. Returns false for blank or malformed lines.
+
+size_t ingest_decode_batch(const IngestMessage* msgs, size_t count, IngestRecord* out);
+// Decodes count messages into out[] without copying. Messages whose topic is
+// outside the layout, or telemetry with a non-numeric payload, are dropped.
+// Returns the number of records written (<= count).
+
+size_t ingest_format_record(const IngestRecord& rec, IngestFormat fmt,
+                            char* buf, size_t len);
+// Writes one newline-terminated output row. Returns bytes written, or 0 if
+// buf is too small (buf contents are then unspecified).
+
+void ingest_format_header(IngestFormat fmt, char* buf, size_t len);
+// Column header for CSV; empty string for line protocol.
@@ -0,0 +1,89 @@
+// Power selection has no Arduino dependencies — compiled on all platforms;
+// RTC persistence and WiFi.setOutputPower() are device-only.
+#include "TxPower.h"
+
+void txpower_state_reset(TxPowerState& s) {
+    s.magic        = TX_POWER_MAGIC;
+    s.rssi         = 0;
+    s.backoff_qdbm = 0;
+    s.last_qdbm    = TX_POWER_MAX_QDBM;
+    s.failures     = 0;
+}
+
+uint8_t txpower_choose(const TxPowerState& s) {
+    if (s.magic != TX_POWER_MAGIC || s.rssi >= 0) return TX_POWER_MAX_QDBM;
+    int headroom_db = (int)s.rssi - TX_POWER_TARGET_RSSI;
+    int qdbm = TX_POWER_MAX_QDBM - headroom_db * 4;
+    if (qdbm < TX_POWER_MIN_QDBM) qdbm = TX_POWER_MIN_QDBM;
+    qdbm += s.backoff_qdbm;  // on top of the floor, so every failure steps up
+    if (qdbm > TX_POWER_MAX_QDBM) qdbm = TX_POWER_MAX_QDBM;
+    return (uint8_t)qdbm;
+}
+
+uint8_t txpower_record_failure(TxPowerState& s) {
+    int backoff = (int)s.backoff_qdbm + TX_POWER_STEP_QDBM;
+    s.backoff_qdbm = (uint8_t)(backoff > TX_POWER_MAX_QDBM ? TX_POWER_MAX_QDBM : backoff);
+    if (s.failures < 255) s.failures++;
+    s.last_qdbm = txpower_choose(s);
+    return s.last_qdbm;
+}
+
+void txpower_record_success(TxPowerState& s, int8_t rssi) {
+    if (rssi < 0) s.rssi = rssi;
+    s.backoff_qdbm = (s.backoff_qdbm > TX_POWER_DECAY_QDBM)
+                   ? (uint8_t)(s.backoff_qdbm - TX_POWER_DECAY_QDBM) : 0;
+    s.failures = 0;
+}
+
+float txpower_dbm(uint8_t qdbm) {
+    return (float)qdbm * 0.25f;
+}
+
+#ifndef NATIVE_TEST
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include "Log.h"
+#include "RtcLayout.h"
+
+static_assert(sizeof(TxPowerState) <= RTC_BLOCKS_TX_POWER * RTC_BLOCK_SIZE,
+              "TxPowerState outgrew its RTC region");
+
+static TxPowerState s_tx;
+
+static void txpower_save() {
+    ESP.rtcUserMemoryWrite(RTC_BLOCK_TX_POWER, (uint32_t*)&s_tx, sizeof(s_tx));
+}
+
+static void txpower_apply(uint8_t qdbm) {
+    WiFi.setOutputPower(txpower_dbm(qdbm));
+}
+
+uint8_t txpower_begin() {
+    ESP.rtcUserMemoryRead(RTC_BLOCK_TX_POWER, (uint32_t*)&s_tx, sizeof(s_tx));
+    if (s_tx.magic != TX_POWER_MAGIC) txpower_state_reset(s_tx);
+    s_tx.last_qdbm = txpower_choose(s_tx);
+    txpower_apply(s_tx.last_qdbm);
+    LOG_I("[TX] %.2f dBm (last RSSI %d dBm, backoff %.2f dB)\n",
+          txpower_dbm(s_tx.last_qdbm), s_tx.rssi, txpower_dbm(s_tx.backoff_qdbm));
+    return s_tx.last_qdbm;
+}
+
+uint8_t txpower_failed() {
+    uint8_t qdbm = txpower_record_failure(s_tx);
+    txpower_apply(qdbm);
+    txpower_save();
+    LOG_D("[TX] Failure %u — stepping up to %.2f dBm\n", s_tx.failures, txpower_dbm(qdbm));
+    return qdbm;
+}
+
+void txpower_link_ok(int8_t rssi) {
+    txpower_record_success(s_tx, rssi);
+    txpower_save();
+}
+
+uint8_t txpower_current() {
+    return s_tx.last_qdbm;
+}
+
+#endif // NATIVE_TEST
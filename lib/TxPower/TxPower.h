@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+
+// RSSI-driven WiFi transmit power. The RSSI seen on the last successful
+// association is kept in RTC memory (RTC_BLOCK_TX_POWER); the next wake
+// transmits at the lowest power that keeps that link TX_POWER_TARGET_RSSI
+// or better, assuming a symmetric path and an AP transmitting near the
+// ESP8266's own maximum. The measured RSSI is the AP's downlink, so it does
+// not depend on the power we chose — no feedback loop.
+//
+// A failed connect or publish adds TX_POWER_STEP_QDBM of backoff (applied
+// straight away for the next attempt); each successful wake takes
+// TX_POWER_DECAY_QDBM of it back. Powers are in quarter-dBm, the
+// resolution of WiFi.setOutputPower().
+
+#define TX_POWER_MAGIC        0x54585057   // "TXPW"
+#define TX_POWER_MAX_QDBM     82           // 20.5 dBm, SDK default
+#define TX_POWER_MIN_QDBM     32           // 8 dBm floor
+#define TX_POWER_TARGET_RSSI  (-67)        // dBm margin kept at reduced power
+#define TX_POWER_STEP_QDBM    24           // +6 dB per failure
+#define TX_POWER_DECAY_QDBM   8            // -2 dB per successful wake
+
+struct TxPowerState {
+    uint32_t magic;
+    int8_t   rssi;          // last association's RSSI in dBm, 0 = unknown
+    uint8_t  backoff_qdbm;  // added on failure, decays on success
+    uint8_t  last_qdbm;     // power used by the last wake
+    uint8_t  failures;      // consecutive failed attempts
+};
+
+void txpower_state_reset(TxPowerState& s);
+// Unknown RSSI, no backoff: the next choice is full power.
+
+uint8_t txpower_choose(const TxPowerState& s);
+// Power for the next association: full power when the RSSI is unknown,
+// else TX_POWER_MAX_QDBM less the RSSI's headroom over TX_POWER_TARGET_RSSI
+// (not below TX_POWER_MIN_QDBM), plus the backoff, capped at TX_POWER_MAX_QDBM.
+
+uint8_t txpower_record_failure(TxPowerState& s);
+// Adds one backoff step; returns the new choice.
+
+void txpower_record_success(TxPowerState& s, int8_t rssi);
+// Stores the RSSI (values >= 0 are WiFi.RSSI()'s "not connected" and are
+// ignored) and decays the backoff.
+
+float txpower_dbm(uint8_t qdbm);
+// No Arduino dependencies — unit-tested in the native env.
+
+#ifndef NATIVE_TEST
+
+uint8_t txpower_begin();
+// Loads the RTC state (resetting it if invalid), applies the chosen power
+// with WiFi.setOutputPower() and returns it. Call before WiFi.begin().
+
+uint8_t txpower_failed();
+// Steps up, applies and saves. Call on each failed connect or publish.
+
+void txpower_link_ok(int8_t rssi);
+// Records a completed publish at the RSSI measured after association.
+
+uint8_t txpower_current();
+// Power in effect this wake, in quarter-dBm.
+
+#endif // NATIVE_TEST
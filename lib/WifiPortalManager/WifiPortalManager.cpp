@@ -1,6 +1,13 @@
 #include "WifiPortalManager.h"
 #include <Arduino.h>
 #include <ESP8266WiFi.h>
+#include <WiFiManager.h>
+#include "LedIndicator.h"
+#include "CpuPolicy.h"
+#include "BootGuard.h"
+#include "PortalIdle.h"
+#include "PowerWait.h"
+#include "Log.h"
 
 bool wifi_has_credentials() {
     return WiFi.SSID().length() > 0;
@@ -8,41 +15,159 @@ bool wifi_has_credentials() {
 
 WifiResult wifi_connect(int max_attempts, int attempt_timeout_s, int delay_between_s) {
     for (int attempt = 1; attempt <= max_attempts; attempt++) {
-        Serial.printf("[WiFi] Attempt %d/%d connecting...\n", attempt, max_attempts);
+        LOG_D("[WiFi] Attempt %d/%d connecting...\n", attempt, max_attempts);
         WiFi.begin();  // no args — uses saved credentials
         unsigned long deadline = millis() + (unsigned long)attempt_timeout_s * 1000;
         while (millis() < deadline) {
             if (WiFi.status() == WL_CONNECTED) {
-                Serial.printf("[WiFi] Attempt %d/%d connected\n", attempt, max_attempts);
+                LOG_D("[WiFi] Attempt %d/%d connected\n", attempt, max_attempts);
                 return WIFI_OK;
             }
-            delay(100);
-            yield();
+            power_wait(100, WAIT_ASSOCIATION);
         }
-        Serial.printf("[WiFi] Attempt %d/%d failed\n", attempt, max_attempts);
-        if (attempt < max_attempts) delay((unsigned long)delay_between_s * 1000);
+        LOG_D("[WiFi] Attempt %d/%d failed\n", attempt, max_attempts);
+        if (attempt < max_attempts) power_wait((uint32_t)delay_between_s * 1000, WAIT_RETRY_GAP);
     }
-    Serial.println("[WiFi] All attempts exhausted — connection failed");
+    LOG_W("[WiFi] All attempts exhausted — connection failed\n");
     return WIFI_FAILED;
 }
 
+// Polls the portal until it closes, sleeping between polls per PortalIdle.h.
+// Low TX power and a pulsed LED for the whole portal; the duty figures go to
+// the log so a current measurement can be matched against them.
+static void portal_loop(WiFiManager& mgr, void (*led_tick)(uint32_t)) {
+    WiFi.setOutputPower(PORTAL_TX_QDBM / 4.0f);
+    if (led_get_mode() == LED_MODE_FULL) led_set_mode(LED_MODE_PULSE);
+
+    PortalDuty duty;
+    portal_duty_begin(duty);
+    uint32_t t0          = millis();
+    uint32_t last_report = 0;
+    while (mgr.getConfigPortalActive()) {
+        uint32_t t_poll = micros();
+        mgr.process();
+        uint32_t now = millis() - t0;
+        portal_duty_poll(duty, micros() - t_poll, now);
+        if (led_tick) led_tick(millis());
+
+        uint32_t idle = portal_idle_ms(duty, WiFi.softAPgetStationNum(), now);
+        if (idle) delay(idle);  // SDK idles the CPU; lwIP keeps receiving
+        else      yield();
+        portal_duty_idle(duty, idle, millis() - t0);
+
+        if (duty.total_ms - last_report >= 60000) {
+            last_report = duty.total_ms;
+            LOG_D("[Portal] %lus: idle %u%%, %lu/%lu polls busy, %u station(s)\n",
+                  (unsigned long)(duty.total_ms / 1000), portal_duty_idle_pct(duty),
+                  (unsigned long)duty.busy_polls, (unsigned long)duty.polls,
+                  WiFi.softAPgetStationNum());
+        }
+    }
+    LOG_I("[Portal] Closed after %lus, CPU idle %u%%, %lu polls served requests\n",
+          (unsigned long)(duty.total_ms / 1000), portal_duty_idle_pct(duty),
+          (unsigned long)duty.busy_polls);
+}
+
 WifiResult wifi_open_portal(WiFiManager& mgr, const char* ap_name, int timeout_s,
                              void (*led_tick)(uint32_t)) {
     mgr.setConfigPortalBlocking(false);
     mgr.setConfigPortalTimeout(timeout_s);
     mgr.startConfigPortal(ap_name);
-    Serial.printf("[WiFi] Portal started: %s (timeout %ds)\n", ap_name, timeout_s);
+    LOG_I("[WiFi] Portal started: %s (timeout %ds)\n", ap_name, timeout_s);
 
-    while (mgr.getConfigPortalActive()) {
-        mgr.process();
-        led_tick(millis());
-        yield();
-    }
+    portal_loop(mgr, led_tick);
 
     if (WiFi.status() == WL_CONNECTED) {
-        Serial.println("[WiFi] Portal: saved and connected");
+        LOG_I("[WiFi] Portal: saved and connected\n");
         return PORTAL_SAVED;
     }
-    Serial.println("[WiFi] Portal: timed out");
+    LOG_W("[WiFi] Portal: timed out\n");
     return PORTAL_TIMEOUT;
 }
+
+void portal_run_and_reboot(Config& cfg, const char* ap_name, int timeout_s,
+                           bool use_auto_connect) {
+    WiFiManager wm;
+
+    char port_buf[8];
+    snprintf(port_buf, sizeof(port_buf), "%d", cfg.mqtt_port);
+    char sleep_normal_buf[8];
+    snprintf(sleep_normal_buf, sizeof(sleep_normal_buf), "%d", cfg.sleep_normal_s);
+    char sleep_low_buf[8];
+    snprintf(sleep_low_buf, sizeof(sleep_low_buf), "%d", cfg.sleep_low_battery_s);
+    char sleep_crit_buf[8];
+    snprintf(sleep_crit_buf, sizeof(sleep_crit_buf), "%d", cfg.sleep_critical_battery_s);
+    char batt_low_buf[8];
+    snprintf(batt_low_buf, sizeof(batt_low_buf), "%.1f", cfg.battery_low_v);
+    char batt_crit_buf[8];
+    snprintf(batt_crit_buf, sizeof(batt_crit_buf), "%.1f", cfg.battery_critical_v);
+
+    WiFiManagerParameter p_server("server",      "MQTT Server",                cfg.mqtt_server,      64);
+    WiFiManagerParameter p_port("port",          "MQTT Port",                  port_buf,             8);
+    WiFiManagerParameter p_user("username",      "MQTT Username",              cfg.mqtt_username,    64);
+    WiFiManagerParameter p_pass("password",      "MQTT Password",              cfg.mqtt_password,    64, "type=\"password\"");
+    WiFiManagerParameter p_topic("topic_root",   "MQTT Topic Root",            cfg.mqtt_topic_root,  64);
+    WiFiManagerParameter p_snorm("sleep_normal", "Sleep Normal (s)",           sleep_normal_buf,     8);
+    WiFiManagerParameter p_slow("sleep_low",     "Sleep Low Battery (s)",      sleep_low_buf,        8);
+    WiFiManagerParameter p_scrit("sleep_crit",   "Sleep Critical Battery (s)", sleep_crit_buf,       8);
+    WiFiManagerParameter p_blow("batt_low",      "Battery Low Voltage",        batt_low_buf,         8);
+    WiFiManagerParameter p_bcrit("batt_crit",    "Battery Critical Voltage",   batt_crit_buf,        8);
+
+    wm.addParameter(&p_server);
+    wm.addParameter(&p_port);
+    wm.addParameter(&p_user);
+    wm.addParameter(&p_pass);
+    wm.addParameter(&p_topic);
+    wm.addParameter(&p_snorm);
+    wm.addParameter(&p_slow);
+    wm.addParameter(&p_scrit);
+    wm.addParameter(&p_blow);
+    wm.addParameter(&p_bcrit);
+
+    // Everything the callback touches lives in this frame, which stays alive
+    // until the portal closes — no static state needed.
+    bool saved = false;
+    wm.setSaveConfigCallback([&]() {
+        LOG_I("[Portal] Save callback fired — writing config\n");
+        strlcpy(cfg.mqtt_server,     p_server.getValue(), sizeof(cfg.mqtt_server));
+        cfg.mqtt_port =              atoi(p_port.getValue());
+        strlcpy(cfg.mqtt_username,   p_user.getValue(),   sizeof(cfg.mqtt_username));
+        strlcpy(cfg.mqtt_password,   p_pass.getValue(),   sizeof(cfg.mqtt_password));
+        strlcpy(cfg.mqtt_topic_root, p_topic.getValue(),  sizeof(cfg.mqtt_topic_root));
+        cfg.sleep_normal_s           = atoi(p_snorm.getValue());
+        cfg.sleep_low_battery_s      = atoi(p_slow.getValue());
+        cfg.sleep_critical_battery_s = atoi(p_scrit.getValue());
+        cfg.battery_low_v            = atof(p_blow.getValue());
+        cfg.battery_critical_v       = atof(p_bcrit.getValue());
+        cfg.wifi_reset = false;
+        config_save(cfg);
+        saved = true;
+        LOG_I("[Portal] Config saved\n");
+    });
+
+    wm.setConfigPortalBlocking(false);
+    wm.setConfigPortalTimeout(timeout_s);
+
+    if (use_auto_connect) {
+        wm.autoConnect(ap_name);
+    } else {
+        wm.startConfigPortal(ap_name);
+    }
+
+    LOG_I("[Portal] AP: %s (timeout %ds)\n", ap_name, timeout_s);
+
+    led_set_pattern(LED_PATTERN_PORTAL);
+    cpu_phase_begin(CPU_PHASE_PORTAL);
+    portal_loop(wm, nullptr);
+
+    led_off();
+    if (saved) {
+        LOG_I("[Portal] Saved — rebooting\n");
+        delay(200);
+        ESP.restart();
+    } else {
+        LOG_W("[Portal] Timed out — sleeping 300s\n");
+        boot_guard_mark(BOOT_GUARD_PHASE_IDLE);  // the reset pin during this sleep is no crash
+        ESP.deepSleep((uint64_t)300 * 1000000ULL);
+    }
+}
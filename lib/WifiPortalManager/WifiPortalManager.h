@@ -1,6 +1,11 @@
 #pragma once
 
-#include <WiFiManager.h>
+#include "ConfigManager.h"
+
+// Forward declaration only: WiFiManager.h (and its web server / DNS server)
+// is included by WifiPortalManager.cpp, so callers that never open a portal
+// do not pull it in.
+class WiFiManager;
 
 enum WifiResult {
     WIFI_OK,
@@ -23,6 +28,18 @@ WifiResult wifi_open_portal(WiFiManager& mgr, const char* ap_name, int timeout_s
 // Opens WiFiManager captive portal in non-blocking mode.
 // Caller must have registered setSaveConfigCallback() before calling this.
 // Sets setConfigPortalBlocking(false) and setConfigPortalTimeout(timeout_s).
-// Loops calling mgr.process() with LED pattern until saved or timed out.
-// led_tick is called each loop iteration with millis() for LED control.
+// Loops calling mgr.process() until saved or timed out, idling the CPU
+// between polls (PortalIdle.h) at reduced TX power with a pulsed LED.
+// led_tick (optional, may be nullptr) is called each loop iteration with millis();
+// timer-driven LED patterns (led_set_pattern) need no tick.
 // Returns PORTAL_SAVED or PORTAL_TIMEOUT.
+
+void portal_run_and_reboot(Config& cfg, const char* ap_name, int timeout_s,
+                           bool use_auto_connect);
+// Constructs WiFiManager and the ten config parameters on demand, opens the
+// portal and loops until it closes (same idle-aware loop as wifi_open_portal). Never returns: saved -> ESP.restart(),
+// timed out -> 300s deep sleep.
+// use_auto_connect=true  -> autoConnect() (scenario 1, no saved credentials)
+// use_auto_connect=false -> startConfigPortal() (scenarios 2 & 3)
+// Nothing portal-related exists before this is called, so a normal publish
+// wake pays no constructor, String or heap cost for it.
@@ -0,0 +1,281 @@
+// Store, cache and planning have no Arduino dependencies — compiled on all
+// platforms; file, RTC and radio access are device-only.
+#include "WifiStore.h"
+#include <string.h>
+
+static const char* const kStrategyNames[WIFI_STRATEGY_COUNT] = {
+    "cached", "ranked", "scan"
+};
+
+const char* wifi_strategy_name(uint8_t strategy) {
+    return strategy < WIFI_STRATEGY_COUNT ? kStrategyNames[strategy] : "?";
+}
+
+// -- Store ────────────────────────────────────────────────────────────────────
+
+int wifi_store_find(const WifiStore& store, const char* ssid) {
+    for (uint8_t i = 0; i < store.count; i++) {
+        if (strcmp(store.nets[i].ssid, ssid) == 0) return i;
+    }
+    return -1;
+}
+
+int wifi_store_add(WifiStore& store, const char* ssid, const char* pass) {
+    size_t ssid_len = strlen(ssid);
+    if (ssid_len == 0 || ssid_len > WIFI_SSID_MAX || strlen(pass) > WIFI_PASS_MAX) return -1;
+    int i = wifi_store_find(store, ssid);
+    if (i < 0) {
+        if (store.count < WIFI_STORE_MAX) store.count++;
+        i = store.count - 1;
+        memcpy(store.nets[i].ssid, ssid, ssid_len + 1);
+    }
+    strcpy(store.nets[i].pass, pass);
+    return i;
+}
+
+bool wifi_store_adopt(WifiStore& store, const char* ssid, const char* pass) {
+    int i = wifi_store_find(store, ssid);
+    if (i >= 0 && strcmp(store.nets[i].pass, pass) == 0) return false;
+    return wifi_store_add(store, ssid, pass) >= 0;
+}
+
+uint32_t wifi_store_hash(const WifiStore& store) {
+    uint32_t h = 2166136261u;
+    for (uint8_t i = 0; i < store.count; i++) {
+        for (const char* p = store.nets[i].ssid; ; p++) {
+            h = (h ^ (uint8_t)*p) * 16777619u;  // includes the NUL as separator
+            if (*p == '\0') break;
+        }
+    }
+    return h;
+}
+
+// -- Cache and planning ───────────────────────────────────────────────────────
+
+void wifi_cache_reset(WifiCache& cache, const WifiStore& store) {
+    memset(&cache, 0, sizeof(cache));
+    cache.magic      = WIFI_CACHE_MAGIC;
+    cache.store_hash = wifi_store_hash(store);
+    cache.last       = WIFI_INDEX_NONE;
+}
+
+bool wifi_cache_valid(const WifiCache& cache, const WifiStore& store) {
+    return cache.magic == WIFI_CACHE_MAGIC && cache.store_hash == wifi_store_hash(store);
+}
+
+bool wifi_plan_needs_scan(const WifiCache& cache, const WifiStore& store) {
+    return !wifi_cache_valid(cache, store) || cache.last >= store.count ||
+           cache.fail_streak >= WIFI_SCAN_AFTER_FAILS;
+}
+
+size_t wifi_plan(const WifiStore& store, const WifiCache& cache, WifiAttempt* out, size_t cap) {
+    size_t n = 0;
+    bool   valid = wifi_cache_valid(cache, store);
+    if (!wifi_plan_needs_scan(cache, store) && n < cap) {
+        WifiAttempt& a = out[n++];
+        a.strategy = WIFI_STRATEGY_CACHED;
+        a.index    = cache.last;
+        a.channel  = cache.channel;
+        memcpy(a.bssid, cache.bssid, sizeof(a.bssid));
+    }
+
+    // All entries by wins, stable so ties keep store order. The cached
+    // network is included: an SSID-only join still finds it if the AP moved.
+    uint8_t order[WIFI_STORE_MAX];
+    uint8_t m = 0;
+    for (uint8_t i = 0; i < store.count; i++) {
+        uint16_t w = valid ? cache.wins[i] : 0;
+        uint8_t  j = m++;
+        while (j > 0 && (valid ? cache.wins[order[j - 1]] : 0) < w) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+    for (uint8_t k = 0; m > 0 && n < cap; k = (uint8_t)((k + 1) % m)) {
+        WifiAttempt& a = out[n++];
+        memset(&a, 0, sizeof(a));
+        a.strategy = WIFI_STRATEGY_RANKED;
+        a.index    = order[k];
+    }
+    return n;
+}
+
+size_t wifi_rank_scan(const WifiStore& store, const WifiSeen* seen, size_t n,
+                      WifiAttempt* out, size_t cap) {
+    // Strongest sighting per stored network
+    int best[WIFI_STORE_MAX];
+    for (uint8_t i = 0; i < WIFI_STORE_MAX; i++) best[i] = -1;
+    for (size_t s = 0; s < n; s++) {
+        int i = wifi_store_find(store, seen[s].ssid);
+        if (i < 0) continue;
+        if (best[i] < 0 || seen[s].rssi > seen[best[i]].rssi) best[i] = (int)s;
+    }
+
+    size_t count = 0;
+    for (;;) {
+        int pick = -1;
+        for (uint8_t i = 0; i < store.count; i++) {
+            if (best[i] < 0) continue;
+            if (pick < 0 || seen[best[i]].rssi > seen[best[pick]].rssi) pick = i;
+        }
+        if (pick < 0 || count >= cap) break;
+        const WifiSeen& s = seen[best[pick]];
+        WifiAttempt&    a = out[count++];
+        a.strategy = WIFI_STRATEGY_SCAN;
+        a.index    = (uint8_t)pick;
+        a.channel  = s.channel;
+        memcpy(a.bssid, s.bssid, sizeof(a.bssid));
+        best[pick] = -1;
+    }
+    return count;
+}
+
+void wifi_cache_record(WifiCache& cache, const WifiStore& store, const WifiAttempt* ok,
+                       const uint8_t* bssid, uint8_t channel, uint32_t elapsed_ms) {
+    if (!wifi_cache_valid(cache, store)) wifi_cache_reset(cache, store);
+    if (!ok) {
+        if (cache.fail_streak < 255) cache.fail_streak++;
+        return;
+    }
+    cache.fail_streak = 0;
+    cache.last        = ok->index;
+    cache.channel     = channel;
+    memcpy(cache.bssid, bssid, sizeof(cache.bssid));
+
+    if (cache.wins[ok->index] == 0xFFFF) {
+        for (uint8_t i = 0; i < WIFI_STORE_MAX; i++) cache.wins[i] /= 2;
+    }
+    cache.wins[ok->index]++;
+
+    WifiStrategyStats& st = cache.stats[ok->strategy];
+    st.last_ms = (uint16_t)(elapsed_ms > 0xFFFF ? 0xFFFF : elapsed_ms);
+    if (st.connects == 0xFFFF) {
+        st.connects /= 2;
+        st.total_ms /= 2;
+    }
+    st.connects++;
+    st.total_ms += elapsed_ms;
+}
+
+#ifndef NATIVE_TEST
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <LittleFS.h>
+#include <ArduinoJson.h>
+#include "Log.h"
+#include "RtcLayout.h"
+
+#define WIFI_JSON_CAPACITY 1536  // WIFI_STORE_MAX entries with maximum-length strings
+
+static_assert(sizeof(WifiCache) <= RTC_BLOCKS_WIFI_CACHE * RTC_BLOCK_SIZE,
+              "WifiCache outgrew its RTC region");
+
+bool wifi_store_load(WifiStore& store) {
+    memset(&store, 0, sizeof(store));
+    bool ok = true;
+    File file = LittleFS.open("/wifi.json", "r");
+    if (file) {
+        DynamicJsonDocument doc(WIFI_JSON_CAPACITY);  // heap: too big for the loop stack
+        DeserializationError err = deserializeJson(doc, file);
+        file.close();
+        if (err) {
+            LOG_E("[WiFi] ERROR: /wifi.json parse failed: %s\n", err.c_str());
+            ok = false;
+        } else {
+            for (JsonObject net : doc["networks"].as<JsonArray>()) {
+                if (wifi_store_add(store, net["ssid"] | "", net["pass"] | "") < 0) {
+                    LOG_W("[WiFi] Skipping invalid /wifi.json entry\n");
+                }
+            }
+        }
+    }
+
+    // Migrate the portal's SDK credentials the first time they are seen, and
+    // follow a password changed through the portal afterwards (WiFiManager
+    // saves to the SDK only). A malformed file is left alone for the user to fix.
+    String ssid = WiFi.SSID();
+    if (ssid.length() > 0 && wifi_store_adopt(store, ssid.c_str(), WiFi.psk().c_str()) && ok) {
+        LOG_I("[WiFi] Stored SDK network \"%s\" in /wifi.json\n", ssid.c_str());
+        wifi_store_save(store);
+    }
+    LOG_D("[WiFi] Store: %u networks\n", store.count);
+    return ok;
+}
+
+bool wifi_store_save(const WifiStore& store) {
+    DynamicJsonDocument doc(WIFI_JSON_CAPACITY);
+    JsonArray nets = doc.createNestedArray("networks");
+    for (uint8_t i = 0; i < store.count; i++) {
+        JsonObject net = nets.createNestedObject();
+        net["ssid"] = store.nets[i].ssid;
+        net["pass"] = store.nets[i].pass;
+    }
+    File file = LittleFS.open("/wifi.json", "w");
+    if (!file) {
+        LOG_E("[WiFi] ERROR: Failed to open /wifi.json for writing\n");
+        return false;
+    }
+    serializeJson(doc, file);
+    file.close();
+    return true;
+}
+
+void wifi_cache_load(WifiCache& cache, const WifiStore& store) {
+    ESP.rtcUserMemoryRead(RTC_BLOCK_WIFI_CACHE, (uint32_t*)&cache, sizeof(cache));
+    if (!wifi_cache_valid(cache, store)) wifi_cache_reset(cache, store);
+}
+
+void wifi_cache_save(const WifiCache& cache) {
+    ESP.rtcUserMemoryWrite(RTC_BLOCK_WIFI_CACHE, (uint32_t*)&cache, sizeof(cache));
+}
+
+size_t wifi_scan_plan(const WifiStore& store, WifiAttempt* out, size_t cap) {
+    int found = WiFi.scanNetworks();
+    if (found <= 0) return 0;
+
+    static const int kMaxSeen = 24;
+    WifiSeen seen[kMaxSeen];
+    String   names[kMaxSeen];
+    size_t   n = 0;
+    for (int i = 0; i < found && n < (size_t)kMaxSeen; i++) {
+        names[n] = WiFi.SSID(i);
+        if (wifi_store_find(store, names[n].c_str()) < 0) continue;
+        seen[n].ssid    = names[n].c_str();
+        seen[n].rssi    = WiFi.RSSI(i);
+        seen[n].channel = (uint8_t)WiFi.channel(i);
+        memcpy(seen[n].bssid, WiFi.BSSID(i), sizeof(seen[n].bssid));
+        n++;
+    }
+    WiFi.scanDelete();
+    LOG_D("[WiFi] Scan: %d APs, %u stored networks in range\n", found, (unsigned)n);
+    return wifi_rank_scan(store, seen, n, out, cap);
+}
+
+void wifi_cache_report(const WifiCache& cache) {
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+    LOG_I("[WiFi] Time-to-connect:");
+    for (uint8_t i = 0; i < WIFI_STRATEGY_COUNT; i++) {
+        const WifiStrategyStats& st = cache.stats[i];
+        if (st.connects == 0) continue;
+        LOG_I(" %s n=%u avg=%lums last=%ums", kStrategyNames[i], st.connects,
+              (unsigned long)(st.total_ms / st.connects), st.last_ms);
+    }
+    LOG_I("\n");
+#else
+    (void)cache;
+#endif
+}
+
+void wifi_attempt_begin(const WifiStore& store, const WifiAttempt& a) {
+    const WifiNetwork& net = store.nets[a.index];
+    WiFi.persistent(false);
+    if (a.channel != 0) {
+        WiFi.begin(net.ssid, net.pass, a.channel, a.bssid);
+    } else {
+        WiFi.begin(net.ssid, net.pass);
+    }
+}
+
+#endif // NATIVE_TEST
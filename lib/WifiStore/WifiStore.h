@@ -0,0 +1,153 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Credential store for several networks (/wifi.json on LittleFS) plus an
+// RTC cache of the last good AP, so a wake normally reconnects to the same
+// BSSID and channel without any scan.
+//
+// /wifi.json: { "networks": [ { "ssid": "...", "pass": "..." }, ... ] }
+// The SDK credentials saved by the WiFiManager portal are added to the store
+// the first time they are seen, so existing units migrate without a file,
+// and a password changed through the portal replaces the stored one. For
+// that network the portal, not the file, is where the password is set.
+//
+// Each wake makes WIFI_PLAN_MAX attempts, drawn in order from:
+//   SCAN    stored networks seen by a full scan, strongest first, pinned to
+//           the BSSID + channel seen — only on a cold start (no valid cache)
+//           or after WIFI_SCAN_AFTER_FAILS failed wakes
+//   CACHED  last good SSID on its BSSID + channel (no scan) — otherwise
+//   RANKED  stored SSIDs by past successes (the SDK probes for the SSID),
+//           repeated to fill the remaining attempts
+
+#define WIFI_STORE_MAX         6
+#define WIFI_SSID_MAX          32
+#define WIFI_PASS_MAX          64
+#define WIFI_PLAN_MAX          3
+#define WIFI_SCAN_AFTER_FAILS  2
+#define WIFI_CACHE_MAGIC       0x57494643   // "WIFC"
+#define WIFI_INDEX_NONE        0xFF
+
+enum WifiStrategy {
+    WIFI_STRATEGY_CACHED,
+    WIFI_STRATEGY_RANKED,
+    WIFI_STRATEGY_SCAN,
+    WIFI_STRATEGY_COUNT
+};
+
+struct WifiNetwork {
+    char ssid[WIFI_SSID_MAX + 1];
+    char pass[WIFI_PASS_MAX + 1];
+};
+
+struct WifiStore {
+    WifiNetwork nets[WIFI_STORE_MAX];
+    uint8_t     count;
+};
+
+struct WifiStrategyStats {
+    uint16_t connects;   // successful connects via this strategy
+    uint16_t last_ms;    // time-to-connect of the latest one
+    uint32_t total_ms;   // sum, for the average
+};
+
+// Lives in RTC memory (RTC_BLOCK_WIFI_CACHE); survives deep sleep only.
+struct WifiCache {
+    uint32_t          magic;
+    uint32_t          store_hash;           // wifi_store_hash() the entries below refer to
+    uint8_t           bssid[6];             // AP of the last success
+    uint8_t           channel;
+    uint8_t           last;                 // store index of the last success
+    uint8_t           fail_streak;          // consecutive wakes without a connection
+    uint8_t           reserved[3];
+    uint16_t          wins[WIFI_STORE_MAX]; // successes per store index
+    WifiStrategyStats stats[WIFI_STRATEGY_COUNT];
+};
+
+struct WifiAttempt {
+    uint8_t strategy;   // WifiStrategy
+    uint8_t index;      // store entry
+    uint8_t channel;    // 0 = let the SDK search
+    uint8_t bssid[6];   // valid when channel != 0
+};
+
+// Scan result as seen by wifi_rank_scan
+struct WifiSeen {
+    const char* ssid;
+    int32_t     rssi;
+    uint8_t     bssid[6];
+    uint8_t     channel;
+};
+
+// -- Store ────────────────────────────────────────────────────────────────────
+
+int wifi_store_find(const WifiStore& store, const char* ssid);
+// Index of ssid, or -1.
+
+int wifi_store_add(WifiStore& store, const char* ssid, const char* pass);
+// Adds or updates (password) an entry and returns its index. A full store
+// drops its last entry to make room. -1 for an empty or overlong SSID.
+
+bool wifi_store_adopt(WifiStore& store, const char* ssid, const char* pass);
+// Adds ssid, or updates its password when it differs. True if the store
+// changed (false also for an invalid entry).
+
+uint32_t wifi_store_hash(const WifiStore& store);
+// FNV-1a over the SSIDs in order — a cache built for another store is ignored.
+
+// -- Cache and planning ───────────────────────────────────────────────────────
+
+void wifi_cache_reset(WifiCache& cache, const WifiStore& store);
+// Cold start: nothing cached, no statistics.
+
+bool wifi_cache_valid(const WifiCache& cache, const WifiStore& store);
+
+bool wifi_plan_needs_scan(const WifiCache& cache, const WifiStore& store);
+// True on a cold start or after WIFI_SCAN_AFTER_FAILS failed wakes.
+
+size_t wifi_plan(const WifiStore& store, const WifiCache& cache, WifiAttempt* out, size_t cap);
+// CACHED for the last good network unless wifi_plan_needs_scan(), then
+// RANKED entries by wins (ties in store order), cycling until cap attempts.
+// After a scan, call with the slots the scan left to fill them.
+
+size_t wifi_rank_scan(const WifiStore& store, const WifiSeen* seen, size_t n,
+                      WifiAttempt* out, size_t cap);
+// SCAN attempts for stored networks that were seen, strongest first, each
+// pinned to the strongest BSSID seen for it.
+
+void wifi_cache_record(WifiCache& cache, const WifiStore& store, const WifiAttempt* ok,
+                       const uint8_t* bssid, uint8_t channel, uint32_t elapsed_ms);
+// ok = the attempt that connected (nullptr = the whole wake failed).
+// Stores the AP actually joined, bumps wins and the strategy's statistics.
+
+const char* wifi_strategy_name(uint8_t strategy);
+// No Arduino dependencies — unit-tested in the native env.
+
+#ifndef NATIVE_TEST
+
+bool wifi_store_load(WifiStore& store);
+// Reads /wifi.json (LittleFS already mounted by config_load). A missing file
+// is an empty store. Then adopts the SDK credentials (wifi_store_adopt) and
+// rewrites the file if that changed it. Returns false on a malformed file,
+// which is left untouched (the SDK credentials are still adopted in memory).
+
+bool wifi_store_save(const WifiStore& store);
+
+void wifi_cache_load(WifiCache& cache, const WifiStore& store);
+// Reads the RTC cache; resets it if invalid or built for another store.
+
+void wifi_cache_save(const WifiCache& cache);
+
+void wifi_cache_report(const WifiCache& cache);
+// Prints per-strategy connect count, average and last time-to-connect
+// (LOG_LEVEL INFO and above).
+
+size_t wifi_scan_plan(const WifiStore& store, WifiAttempt* out, size_t cap);
+// Blocking WiFi.scanNetworks() followed by wifi_rank_scan().
+
+void wifi_attempt_begin(const WifiStore& store, const WifiAttempt& a);
+// WiFi.begin() for one attempt, with BSSID and channel when pinned.
+// Credentials are not persisted to SDK flash (WiFi.persistent(false)).
+
+#endif // NATIVE_TEST
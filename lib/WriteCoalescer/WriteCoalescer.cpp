@@ -0,0 +1,46 @@
+#include "WriteCoalescer.h"
+#include <string.h>
+
+void coalescer_init(WriteCoalescer& c, uint8_t* buf, size_t cap,
+                    CoalescerSink sink, void* ctx) {
+    c.buf         = buf;
+    c.cap         = cap;
+    c.len         = 0;
+    c.holding     = false;
+    c.sink        = sink;
+    c.ctx         = ctx;
+    c.sink_writes = 0;
+}
+
+void coalescer_begin_burst(WriteCoalescer& c) {
+    c.holding = true;
+}
+
+static bool emit(WriteCoalescer& c, const uint8_t* data, size_t len) {
+    if (len == 0) return true;
+    c.sink_writes++;
+    return c.sink(c.ctx, data, len) == len;
+}
+
+static bool drain(WriteCoalescer& c) {
+    bool ok = emit(c, c.buf, c.len);
+    c.len = 0;
+    return ok;
+}
+
+size_t coalescer_write(WriteCoalescer& c, const uint8_t* data, size_t len) {
+    if (!c.holding) return emit(c, data, len) ? len : 0;
+
+    if (c.len + len > c.cap) {
+        if (!drain(c)) return 0;
+        if (len > c.cap) return emit(c, data, len) ? len : 0;
+    }
+    memcpy(c.buf + c.len, data, len);
+    c.len += len;
+    return len;
+}
+
+bool coalescer_flush(WriteCoalescer& c) {
+    c.holding = false;
+    return drain(c);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Transport-level write coalescing. Outside a burst every write passes
+// straight through to the sink; inside a burst writes are appended to one
+// contiguous buffer and leave in a single sink write on flush. Protocol
+// bytes are never altered — only the write boundaries change.
+// No Arduino dependencies — the device binding is CoalescingClient in
+// lib/MqttClient.
+
+typedef size_t (*CoalescerSink)(void* ctx, const uint8_t* data, size_t len);
+// Returns the number of bytes accepted.
+
+struct WriteCoalescer {
+    uint8_t*      buf;
+    size_t        cap;
+    size_t        len;
+    bool          holding;  // burst open
+    CoalescerSink sink;
+    void*         ctx;
+    uint32_t      sink_writes;  // one per segment handed to the transport
+};
+
+void coalescer_init(WriteCoalescer& c, uint8_t* buf, size_t cap,
+                    CoalescerSink sink, void* ctx);
+
+void coalescer_begin_burst(WriteCoalescer& c);
+// Starts buffering. Idempotent.
+
+size_t coalescer_write(WriteCoalescer& c, const uint8_t* data, size_t len);
+// Outside a burst: forwards to the sink. Inside a burst: appends; if the
+// buffer would overflow it is flushed first (the burst stays open), and a
+// single write larger than the whole buffer is forwarded directly.
+// Returns len on success.
+
+bool coalescer_flush(WriteCoalescer& c);
+// Emits buffered bytes in one sink write and closes the burst.
+// Returns false if the sink accepted fewer bytes than buffered.
@@ -1,404 +1,638 @@
 #include <Arduino.h>
 #include <ESP8266WiFi.h>
-#include <WiFiManager.h>
 #include <PubSubClient.h>
-#include <DHT.h>
 #include "ConfigManager.h"
 #include "WifiPortalManager.h"
 #include "MqttClient.h"
 #include "LedIndicator.h"
 #include "DhtSensor.h"
+#include "EspNowLink.h"
+#include "CpuPolicy.h"
+#include "BootGuard.h"
+#include "TxPower.h"
+#include "WifiStore.h"
+#include "SeqCounter.h"
+#include "PowerWait.h"
+#include "Log.h"
+#include "RtcLayout.h"
 #include "utils.h"
 
-#define DHT_PIN           14    // D5 = GPIO14
-#define DHT_TYPE          DHT11
 #define NUM_READS         3
+#define ESPNOW_NUM_READS  1     // single read keeps the ESP-NOW wake in the tens of ms
+#define ESPNOW_ATTEMPTS   3
 #define BATTERY_ADC_SCALE (4.2f / 1023.0f)  // Wemos D1 Mini Battery Shield v1.1.0
 #define SLEEP_MAGIC       0xDEADBEEF
-#define SLEEP_MAX_S       4294
+#define LOG_DUMP_CHUNK    160   // payload bytes per log publish (PubSubClient packet is 256)
 
-DHT dht(DHT_PIN, DHT_TYPE);
 PubSubClient mqtt_client;
+static DhtAsync         dht[SENSOR_CHANNELS_MAX];  // one per configured channel
+static uint8_t          dht_count = 0;
+static const char*      channel_names[SENSOR_CHANNELS_MAX];
+static WiFiClient       wifi_client_mqtt;
+static CoalescingClient mqtt_transport(wifi_client_mqtt);
+static MqttSnUdp        mqttsn_udp;
+static MqttSnClient     mqttsn_client;
+static bool             use_mqttsn = false;  // this wake publishes over MQTT-SN
+static WifiStore        wifi_store;          // /wifi.json, loaded before Step 3
+static WifiCache        wifi_cache;          // RTC: last good AP, per-network wins
+
+// Gateway role state — setup() returns and loop() keeps relaying
+static Config gw_cfg;
+static char   gw_device_name[16];
+static char   gw_topic_status[96];
 
 // -- Helper: chained sleep for durations > SLEEP_MAX_S ───────────────────────
-// Persists remaining duration in RTC user memory (offset 0, 8 bytes).
+// Persists remaining duration in RTC user memory (RTC_BLOCK_SLEEP, 8 bytes).
 // Sleeps in at most SLEEP_MAX_S-second segments. Calls led_off() before sleep.
+// The radio stays off across continuation wakes; only the wake that runs
+// the next full publish cycle boots with RF calibrated.
 static void sleep_chained(int total_s) {
     uint32_t rtc[2];
-    uint32_t chunk     = ((uint32_t)total_s > SLEEP_MAX_S) ? SLEEP_MAX_S : (uint32_t)total_s;
-    uint32_t remaining = (uint32_t)total_s - chunk;
+    uint32_t remaining = (uint32_t)total_s;
+    uint32_t chunk     = sleep_next_chunk(remaining, SLEEP_MAX_S);
     rtc[0] = (remaining > 0) ? SLEEP_MAGIC : 0;
     rtc[1] = remaining;
-    ESP.rtcUserMemoryWrite(0, rtc, sizeof(rtc));
-    Serial.printf("[Sleep] Sleeping %us (%us remaining after)\n", chunk, remaining);
+    ESP.rtcUserMemoryWrite(RTC_BLOCK_SLEEP, rtc, sizeof(rtc));
+    log_event(EV_SLEEP, (int32_t)chunk);
+    LOG_I("[Sleep] Sleeping %us (%us remaining after)\n", chunk, remaining);
+    cpu_phase_report();
+    power_wait_report();
     led_off();
-    ESP.deepSleep((uint64_t)chunk * 1000000ULL);
+    ESP.deepSleep((uint64_t)chunk * 1000000ULL, (remaining > 0) ? WAKE_RF_DISABLED : WAKE_RF_DEFAULT);
 }
 
-// -- Helper: register all portal parameters, open portal, loop until closed ──
-// Never returns — always calls ESP.restart() or ESP.deepSleep().
-// timeout_s=600 for scenario 1 (no creds), 300 for scenarios 2 & 3.
-// use_auto_connect=true  -> wm.autoConnect() (scenario 1)
-// use_auto_connect=false -> wm.startConfigPortal() (scenarios 2 & 3)
-static void open_portal_and_reboot(WiFiManager& wm, Config& cfg,
-                                   const char* ap_name, int timeout_s,
-                                   bool use_auto_connect) {
-    char port_buf[8];
-    snprintf(port_buf, sizeof(port_buf), "%d", cfg.mqtt_port);
-    char sleep_normal_buf[8];
-    snprintf(sleep_normal_buf, sizeof(sleep_normal_buf), "%d", cfg.sleep_normal_s);
-    char sleep_low_buf[8];
-    snprintf(sleep_low_buf, sizeof(sleep_low_buf), "%d", cfg.sleep_low_battery_s);
-    char sleep_crit_buf[8];
-    snprintf(sleep_crit_buf, sizeof(sleep_crit_buf), "%d", cfg.sleep_critical_battery_s);
-    char batt_low_buf[8];
-    snprintf(batt_low_buf, sizeof(batt_low_buf), "%.1f", cfg.battery_low_v);
-    char batt_crit_buf[8];
-    snprintf(batt_crit_buf, sizeof(batt_crit_buf), "%.1f", cfg.battery_critical_v);
-
-    WiFiManagerParameter p_server("server",      "MQTT Server",                cfg.mqtt_server,      64);
-    WiFiManagerParameter p_port("port",          "MQTT Port",                  port_buf,             8);
-    WiFiManagerParameter p_user("username",      "MQTT Username",              cfg.mqtt_username,    64);
-    WiFiManagerParameter p_pass("password",      "MQTT Password",              cfg.mqtt_password,    64, "type=\"password\"");
-    WiFiManagerParameter p_topic("topic_root",   "MQTT Topic Root",            cfg.mqtt_topic_root,  64);
-    WiFiManagerParameter p_snorm("sleep_normal", "Sleep Normal (s)",           sleep_normal_buf,     8);
-    WiFiManagerParameter p_slow("sleep_low",     "Sleep Low Battery (s)",      sleep_low_buf,        8);
-    WiFiManagerParameter p_scrit("sleep_crit",   "Sleep Critical Battery (s)", sleep_crit_buf,       8);
-    WiFiManagerParameter p_blow("batt_low",      "Battery Low Voltage",        batt_low_buf,         8);
-    WiFiManagerParameter p_bcrit("batt_crit",    "Battery Critical Voltage",   batt_crit_buf,        8);
-
-    wm.addParameter(&p_server);
-    wm.addParameter(&p_port);
-    wm.addParameter(&p_user);
-    wm.addParameter(&p_pass);
-    wm.addParameter(&p_topic);
-    wm.addParameter(&p_snorm);
-    wm.addParameter(&p_slow);
-    wm.addParameter(&p_scrit);
-    wm.addParameter(&p_blow);
-    wm.addParameter(&p_bcrit);
-
-    static Config* cfg_ptr = nullptr;
-    cfg_ptr = &cfg;
-    static WiFiManagerParameter* params[10];
-    params[0] = &p_server;
-    params[1] = &p_port;
-    params[2] = &p_user;
-    params[3] = &p_pass;
-    params[4] = &p_topic;
-    params[5] = &p_snorm;
-    params[6] = &p_slow;
-    params[7] = &p_scrit;
-    params[8] = &p_blow;
-    params[9] = &p_bcrit;
-
-    static bool portal_save_fired = false;
-    portal_save_fired = false;
-
-    wm.setSaveConfigCallback([]() {
-        Serial.println("[Portal] Save callback fired — writing config");
-        strlcpy(cfg_ptr->mqtt_server,     params[0]->getValue(), sizeof(cfg_ptr->mqtt_server));
-        cfg_ptr->mqtt_port =              atoi(params[1]->getValue());
-        strlcpy(cfg_ptr->mqtt_username,   params[2]->getValue(), sizeof(cfg_ptr->mqtt_username));
-        strlcpy(cfg_ptr->mqtt_password,   params[3]->getValue(), sizeof(cfg_ptr->mqtt_password));
-        strlcpy(cfg_ptr->mqtt_topic_root, params[4]->getValue(), sizeof(cfg_ptr->mqtt_topic_root));
-        cfg_ptr->sleep_normal_s           = atoi(params[5]->getValue());
-        cfg_ptr->sleep_low_battery_s      = atoi(params[6]->getValue());
-        cfg_ptr->sleep_critical_battery_s = atoi(params[7]->getValue());
-        cfg_ptr->battery_low_v            = atof(params[8]->getValue());
-        cfg_ptr->battery_critical_v       = atof(params[9]->getValue());
-        cfg_ptr->wifi_reset = false;
-        config_save(*cfg_ptr);
-        portal_save_fired = true;
-        Serial.println("[Portal] Config saved");
-    });
-
-    wm.setConfigPortalBlocking(false);
-    wm.setConfigPortalTimeout(timeout_s);
-
-    if (use_auto_connect) {
-        wm.autoConnect(ap_name);
-    } else {
-        wm.startConfigPortal(ap_name);
+// -- Helper: phase change — CPU clock policy plus the crash-loop marker ──────
+static void enter_phase(CpuPhase phase) {
+    cpu_phase_begin(phase);
+    boot_guard_mark((uint8_t)phase);
+}
+
+// -- Helper: degraded wake cannot go on without the skipped phase ──────────
+// Backoff sleep; boot_guard_sleep_s() counts the degraded wake.
+static void degraded_sleep(int normal_s) {
+    LOG_W("[Guard] Skipped phase is required — ending the wake\n");
+    sleep_chained((int)boot_guard_sleep_s((uint32_t)normal_s));
+}
+
+// -- Helper: captive portal, unless it is the phase that keeps crashing ─────
+static void open_portal(Config& cfg, const char* ap_name, int timeout_s, bool use_auto_connect) {
+    if (boot_guard_skip(CPU_PHASE_PORTAL)) {
+        degraded_sleep(cfg.sleep_normal_s);
+        return;
     }
+    boot_guard_mark(CPU_PHASE_PORTAL);
+    portal_run_and_reboot(cfg, ap_name, timeout_s, use_auto_connect);
+}
 
-    Serial.printf("[Portal] AP: %s (timeout %ds)\n", ap_name, timeout_s);
+// -- Helper: LED indication mode — "auto" dims on low battery, off on critical
+static LedMode led_mode_for(const Config& cfg, float battery_v) {
+    switch (cfg.led_mode) {
+        case LED_CONFIG_FULL:  return LED_MODE_FULL;
+        case LED_CONFIG_PULSE: return LED_MODE_PULSE;
+        case LED_CONFIG_OFF:   return LED_MODE_OFF;
+        default:               break;
+    }
+    if (battery_v <= cfg.battery_critical_v) return LED_MODE_OFF;
+    if (battery_v <= cfg.battery_low_v)      return LED_MODE_PULSE;
+    return LED_MODE_FULL;
+}
 
-    while (wm.getConfigPortalActive()) {
-        wm.process();
-        led_update_portal(millis());
-        yield();
+// -- Helper: sensor channels from config.json ───────────────────────────────
+// Drivers are set up once the config is known. The sensors stay powered
+// through deep sleep and can convert at once; only after a power-on reset
+// does each channel's settle time count from here.
+static void sensors_begin(const Config& cfg) {
+    bool power_up = ESP.getResetInfoPtr()->reason == REASON_DEFAULT_RST;
+    dht_count = cfg.sensor_count;
+    for (uint8_t c = 0; c < dht_count; c++) {
+        const SensorChannel& ch = cfg.sensors[c];
+        dht_async_begin(dht[c], ch.pin, ch.type == SENSOR_TYPE_DHT22 ? DHT_TYPE_22 : DHT_TYPE_11,
+                        power_up);
+        channel_names[c] = ch.name;
     }
+}
 
-    led_off();
-    if (portal_save_fired) {
-        Serial.println("[Portal] Saved — rebooting");
-        delay(200);
-        ESP.restart();
-    } else {
-        Serial.println("[Portal] Timed out — sleeping 300s");
-        ESP.deepSleep((uint64_t)300 * 1000000ULL);
+// -- Helper: read channels num_reads times, interleaved, average valid reads ─
+// LED: 0.5s on / 0.5s off / 0.5s on / 1s off (double-blink), repeating.
+// Conversions started during the WiFi wait are used as the first reads.
+// Returns the number of channels with a valid average.
+static uint8_t read_sensors(int num_reads, DhtAverage* out, uint8_t count) {
+    led_set_pattern(LED_PATTERN_SENSOR);
+    uint8_t ok = (uint8_t)dht_read_channels(dht, count, num_reads, out);
+    for (uint8_t c = 0; c < count; c++) {
+        if (out[c].valid > 0) continue;
+        LOG_W("[DHT] Channel %u: all reads failed (last: %s)\n", c,
+              dht_error_str(out[c].last_error));
+        log_event(EV_SENSOR_FAIL, (int32_t)((c << 8) | out[c].last_error));
+    }
+    return ok;
+}
+
+// -- Helper: MQTT publish adapter for relayed ESP-NOW frames ─────────────────
+static bool gateway_publish(void* ctx, const char* topic, const char* payload, bool is_status) {
+    PubSubClient& client = *static_cast<PubSubClient*>(ctx);
+    bool ok = is_status ? mqtt_publish_status(client, topic, payload)
+                        : mqtt_publish_measurement(client, topic, payload);
+    LOG_I("[Gateway] %s -> %s%s\n", topic, payload, ok ? "" : " (FAILED)");
+    return ok;
+}
+
+// -- Helper: publish one value over the transport this wake connected with ──
+static bool publish_value(const char* topic, const char* payload, bool is_status) {
+    if (use_mqttsn) {
+        return is_status ? mqtt_publish_status(mqttsn_client, topic, payload)
+                         : mqtt_publish_measurement(mqttsn_client, topic, payload);
+    }
+    return is_status ? mqtt_publish_status(mqtt_client, topic, payload)
+                     : mqtt_publish_measurement(mqtt_client, topic, payload);
+}
+
+// -- Helper: TX power verdict once the wake's publishes are out ────────────
+// A publish or flush that failed at this power steps up for the next wake;
+// a clean one keeps the RSSI and decays the backoff.
+static void txpower_publish_result(bool published, int8_t rssi) {
+    if (published) {
+        txpower_link_ok(rssi);
+        return;
+    }
+    LOG_W("[MQTT] Publish failed at %.2f dBm\n", txpower_dbm(txpower_current()));
+    txpower_failed();
+}
+
+// -- Helper: broker unreachable — error LED 60s, then normal sleep ──────────
+// boot_guard_sleep_s() ends the wake: backoff if degraded, marker cleared.
+static void mqtt_failed_sleep(const Config& cfg, int32_t state) {
+    LOG_W("[MQTT] All attempts failed — error LED 60s → deep sleep\n");
+    log_event(EV_MQTT_FAIL, state);
+    txpower_failed();
+    power_wait(led_error_begin(60000), WAIT_RADIO_OFF);
+    sleep_chained((int)boot_guard_sleep_s((uint32_t)cfg.sleep_normal_s));
+}
+
+// -- Helper: event log sink — one non-retained QoS 0 publish per chunk ──────
+struct LogTopic {
+    PubSubClient* client;
+    const char*   topic;
+};
+
+static bool log_publish(void* ctx, const char* payload) {
+    LogTopic& t = *static_cast<LogTopic*>(ctx);
+    if (use_mqttsn) {
+        return mqttsn_publish(mqttsn_client, mqttsn_topic_id(t.topic), payload, 0, false,
+                              MQTTSN_ACK_TIMEOUT_MS);
     }
+    return t.client->publish(t.topic, payload);
 }
 
 // -- setup: full publish cycle ────────────────────────────────────────────────
 void setup() {
-    Serial.begin(115200);
-    Serial.println("\n[Boot] EnvironmentalSensorV3 starting");
-    dht.begin();
-    led_init();
-
     // -- Chained sleep continuation check ────────────────────────────────────
-    // If RTC magic is present and remaining > 0, continue sleeping without
-    // running the full publish cycle (battery state rechecked on next full wake).
+    // Runs before Serial, DHT or LED init: a continuation wake only reads and
+    // rewrites 8 bytes of RTC memory and goes straight back to sleep. The LED
+    // pin is still an input after reset, so it is already off. The radio was
+    // left disabled by the previous segment and stays disabled unless this
+    // is the last segment before a full publish cycle.
     {
         uint32_t rtc[2];
-        ESP.rtcUserMemoryRead(0, rtc, sizeof(rtc));
+        ESP.rtcUserMemoryRead(RTC_BLOCK_SLEEP, rtc, sizeof(rtc));
         if (rtc[0] == SLEEP_MAGIC && rtc[1] > 0) {
             uint32_t remaining = rtc[1];
-            uint32_t chunk = (remaining > SLEEP_MAX_S) ? SLEEP_MAX_S : remaining;
-            remaining -= chunk;
+            uint32_t chunk     = sleep_next_chunk(remaining, SLEEP_MAX_S);
             rtc[0] = (remaining > 0) ? SLEEP_MAGIC : 0;
             rtc[1] = remaining;
-            ESP.rtcUserMemoryWrite(0, rtc, sizeof(rtc));
-            Serial.printf("[Sleep] Chained: sleeping %us more (%us remaining after)\n",
-                          chunk, remaining);
-            led_off();
-            ESP.deepSleep((uint64_t)chunk * 1000000ULL);
+            ESP.rtcUserMemoryWrite(RTC_BLOCK_SLEEP, rtc, sizeof(rtc));
+            ESP.deepSleep((uint64_t)chunk * 1000000ULL,
+                          (remaining > 0) ? WAKE_RF_DISABLED : WAKE_RF_DEFAULT);
             return;
         }
         // Full publish cycle — clear chained sleep state
         rtc[0] = 0; rtc[1] = 0;
-        ESP.rtcUserMemoryWrite(0, rtc, sizeof(rtc));
+        ESP.rtcUserMemoryWrite(RTC_BLOCK_SLEEP, rtc, sizeof(rtc));
     }
 
+    // Serial only starts when LOG_LEVEL > NONE; the event ring always runs
+    log_begin();
+    log_event(EV_BOOT, (int32_t)ESP.getResetInfoPtr()->reason);
+    LOG_I("\n[Boot] EnvironmentalSensorV3 starting\n");
+
+    // Crash-loop check: classifies this reset against the RTC history. A
+    // degraded wake skips the phase that crashed and sleeps with backoff.
+    if (boot_guard_begin()) {
+        log_event(EV_DEGRADED, boot_guard_state().failing_phase);
+        if (boot_guard_skip(CPU_PHASE_BOOT)) {
+            Config defaults;
+            config_apply_defaults(defaults);
+            degraded_sleep(defaults.sleep_normal_s);
+            return;
+        }
+    }
+    led_init();
+
     // Device identity
     char device_name[16];
     format_device_name(ESP.getChipId(), device_name, sizeof(device_name));
-    Serial.print("[Boot] Device: ");
-    Serial.println(device_name);
+    LOG_I("[Boot] Device: %s\n", device_name);
 
     char ap_name[24];
     snprintf(ap_name, sizeof(ap_name), "EnvSensor-%06x", ESP.getChipId());
 
     // -- Step 1: Load config ──────────────────────────────────────────────────
+    // CPU: 160 MHz for JSON parsing; every later phase announces itself.
+    enter_phase(CPU_PHASE_CONFIG);
     Config cfg;
-    WiFiManager wm;
+    if (boot_guard_skip(CPU_PHASE_CONFIG)) {
+        config_apply_defaults(cfg);
+        degraded_sleep(cfg.sleep_normal_s);
+        return;
+    }
     bool config_ok = config_load(cfg);
 
     if (!config_ok) {
-        Serial.println("[Config] Load failed — opening portal (scenario 2, 5min timeout)");
+        log_event(EV_CONFIG_FAIL);
+        log_event(EV_PORTAL, 2);
+        LOG_W("[Config] Load failed — opening portal (scenario 2, 5min timeout)\n");
         config_apply_defaults(cfg);
-        open_portal_and_reboot(wm, cfg, ap_name, 300, false);
+        open_portal(cfg, ap_name, 300, false);
     }
+    if (cfg.log_dump == LOG_DUMP_SERIAL) log_dump_serial();
+    sensors_begin(cfg);
 
     // -- Step 2: wifi.reset handling (scenario 3) ────────────────────────────
     if (cfg.wifi_reset) {
-        Serial.println("[Config] wifi.reset=true — writing false, clearing creds, opening portal (scenario 3, 5min)");
+        LOG_I("[Config] wifi.reset=true — writing false, clearing creds, opening portal (scenario 3, 5min)\n");
+        log_event(EV_PORTAL, 3);
         cfg.wifi_reset = false;
         config_save(cfg);
         WiFi.disconnect(true);
         delay(200);
-        open_portal_and_reboot(wm, cfg, ap_name, 300, false);
+        open_portal(cfg, ap_name, 300, false);
+    }
+
+    // -- Step 2b: Read battery voltage, pick LED indication mode ──────────────
+    // Read before the radio starts transmitting (quieter ADC); the value is
+    // reused for status, telemetry and sleep selection.
+    int   adc_raw   = analogRead(A0);
+    float battery_v = (float)adc_raw * BATTERY_ADC_SCALE;
+    LOG_I("[Batt] ADC raw=%d  voltage=%.2fV\n", adc_raw, battery_v);
+    led_set_mode(led_mode_for(cfg, battery_v));
+
+    // -- Step 3a: ESP-NOW sensor role — one frame to the gateway, no association
+    // Falls through to the regular WiFi + MQTT path (reusing the readings) if
+    // the gateway does not acknowledge, provided WiFi credentials exist.
+    // The ESP-NOW frame carries one reading: only channel 0 is read there.
+    DhtAverage readings[SENSOR_CHANNELS_MAX] = {};
+    uint8_t    channels_read = 0;  // channels taken so far (0 = not read yet)
+    uint8_t    channels_ok   = 0;
+    if (cfg.espnow_role == ESPNOW_ROLE_SENSOR) {
+        LOG_I("[ESPNOW] Sensor role — reading and sending to gateway\n");
+        enter_phase(CPU_PHASE_SENSOR);
+        channels_read = 1;
+        if (!boot_guard_skip(CPU_PHASE_SENSOR))
+            channels_ok = read_sensors(ESPNOW_NUM_READS, readings, channels_read);
+
+        SensorFrame frame;
+        frame.chip_id   = ESP.getChipId();
+        frame.status    = frame_status_from_str(
+            cycle_status_str(battery_v, cfg.battery_low_v, cfg.battery_critical_v, channels_ok, 1));
+        frame.sensor_ok = channels_ok > 0;
+        frame.temp      = readings[0].temp;
+        frame.hum       = readings[0].hum;
+        frame.battery_v = battery_v;
+
+        if (espnow_sensor_begin(cfg.espnow_gateway_mac, cfg.espnow_channel) &&
+            espnow_send_readings(espnow_radio_link(), cfg.espnow_gateway_mac, frame, ESPNOW_ATTEMPTS)) {
+            log_event(EV_ESPNOW_OK, (int32_t)millis());
+            LOG_I("[ESPNOW] Delivered (%s, %.2fV) after %lums\n",
+                  frame_status_str(frame.status), battery_v, millis());
+            sleep_chained((int)boot_guard_sleep_s((uint32_t)config_sleep_for_battery(cfg, battery_v)));
+            return;
+        }
+        espnow_sensor_end();
+        log_event(EV_ESPNOW_FAIL);
+        LOG_I("[ESPNOW] Gateway did not acknowledge — falling back to WiFi\n");
+        wifi_store_load(wifi_store);
+        if (wifi_store.count == 0) {
+            sleep_chained((int)boot_guard_sleep_s((uint32_t)cfg.sleep_normal_s));
+            return;
+        }
     }
 
     // -- Step 3: First boot — no saved credentials (scenario 1) ──────────────
-    if (!wifi_has_credentials()) {
-        Serial.println("[WiFi] No saved credentials — opening portal (scenario 1, 10min timeout)");
-        open_portal_and_reboot(wm, cfg, ap_name, 600, true);
+    // The store adopts the portal's SDK credentials, so it is empty only when
+    // neither /wifi.json nor the SDK has a network.
+    if (cfg.espnow_role != ESPNOW_ROLE_SENSOR) wifi_store_load(wifi_store);
+    if (wifi_store.count == 0) {
+        LOG_W("[WiFi] No saved credentials — opening portal (scenario 1, 10min timeout)\n");
+        log_event(EV_PORTAL, 1);
+        open_portal(cfg, ap_name, 600, true);
     }
 
+    // Normal publish path from here on — no portal object was ever built.
+    // Heap and elapsed time at this point are the baseline for boot-cost work.
+    LOG_I("[Boot] Normal path: heap free=%u max_block=%u frag=%u%% at %lums\n",
+          ESP.getFreeHeap(), ESP.getMaxFreeBlockSize(),
+          ESP.getHeapFragmentation(), millis());
+
+    // Report number, taken before WiFi: a wake that fails to connect or
+    // publish leaves a gap the analyser (tools/seqstat) counts as loss.
+    const SeqState* seq = cfg.report_seq ? &seq_next() : nullptr;
+
     // -- Step 4: Connect to WiFi ──────────────────────────────────────────────
-    // WiFi.begin() with no args uses saved credentials from last autoConnect() session.
-    // Retry loop inlined here so led_update_wifi() can be called in the polling loop.
-    Serial.println("[WiFi] Connecting with saved credentials...");
+    // Three attempts from the store (WifiStore.h): the cached AP by BSSID and
+    // channel, then stored networks by past success; a full scan only on a
+    // cold start or after repeated failed wakes.
+    // TX power starts at the lowest level the last wake's RSSI allows and
+    // steps up after each failed attempt.
+    // LED: 0.5s on / 0.5s off, repeating.
+    if (boot_guard_skip(CPU_PHASE_WIFI_WAIT)) {
+        degraded_sleep(cfg.sleep_normal_s);
+        return;
+    }
+    led_set_pattern(LED_PATTERN_WIFI);
+    enter_phase(CPU_PHASE_WIFI_WAIT);
+    txpower_begin();
+    int8_t wifi_rssi = 0;
     {
-        bool wifi_connected = false;
+        unsigned long t_wifi = millis();
+        wifi_cache_load(wifi_cache, wifi_store);
 
-        for (int attempt = 1; attempt <= 3 && !wifi_connected; attempt++) {
-            Serial.printf("[WiFi] Attempt %d/3...\n", attempt);
-            WiFi.begin();
-            unsigned long deadline = millis() + 10000UL;
+        WifiAttempt plan[WIFI_PLAN_MAX];
+        size_t planned = 0;
+        if (wifi_plan_needs_scan(wifi_cache, wifi_store)) {
+            planned = wifi_scan_plan(wifi_store, plan, WIFI_PLAN_MAX);
+        }
+        planned += wifi_plan(wifi_store, wifi_cache, plan + planned, WIFI_PLAN_MAX - planned);
+
+        const WifiAttempt* joined = nullptr;
+        for (size_t i = 0; i < planned && !joined; i++) {
+            const WifiAttempt& a = plan[i];
+            LOG_D("[WiFi] Attempt %u/%u: %s \"%s\"...\n", (unsigned)(i + 1), (unsigned)planned,
+                  wifi_strategy_name(a.strategy), wifi_store.nets[a.index].ssid);
+            wifi_attempt_begin(wifi_store, a);
+            // A pinned AP answers within a second or two when it is still there
+            unsigned long deadline = millis() + (a.strategy == WIFI_STRATEGY_CACHED ? 5000UL : 10000UL);
             while (millis() < deadline) {
-                led_update_wifi(millis());
+                // First conversions overlap association; Step 5 picks them up
+                if (channels_read == 0 && !boot_guard_skip(CPU_PHASE_SENSOR)) {
+                    dht_kick_channels(dht, dht_count);
+                }
                 if (WiFi.status() == WL_CONNECTED) {
-                    wifi_connected = true;
+                    joined = &a;
+                    log_event(EV_WIFI_OK, (int32_t)(i + 1));
                     break;
                 }
-                delay(100);
+                power_wait(100, WAIT_ASSOCIATION);
             }
-            if (!wifi_connected) {
-                Serial.printf("[WiFi] Attempt %d/3 failed\n", attempt);
-                if (attempt < 3) {
-                    unsigned long gap_end = millis() + 2000UL;
-                    while (millis() < gap_end) {
-                        led_update_wifi(millis());
-                        delay(100);
-                    }
-                }
+            if (!joined) {
+                LOG_D("[WiFi] Attempt %u/%u failed\n", (unsigned)(i + 1), (unsigned)planned);
+                txpower_failed();
             }
         }
 
-        if (!wifi_connected) {
-            Serial.println("[WiFi] All attempts failed — error LED 60s → deep sleep");
-            led_error_blocking(60000);
-            led_off();
-            ESP.deepSleep((uint64_t)cfg.sleep_normal_s * 1000000ULL);
+        uint32_t connect_ms = millis() - t_wifi;
+        wifi_cache_record(wifi_cache, wifi_store, joined, WiFi.BSSID(), (uint8_t)WiFi.channel(),
+                          connect_ms);
+        wifi_cache_save(wifi_cache);
+
+        if (!joined) {
+            LOG_W("[WiFi] All attempts failed — error LED 60s → deep sleep\n");
+            log_event(EV_WIFI_FAIL);
+            power_wait(led_error_begin(60000), WAIT_RADIO_OFF);
+            sleep_chained((int)boot_guard_sleep_s((uint32_t)cfg.sleep_normal_s));
             return;
         }
-        Serial.print("[WiFi] Connected, IP: ");
-        Serial.println(WiFi.localIP().toString().c_str());
+        wifi_rssi = (int8_t)WiFi.RSSI();
+        LOG_I("[WiFi] Connected via %s to \"%s\" in %lums, IP: %s, RSSI %d dBm at %.2f dBm TX\n",
+              wifi_strategy_name(joined->strategy), wifi_store.nets[joined->index].ssid,
+              (unsigned long)connect_ms, WiFi.localIP().toString().c_str(), wifi_rssi,
+              txpower_dbm(txpower_current()));
+        wifi_cache_report(wifi_cache);
     }
 
-    // -- Step 5: Read sensor ──────────────────────────────────────────────────
-    // LED: 0.5s on / 0.5s off / 0.5s on / 1s off (double-blink), repeating.
-    Serial.println("[DHT] Reading sensor (3 reads, 1s apart)...");
-    float temp     = 0.0f;
-    float hum      = 0.0f;
-    bool sensor_ok = false;
-    {
-        float temp_sum = 0.0f;
-        float hum_sum  = 0.0f;
-        int   valid    = 0;
-
-        for (int i = 0; i < NUM_READS; i++) {
-            float t = dht.readTemperature();
-            float h = dht.readHumidity();
-
-            if (!isnan(t) && !isnan(h)) {
-                temp_sum += t;
-                hum_sum  += h;
-                valid++;
-                Serial.printf("[DHT] Read %d/%d: %.1f C, %.1f%%\n", i + 1, NUM_READS, t, h);
-            } else {
-                Serial.printf("[DHT] Read %d/%d: failed (NaN)\n", i + 1, NUM_READS);
-            }
-
-            if (i < NUM_READS - 1) {
-                unsigned long gap_end = millis() + 1000UL;
-                while (millis() < gap_end) {
-                    led_update_sensor(millis());
-                    delay(10);
-                }
-            }
-        }
-
-        if (valid > 0) {
-            temp      = temp_sum / (float)valid;
-            hum       = hum_sum  / (float)valid;
-            sensor_ok = true;
-            Serial.printf("[DHT] Average: %.1f C, %.1f%% (%d valid reads)\n", temp, hum, valid);
-        } else {
-            Serial.println("[DHT] All reads failed");
-        }
+    // -- Step 5: Read sensors ─────────────────────────────────────────────────
+    // Skipped when the ESP-NOW path already took the readings.
+    if (channels_read == 0) {
+        LOG_D("[DHT] Reading %u channel(s) (3 reads each, interleaved)...\n", dht_count);
+        enter_phase(CPU_PHASE_SENSOR);
+        channels_read = dht_count;
+        if (!boot_guard_skip(CPU_PHASE_SENSOR))
+            channels_ok = read_sensors(NUM_READS, readings, channels_read);
     }
 
-    // -- Step 5b: Read battery voltage ────────────────────────────────────────
-    int   adc_raw   = analogRead(A0);
-    float battery_v = (float)adc_raw * BATTERY_ADC_SCALE;
-    Serial.printf("[Batt] ADC raw=%d  voltage=%.2fV\n", adc_raw, battery_v);
-
-    // Build topics — status: build_topic; temp/hum/volt: build_telemetry_topic
+    // Build topics — status: build_topic; volt/rssi: build_telemetry_topic;
+    // temp/hum per channel with build_channel_topic at publish time
     char topic_status[96];
-    char topic_temp[96];
-    char topic_hum[96];
     char topic_volt[96];
+    char topic_rssi[96];
+    char topic_txp[96];
     build_topic(cfg.mqtt_topic_root,           device_name, "status",      topic_status, sizeof(topic_status));
-    build_telemetry_topic(cfg.mqtt_topic_root, device_name, "temperature", topic_temp,   sizeof(topic_temp));
-    build_telemetry_topic(cfg.mqtt_topic_root, device_name, "humidity",    topic_hum,    sizeof(topic_hum));
     build_telemetry_topic(cfg.mqtt_topic_root, device_name, "voltage",     topic_volt,   sizeof(topic_volt));
+    build_telemetry_topic(cfg.mqtt_topic_root, device_name, "rssi",        topic_rssi,   sizeof(topic_rssi));
+    build_telemetry_topic(cfg.mqtt_topic_root, device_name, "tx_power",    topic_txp,    sizeof(topic_txp));
 
     // -- Step 6: Connect to MQTT ──────────────────────────────────────────────
     // LED: 0.5s on / 0.5s off / 1s on, repeating.
-    Serial.println("[MQTT] Connecting...");
-    {
+    // mqtt.transport = "mqttsn": CONNECT/CONNACK over UDP to the MQTT-SN
+    // gateway at mqtt.server instead of a TCP session. The ESP-NOW gateway
+    // role stays on TCP — it holds its session open and relays from loop().
+    if (boot_guard_skip(CPU_PHASE_MQTT_WAIT)) {
+        degraded_sleep(cfg.sleep_normal_s);
+        return;
+    }
+    LOG_D("[MQTT] Connecting...\n");
+    led_set_pattern(LED_PATTERN_MQTT);
+    enter_phase(CPU_PHASE_MQTT_WAIT);
+    use_mqttsn = (cfg.mqtt_transport == MQTT_TRANSPORT_MQTTSN &&
+                  cfg.espnow_role != ESPNOW_ROLE_GATEWAY);
+    if (use_mqttsn) {
+        bool sn_ok = mqttsn_udp_begin(mqttsn_udp, cfg.mqtt_server, (uint16_t)cfg.mqttsn_port);
+        if (sn_ok) {
+            mqttsn_client_init(mqttsn_client, mqttsn_udp_transport(mqttsn_udp));
+            mqttsn_client.channels      = channel_names;
+            mqttsn_client.channel_count = dht_count;
+            sn_ok = mqtt_connect(mqttsn_client, device_name, 3, 1);
+        }
+        if (!sn_ok) {
+            mqtt_failed_sleep(cfg, mqttsn_client.last_rc);
+            return;
+        }
+        log_event(EV_MQTT_OK, mqttsn_client.datagrams);
+    } else {
         bool mqtt_ok = false;
 
-        static WiFiClient wifi_client_mqtt;
-        mqtt_client.setClient(wifi_client_mqtt);
+        mqtt_client.setClient(mqtt_transport);
         mqtt_client.setServer(cfg.mqtt_server, cfg.mqtt_port);
         mqtt_client.setKeepAlive(60);
 
         for (int attempt = 1; attempt <= 3 && !mqtt_ok; attempt++) {
-            Serial.printf("[MQTT] Attempt %d/3...\n", attempt);
+            LOG_D("[MQTT] Attempt %d/3...\n", attempt);
             mqtt_client.connect(device_name,
                                 cfg.mqtt_username, cfg.mqtt_password,
                                 topic_status, 1, true, "OFFLINE");
             unsigned long deadline = millis() + 5000UL;
             while (millis() < deadline) {
-                led_update_mqtt(millis());
                 if (mqtt_client.connected()) {
                     mqtt_ok = true;
+                    log_event(EV_MQTT_OK, attempt);
                     break;
                 }
-                delay(100);
+                power_wait(100, WAIT_NETWORK);
             }
             if (!mqtt_ok) {
-                Serial.printf("[MQTT] Attempt %d/3 failed, state=%d\n", attempt, mqtt_client.state());
-                if (attempt < 3) {
-                    unsigned long gap_end = millis() + 2000UL;
-                    while (millis() < gap_end) {
-                        led_update_mqtt(millis());
-                        delay(100);
-                    }
-                }
+                LOG_D("[MQTT] Attempt %d/3 failed, state=%d\n", attempt, mqtt_client.state());
+                if (attempt < 3) power_wait(2000, WAIT_RETRY_GAP);
             }
         }
 
         if (!mqtt_ok) {
-            Serial.println("[MQTT] All attempts failed — error LED 60s → deep sleep");
-            led_error_blocking(60000);
-            led_off();
-            ESP.deepSleep((uint64_t)cfg.sleep_normal_s * 1000000ULL);
+            mqtt_failed_sleep(cfg, mqtt_client.state());
             return;
         }
-        Serial.println("[MQTT] Connected");
+        LOG_I("[MQTT] Connected\n");
+        // Steps 7–11 (PUBLISHes + DISCONNECT) leave in a single TCP segment
+        mqtt_transport.begin_burst();
     }
 
-    // -- Step 7: Publish status (battery priority > sensor state) ─────────────
-    const char* batt_str   = battery_status_str(battery_v, cfg.battery_low_v, cfg.battery_critical_v);
-    const char* status_str = batt_str ? batt_str : (sensor_ok ? "OK" : "NOK");
-    mqtt_publish_status(mqtt_client, topic_status, status_str);
-    Serial.printf("[MQTT] Published status: %s -> %s\n", topic_status, status_str);
+    // -- Step 6b: Fault report (degraded wake) ───────────────────────────────
+    // Goes out first, so it is delivered even if a later phase crashes again.
+    enter_phase(CPU_PHASE_ENCODE);
+    bool published = true;  // every publish and the final flush; drives TX power
+    if (boot_guard_degraded()) {
+        char topic_fault[96];
+        char fault[64];
+        build_topic(cfg.mqtt_topic_root, device_name, "fault", topic_fault, sizeof(topic_fault));
+        boot_guard_format(boot_guard_state(), fault, sizeof(fault));
+        published &= publish_value(topic_fault, fault, false);
+        LOG_W("[Guard] Fault report: %s -> %s\n", topic_fault, fault);
+    }
 
-    // -- Steps 8 & 9: Publish temperature and humidity (if sensor read succeeded)
-    if (sensor_ok) {
-        char val_buf[16];
+    // Steps 7–9d are the regular report; a crash loop in them skips them all
+    if (!boot_guard_skip(CPU_PHASE_ENCODE)) {
+        // -- Step 7: Publish status (battery > all channels > some channels) ─
+        // report.seq appends ";seq=N;ep=E;up=MS" (SeqCounter.h)
+        char status_buf[64];
+        const char* status_str = cycle_status_str(battery_v, cfg.battery_low_v, cfg.battery_critical_v,
+                                                  channels_ok, channels_read);
+        if (seq) {
+            size_t n = strlcpy(status_buf, status_str, sizeof(status_buf));
+            seq_format(*seq, millis(), status_buf + n, sizeof(status_buf) - n);
+            status_str = status_buf;
+        }
+        published &= publish_value(topic_status, status_str, true);
+        LOG_D("[MQTT] Published status: %s -> %s\n", topic_status, status_str);
+
+        // -- Steps 8 & 9: Publish temperature and humidity per channel read ──
+        for (uint8_t c = 0; c < channels_read; c++) {
+            if (readings[c].valid == 0) continue;
+            char topic_ch[96];
+            char val_buf[16];
+
+            build_channel_topic(cfg.mqtt_topic_root, device_name, channel_names[c], "temperature",
+                                topic_ch, sizeof(topic_ch));
+            format_float_1dp(readings[c].temp, val_buf, sizeof(val_buf));
+            published &= publish_value(topic_ch, val_buf, false);
+            LOG_D("[MQTT] Published temperature: %s -> %s\n", topic_ch, val_buf);
+
+            build_channel_topic(cfg.mqtt_topic_root, device_name, channel_names[c], "humidity",
+                                topic_ch, sizeof(topic_ch));
+            format_float_1dp(readings[c].hum, val_buf, sizeof(val_buf));
+            published &= publish_value(topic_ch, val_buf, false);
+            LOG_D("[MQTT] Published humidity: %s -> %s\n", topic_ch, val_buf);
+        }
 
-        format_float_1dp(temp, val_buf, sizeof(val_buf));
-        mqtt_publish_measurement(mqtt_client, topic_temp, val_buf);
-        Serial.printf("[MQTT] Published temperature: %s -> %s\n", topic_temp, val_buf);
+        // -- Step 9b: Publish battery voltage (always published) ──────────────
+        {
+            char volt_buf[16];
+            format_float_2dp(battery_v, volt_buf, sizeof(volt_buf));
+            published &= publish_value(topic_volt, volt_buf, false);
+            LOG_D("[MQTT] Published voltage: %s -> %s\n", topic_volt, volt_buf);
+        }
 
-        format_float_1dp(hum, val_buf, sizeof(val_buf));
-        mqtt_publish_measurement(mqtt_client, topic_hum, val_buf);
-        Serial.printf("[MQTT] Published humidity: %s -> %s\n", topic_hum, val_buf);
+        // -- Step 9c: Publish link diagnostics (RSSI, TX power in effect) ─────
+        {
+            char link_buf[16];
+            snprintf(link_buf, sizeof(link_buf), "%d", wifi_rssi);
+            published &= publish_value(topic_rssi, link_buf, false);
+            format_float_2dp(txpower_dbm(txpower_current()), link_buf, sizeof(link_buf));
+            published &= publish_value(topic_txp, link_buf, false);
+            LOG_D("[MQTT] Published link: rssi=%d tx_power=%s\n", wifi_rssi, link_buf);
+        }
+
+        // -- Step 9d: Event log dump (log.dump = "mqtt") ─────────────────────
+        // Sends entries recorded since the last successful dump, including those
+        // from wakes that never reached the broker.
+        if (cfg.log_dump == LOG_DUMP_MQTT) {
+            char topic_log[96];
+            build_topic(cfg.mqtt_topic_root, device_name, "log", topic_log, sizeof(topic_log));
+            LogTopic sink = { &mqtt_client, topic_log };
+            size_t sent = event_log_drain(log_events(), log_publish, &sink, LOG_DUMP_CHUNK);
+            log_events_commit();
+            LOG_I("[Log] Sent %u events -> %s\n", (unsigned)sent, topic_log);
+            (void)sent;  // only read by LOG_I
+        }
     }
 
-    // -- Step 9b: Publish battery voltage (always published) ──────────────────
-    {
-        char volt_buf[16];
-        format_float_2dp(battery_v, volt_buf, sizeof(volt_buf));
-        mqtt_publish_measurement(mqtt_client, topic_volt, volt_buf);
-        Serial.printf("[MQTT] Published voltage: %s -> %s\n", topic_volt, volt_buf);
+    // -- Gateway role: stay connected and relay ESP-NOW frames from loop() ────
+    if (cfg.espnow_role == ESPNOW_ROLE_GATEWAY) {
+        gw_cfg = cfg;
+        strlcpy(gw_device_name,  device_name,  sizeof(gw_device_name));
+        strlcpy(gw_topic_status, topic_status, sizeof(gw_topic_status));
+        led_off();
+        published &= mqtt_transport.end_burst();
+        cpu_phase_report();
+        cpu_phase_begin(CPU_PHASE_MQTT_WAIT);
+        if (espnow_gateway_begin(cfg.espnow_sensors, cfg.espnow_sensor_count)) {
+            txpower_publish_result(published, wifi_rssi);
+            // Relay marker: a later reset pin or power blip is not a crash;
+            // watchdog and exception resets count but never skip a phase.
+            boot_guard_mark(BOOT_GUARD_PHASE_RELAY);
+            return;
+        }
+        LOG_W("[ESPNOW] Gateway init failed — continuing as sensor\n");
     }
 
     // -- Steps 10 & 11: Flush send buffer and disconnect ──────────────────────
-    mqtt_flush_and_disconnect(mqtt_client);
-    Serial.println("[MQTT] Disconnected");
+    // MQTT-SN: the DISCONNECT carries the sleep duration so the gateway keeps
+    // the session and treats the client as asleep rather than lost; the next
+    // wake's CONNECT (CleanSession off) resumes it.
+    int sleep_s = (int)boot_guard_sleep_s((uint32_t)config_sleep_for_battery(cfg, battery_v));
+    if (use_mqttsn) {
+        published &= mqtt_flush_and_disconnect(mqttsn_client, sleep_s);
+        LOG_I("[MQTT-SN] Disconnected (%u datagrams, %u round trips, %lums awake)\n",
+              (unsigned)mqttsn_client.datagrams, (unsigned)mqttsn_client.round_trips, millis());
+    } else {
+        published &= mqtt_flush_and_disconnect(mqtt_client);
+        published &= mqtt_transport.burst_ok();
+        LOG_I("[MQTT] Disconnected (%u TCP writes this session, %lums awake)\n",
+              (unsigned)mqtt_transport.segments(), millis());
+    }
+
+    txpower_publish_result(published, wifi_rssi);
 
     // -- Step 13: Battery-based sleep (led_off called inside sleep_chained) ───
-    int sleep_s;
-    if (battery_v <= cfg.battery_critical_v)
-        sleep_s = cfg.sleep_critical_battery_s;
-    else if (battery_v <= cfg.battery_low_v)
-        sleep_s = cfg.sleep_low_battery_s;
-    else
-        sleep_s = cfg.sleep_normal_s;
-
-    Serial.printf("[Sleep] battery=%.2fV -> sleep %ds\n", battery_v, sleep_s);
+
+    LOG_I("[Sleep] battery=%.2fV -> sleep %ds\n", battery_v, sleep_s);
     sleep_chained(sleep_s);
 }
 
 void loop() {
-    // Never reached — ESP8266 restarts from setup() after each deep sleep wake
+    // Sensor roles never get here — ESP8266 restarts from setup() after each
+    // deep sleep wake. Gateway role: keep MQTT alive and relay queued frames.
+    static unsigned long next_reconnect = 0;
+
+    if (!mqtt_client.connected()) {
+        if (millis() >= next_reconnect) {
+            LOG_I("[Gateway] MQTT disconnected — reconnecting\n");
+            mqtt_client.connect(gw_device_name,
+                                gw_cfg.mqtt_username, gw_cfg.mqtt_password,
+                                gw_topic_status, 1, true, "OFFLINE");
+            next_reconnect = millis() + 5000UL;
+        }
+        delay(10);
+        return;
+    }
+
+    mqtt_client.loop();
+    espnow_gateway_poll(gw_cfg.mqtt_topic_root, gateway_publish, &mqtt_client);
+    delay(10);
 }
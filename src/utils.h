@@ -31,9 +31,171 @@ inline void build_telemetry_topic(const char* root, const char* device,
     snprintf(buf, len, "%s/%s/telemetry/%s", root, device, sub);
 }
 
+// Per-channel sub-topic: {root}/{device}/telemetry/{channel}/{metric}.
+// An empty channel is the single-sensor layout of build_telemetry_topic.
+inline void build_channel_topic(const char* root, const char* device, const char* channel,
+                                const char* metric, char* buf, size_t len) {
+    if (!channel || channel[0] == '\0') {
+        build_telemetry_topic(root, device, metric, buf, len);
+        return;
+    }
+    snprintf(buf, len, "%s/%s/telemetry/%s/%s", root, device, channel, metric);
+}
+
 // returns "BAT_CRIT", "BAT_LOW", or nullptr (no battery issue)
 inline const char* battery_status_str(float battery_v, float low_v, float critical_v) {
     if (battery_v <= critical_v) return "BAT_CRIT";
     if (battery_v <= low_v)      return "BAT_LOW";
     return nullptr;
 }
+
+// Status priority: battery state first, then sensor state ("OK" / "NOK")
+inline const char* cycle_status_str(float battery_v, float low_v, float critical_v, bool sensor_ok) {
+    const char* batt = battery_status_str(battery_v, low_v, critical_v);
+    if (batt) return batt;
+    return sensor_ok ? "OK" : "NOK";
+}
+
+// Multi-channel variant: "NOK" when no channel read, "DEGRADED" when only
+// some did. Battery state still wins.
+inline const char* cycle_status_str(float battery_v, float low_v, float critical_v,
+                                    uint8_t channels_ok, uint8_t channels) {
+    const char* batt = battery_status_str(battery_v, low_v, critical_v);
+    if (batt) return batt;
+    if (channels_ok == 0)       return "NOK";
+    if (channels_ok < channels) return "DEGRADED";
+    return "OK";
+}
+
+#define SLEEP_MAX_S 4294  // ESP8266 deep sleep hardware limit (~71 min)
+
+// Chained deep sleep: returns the segment to sleep now (at most max_s) and
+// leaves the balance in remaining_s.
+inline uint32_t sleep_next_chunk(uint32_t& remaining_s, uint32_t max_s) {
+    uint32_t chunk = (remaining_s > max_s) ? max_s : remaining_s;
+    remaining_s -= chunk;
+    return chunk;
+}
+
+// Parses "aa:bb:cc:dd:ee:ff" (case-insensitive). Returns false on bad input.
+inline bool parse_mac(const char* str, uint8_t mac[6]) {
+    if (!str) return false;
+    unsigned int b[6];
+    char tail;
+    if (sscanf(str, "%2x:%2x:%2x:%2x:%2x:%2x%c",
+               &b[0], &b[1], &b[2], &b[3], &b[4], &b[5], &tail) != 6) return false;
+    for (int i = 0; i < 6; i++) mac[i] = (uint8_t)b[i];
+    return true;
+}
+
+inline void format_mac(const uint8_t mac[6], char* buf, size_t len) {
+    snprintf(buf, len, "%02x:%02x:%02x:%02x:%02x:%02x",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+}
+
+// -- Topic parsing (inverse of build_topic / build_telemetry_topic) ──────────
+// Zero-copy: spans point into the caller's topic buffer and are not
+// NUL-terminated. Shared by the firmware and the host-side ingest tools.
+
+struct TopicSpan {
+    const char* ptr;
+    size_t      len;
+};
+
+enum TopicKind {
+    TOPIC_UNKNOWN,
+    TOPIC_STATUS,     // {root}/{device}/status
+    TOPIC_TELEMETRY   // {root}/{device}/telemetry/[{channel}/]{metric}
+};
+
+struct ParsedTopic {
+    TopicKind kind;
+    TopicSpan root;
+    TopicSpan device;
+    TopicSpan channel;  // empty for TOPIC_STATUS and single-channel telemetry
+    TopicSpan metric;   // empty for TOPIC_STATUS
+};
+
+inline bool topic_span_equals(TopicSpan s, const char* lit) {
+    size_t n = strlen(lit);
+    return s.len == n && memcmp(s.ptr, lit, n) == 0;
+}
+
+// Returns the segment ending at `end` (exclusive), scanning back to the
+// previous '/' or to `begin`.
+inline TopicSpan topic_prev_segment(const char* begin, const char* end) {
+    const char* p = end;
+    while (p > begin && p[-1] != '/') p--;
+    TopicSpan s = { p, (size_t)(end - p) };
+    return s;
+}
+
+// Splits from the right so nested roots ("home/env") are preserved intact.
+// Returns false (kind = TOPIC_UNKNOWN) for anything outside the layout.
+inline bool parse_topic(const char* topic, size_t len, ParsedTopic& out) {
+    out.kind   = TOPIC_UNKNOWN;
+    out.root   = { topic, 0 };
+    out.device  = { topic, 0 };
+    out.channel = { topic + len, 0 };
+    out.metric  = { topic + len, 0 };
+
+    const char* begin = topic;
+    const char* end   = topic + len;
+
+    TopicSpan last = topic_prev_segment(begin, end);
+    if (last.len == 0 || last.ptr == begin) return false;
+    const char* cursor = last.ptr - 1;  // points at '/'
+
+    TopicKind kind;
+    if (topic_span_equals(last, "status")) {
+        kind = TOPIC_STATUS;
+    } else {
+        TopicSpan tele = topic_prev_segment(begin, cursor);
+        if (!topic_span_equals(tele, "telemetry") && tele.len > 0 && tele.ptr != begin) {
+            out.channel = tele;  // telemetry/{channel}/{metric}
+            tele = topic_prev_segment(begin, tele.ptr - 1);
+        }
+        if (!topic_span_equals(tele, "telemetry") || tele.ptr == begin) return false;
+        out.metric = last;
+        cursor = tele.ptr - 1;
+        kind = TOPIC_TELEMETRY;
+    }
+
+    TopicSpan device = topic_prev_segment(begin, cursor);
+    if (device.len == 0 || device.ptr == begin) return false;
+    TopicSpan root = { begin, (size_t)(device.ptr - 1 - begin) };
+    if (root.len == 0) return false;
+
+    out.kind   = kind;
+    out.root   = root;
+    out.device = device;
+    return true;
+}
+
+// Parses the decimal payloads produced by format_float_1dp / format_float_2dp
+// ("22.5", "-3.0", "3.87"). Rejects anything else, including empty input.
+inline bool parse_decimal_payload(const char* s, size_t len, float& out) {
+    size_t i = 0;
+    bool neg = false;
+    if (i < len && (s[i] == '-' || s[i] == '+')) { neg = (s[i] == '-'); i++; }
+    uint32_t int_part = 0;
+    uint32_t frac     = 0;
+    uint32_t frac_div = 1;
+    size_t digits = 0;
+    while (i < len && s[i] >= '0' && s[i] <= '9') {
+        int_part = int_part * 10 + (uint32_t)(s[i] - '0');
+        i++; digits++;
+    }
+    if (i < len && s[i] == '.') {
+        i++;
+        while (i < len && s[i] >= '0' && s[i] <= '9' && frac_div < 1000000) {
+            frac = frac * 10 + (uint32_t)(s[i] - '0');
+            frac_div *= 10;
+            i++; digits++;
+        }
+    }
+    if (digits == 0 || i != len) return false;
+    float v = (float)int_part + (float)frac / (float)frac_div;
+    out = neg ? -v : v;
+    return true;
+}
@@ -4,12 +4,45 @@
 //
 // Tests covered:
 //   - format_device_name, build_topic, format_float_1dp (utils.h)
-//   - config_apply_defaults (ConfigManager.h)
+//   - config_apply_defaults, config_normalize_sensors, config_sensor_pin(_ok), CONFIG_JSON_SLOTS/_STRINGS (ConfigManager.h)
+//   - build_channel_topic, parse_topic, parse_decimal_payload (utils.h)
+//   - ingest_split_line, ingest_decode_batch, ingest_format_record (TelemetryIngest.h)
+//   - cycle_status_str, config_sleep_for_battery, policy_simulate (PolicySim.h)
+//   - led_pattern_step (LedIndicator.h)
+//   - WriteCoalescer: MQTT publish burst segment count (WriteCoalescer.h)
+//   - cpu_phase_mhz, cpu_phase_log_switch (CpuPolicy.h)
+//   - ESP-NOW frame codec, sender and gateway over a simulated link, sender allow-list (EspNowLink.h)
+//   - event_log_push, event_log_begin_wake, event_log_drain (Log.h)
+//   - MQTT-SN topic IDs, client wake against the gateway stand-in (MqttSn.h)
+//   - dht_decode_edges on recorded edge timestamps (DhtAsync.h)
+//   - txpower_choose, txpower_record_failure/success (TxPower.h)
+//   - wifi_store_add, wifi_store_adopt, wifi_plan, wifi_rank_scan, wifi_cache_record (WifiStore.h)
+//   - boot_guard_on_boot, boot_guard_skips, boot_guard_backoff_s, boot_guard_format (BootGuard.h)
+//   - seq_restore, seq_advance, seq_format, seq_parse (SeqCounter.h)
+//   - seq_stats_add, seq_stats_loss, seq_stats_up/rx_percentile (SeqStats.h)
+//   - portal_idle_ms, portal_duty_* (PortalIdle.h)
+//   - power_wait_mode, power_wait_slice_ms (PowerWait.h)
 
 #include <unity.h>
 #include <string.h>
 #include "utils.h"
 #include "ConfigManager.h"
+#include "TelemetryIngest.h"
+#include "EspNowLink.h"
+#include "PolicySim.h"
+#include "LedIndicator.h"
+#include "WriteCoalescer.h"
+#include "CpuPolicy.h"
+#include "Log.h"
+#include "MqttSn.h"
+#include "DhtAsync.h"
+#include "TxPower.h"
+#include "WifiStore.h"
+#include "BootGuard.h"
+#include "SeqCounter.h"
+#include "SeqStats.h"
+#include "PortalIdle.h"
+#include "PowerWait.h"
 
 void setUp(void) {}
 void tearDown(void) {}
@@ -74,6 +107,17 @@ void test_defaults_all_fields(void) {
     TEST_ASSERT_EQUAL_INT(86400, cfg.sleep_critical_battery_s);
     TEST_ASSERT_FLOAT_WITHIN(0.001f, 3.5f, cfg.battery_low_v);
     TEST_ASSERT_FLOAT_WITHIN(0.001f, 3.40f, cfg.battery_critical_v);
+    TEST_ASSERT_EQUAL_INT(ESPNOW_ROLE_OFF, cfg.espnow_role);
+    TEST_ASSERT_EQUAL_INT(1, cfg.espnow_channel);
+    TEST_ASSERT_EQUAL_INT(0, cfg.espnow_sensor_count);
+    TEST_ASSERT_EQUAL_INT(LOG_DUMP_OFF, cfg.log_dump);
+    TEST_ASSERT_EQUAL_INT(MQTT_TRANSPORT_TCP, cfg.mqtt_transport);
+    TEST_ASSERT_EQUAL_INT(10000, cfg.mqttsn_port);
+    TEST_ASSERT_FALSE(cfg.report_seq);
+    TEST_ASSERT_EQUAL_INT(1, cfg.sensor_count);
+    TEST_ASSERT_EQUAL_STRING("", cfg.sensors[0].name);
+    TEST_ASSERT_EQUAL_INT(14, cfg.sensors[0].pin);
+    TEST_ASSERT_EQUAL_INT(SENSOR_TYPE_DHT11, cfg.sensors[0].type);
 }
 
 void test_defaults_unconditional_overwrite(void) {
@@ -93,6 +137,140 @@ void test_defaults_unconditional_overwrite(void) {
     TEST_ASSERT_EQUAL_INT(300, cfg.sleep_low_battery_s);
 }
 
+// ── config: config_normalize_sensors ─────────────────────────────────────────
+
+static void set_sensor(SensorChannel& ch, const char* name, uint8_t pin, uint8_t type) {
+    strcpy(ch.name, name);
+    ch.pin  = pin;
+    ch.type = type;
+}
+
+void test_config_normalize_sensors(void) {
+    Config cfg;
+    config_apply_defaults(cfg);
+    cfg.sensor_count = 4;
+    set_sensor(cfg.sensors[0], "",       14, SENSOR_TYPE_DHT11);
+    set_sensor(cfg.sensors[1], "return", 14, SENSOR_TYPE_DHT22);  // pin taken
+    set_sensor(cfg.sensors[2], "a/b",    12, SENSOR_TYPE_DHT22);  // not one segment
+    set_sensor(cfg.sensors[3], "ch0",    13, SENSOR_TYPE_DHT22);
+    config_normalize_sensors(cfg);
+    TEST_ASSERT_EQUAL_INT(2, cfg.sensor_count);
+    TEST_ASSERT_EQUAL_STRING("ch1", cfg.sensors[0].name);  // "ch0" is user-chosen
+    TEST_ASSERT_EQUAL_INT(14, cfg.sensors[0].pin);
+    TEST_ASSERT_EQUAL_STRING("ch0", cfg.sensors[1].name);
+    TEST_ASSERT_EQUAL_INT(13, cfg.sensors[1].pin);
+
+    // A single channel keeps the legacy unnamed layout; nothing valid = default
+    cfg.sensor_count = 1;
+    set_sensor(cfg.sensors[0], "", 5, SENSOR_TYPE_DHT22);
+    config_normalize_sensors(cfg);
+    TEST_ASSERT_EQUAL_STRING("", cfg.sensors[0].name);
+    cfg.sensor_count = 2;
+    set_sensor(cfg.sensors[0], "telemetry", 4, SENSOR_TYPE_DHT11);
+    set_sensor(cfg.sensors[1], "x", 17, SENSOR_TYPE_DHT11);
+    config_normalize_sensors(cfg);
+    TEST_ASSERT_EQUAL_INT(1, cfg.sensor_count);
+    TEST_ASSERT_EQUAL_INT(14, cfg.sensors[0].pin);
+}
+
+void test_config_sensor_pins_allowed(void) {
+    TEST_ASSERT_TRUE(config_sensor_pin_ok(14));
+    TEST_ASSERT_TRUE(config_sensor_pin_ok(0));
+    TEST_ASSERT_FALSE(config_sensor_pin_ok(3));   // Serial RX
+    TEST_ASSERT_FALSE(config_sensor_pin_ok(7));   // SPI flash
+    TEST_ASSERT_FALSE(config_sensor_pin_ok(16));  // no pin-change interrupt
+
+    // 270 would wrap to GPIO14; -1 to 255
+    TEST_ASSERT_EQUAL_UINT8(SENSOR_PIN_NONE, config_sensor_pin(270));
+    TEST_ASSERT_EQUAL_UINT8(SENSOR_PIN_NONE, config_sensor_pin(-1));
+    TEST_ASSERT_EQUAL_UINT8(12, config_sensor_pin(12));
+
+    Config cfg;
+    config_apply_defaults(cfg);
+    cfg.sensor_count = 3;
+    set_sensor(cfg.sensors[0], "a", 9, SENSOR_TYPE_DHT11);
+    set_sensor(cfg.sensors[1], "b", 16, SENSOR_TYPE_DHT11);
+    set_sensor(cfg.sensors[2], "c", config_sensor_pin(270), SENSOR_TYPE_DHT11);
+    config_normalize_sensors(cfg);
+    TEST_ASSERT_EQUAL_INT(1, cfg.sensor_count);  // all dropped: default restored
+    TEST_ASSERT_EQUAL_STRING("", cfg.sensors[0].name);
+}
+
+// ── config: worst-case /config.json fits CONFIG_JSON_SLOTS / _STRINGS ───────
+// The native env has no ArduinoJson; this walks the document the way its
+// deserializer allocates: one slot per object member or array element, and
+// a copy (with NUL) of every key and string value.
+
+struct JsonCost {
+    size_t slots;
+    size_t strings;
+};
+
+static JsonCost json_cost(const char* p) {
+    JsonCost cost  = { 0, 0 };
+    char     stack[8];             // '{' or '['
+    int      depth = 0;
+    bool     element_next = false;  // in an array, before a value
+    for (; *p; p++) {
+        char c = *p;
+        if (element_next && c != ']') {
+            cost.slots++;
+            element_next = false;
+        }
+        switch (c) {
+        case '{':
+        case '[': stack[depth++] = c; element_next = (c == '['); break;
+        case '}':
+        case ']': depth--; break;
+        case ',': element_next = (stack[depth - 1] == '['); break;
+        case ':': cost.slots++; break;  // object member
+        case '"': {
+            const char* end = strchr(p + 1, '"');
+            cost.strings += (size_t)(end - p);  // characters + NUL
+            p = end;
+            break;
+        }
+        }
+    }
+    return cost;
+}
+
+void test_config_json_worst_case_fits(void) {
+    char max64[64];
+    memset(max64, 'x', sizeof(max64) - 1);
+    max64[sizeof(max64) - 1] = '\0';
+    char name[SENSOR_NAME_LEN];
+    memset(name, 'n', sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+
+    static char json[4096];
+    size_t n = (size_t)snprintf(json, sizeof(json),
+        "{\"wifi\":{\"reset\":false},"
+        "\"mqtt\":{\"server\":\"%s\",\"port\":1883,\"topic_root\":\"%s\",\"username\":\"%s\","
+        "\"password\":\"%s\",\"transport\":\"mqttsn\",\"sn_port\":10000},"
+        "\"sleep\":{\"normal_s\":60,\"low_battery_s\":300,\"critical_battery_s\":86400},"
+        "\"battery\":{\"low_v\":3.5,\"critical_v\":3.4},"
+        "\"espnow\":{\"role\":\"gateway\",\"gateway_mac\":\"00:00:00:00:00:00\",\"channel\":1,"
+        "\"sensors\":[", max64, max64, max64, max64);
+    for (int i = 0; i < ESPNOW_SENSORS_MAX; i++) {
+        n += (size_t)snprintf(json + n, sizeof(json) - n, "%s\"5c:cf:7f:00:00:%02x\"",
+                              i ? "," : "", i);
+    }
+    n += (size_t)snprintf(json + n, sizeof(json) - n,
+        "]},\"led\":{\"mode\":\"pulse\"},\"log\":{\"dump\":\"serial\"},\"report\":{\"seq\":true},"
+        "\"sensors\":[");
+    for (int i = 0; i < SENSOR_CHANNELS_MAX; i++) {
+        n += (size_t)snprintf(json + n, sizeof(json) - n,
+                              "%s{\"name\":\"%s\",\"pin\":%d,\"type\":\"dht11\"}", i ? "," : "",
+                              name, 12 + i);
+    }
+    snprintf(json + n, sizeof(json) - n, "]}");
+
+    JsonCost cost = json_cost(json);
+    TEST_ASSERT_EQUAL_UINT32(CONFIG_JSON_SLOTS, cost.slots);
+    TEST_ASSERT_EQUAL_UINT32(CONFIG_JSON_STRINGS, cost.strings);
+}
+
 // ── utils: build_telemetry_topic ─────────────────────────────────────────────
 
 void test_build_telemetry_topic_standard(void) {
@@ -126,6 +304,1182 @@ void test_battery_status_str_boundary_crit(void) {
     TEST_ASSERT_EQUAL_STRING("BAT_CRIT", battery_status_str(3.2f, 3.5f, 3.2f));
 }
 
+// ── utils: sleep_next_chunk ──────────────────────────────────────────────────
+
+void test_sleep_next_chunk_critical_battery(void) {
+    // 86400s in 4294s segments: 20 full segments + 520s, radio needed only
+    // for the wake that follows the final segment (remaining == 0)
+    uint32_t remaining = 86400;
+    int segments = 0;
+    uint32_t total = 0;
+    while (remaining > 0) {
+        total += sleep_next_chunk(remaining, 4294);
+        segments++;
+    }
+    TEST_ASSERT_EQUAL_INT(21, segments);
+    TEST_ASSERT_EQUAL_UINT32(86400, total);
+}
+
+void test_sleep_next_chunk_short(void) {
+    uint32_t remaining = 60;
+    TEST_ASSERT_EQUAL_UINT32(60, sleep_next_chunk(remaining, 4294));
+    TEST_ASSERT_EQUAL_UINT32(0, remaining);
+}
+
+// ── utils: parse_topic ───────────────────────────────────────────────────────
+
+void test_parse_topic_roundtrip_telemetry(void) {
+    char buf[96];
+    build_telemetry_topic("home/env", "esp-a1b2c3", "humidity", buf, sizeof(buf));
+    ParsedTopic t;
+    TEST_ASSERT_TRUE(parse_topic(buf, strlen(buf), t));
+    TEST_ASSERT_EQUAL_INT(TOPIC_TELEMETRY, t.kind);
+    TEST_ASSERT_TRUE(topic_span_equals(t.root, "home/env"));
+    TEST_ASSERT_TRUE(topic_span_equals(t.device, "esp-a1b2c3"));
+    TEST_ASSERT_TRUE(topic_span_equals(t.metric, "humidity"));
+    TEST_ASSERT_EQUAL_INT(0, t.channel.len);
+}
+
+void test_parse_topic_roundtrip_channel(void) {
+    char buf[96];
+    build_channel_topic("home/env", "esp-a1b2c3", "supply", "temperature", buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("home/env/esp-a1b2c3/telemetry/supply/temperature", buf);
+    ParsedTopic t;
+    TEST_ASSERT_TRUE(parse_topic(buf, strlen(buf), t));
+    TEST_ASSERT_EQUAL_INT(TOPIC_TELEMETRY, t.kind);
+    TEST_ASSERT_TRUE(topic_span_equals(t.root, "home/env"));
+    TEST_ASSERT_TRUE(topic_span_equals(t.device, "esp-a1b2c3"));
+    TEST_ASSERT_TRUE(topic_span_equals(t.channel, "supply"));
+    TEST_ASSERT_TRUE(topic_span_equals(t.metric, "temperature"));
+
+    build_channel_topic("devices", "esp-a1b2c3", "", "humidity", buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("devices/esp-a1b2c3/telemetry/humidity", buf);
+    TEST_ASSERT_FALSE(parse_topic("esp-a1b2c3/telemetry/supply/humidity", 36, t));  // no root
+}
+
+void test_parse_topic_roundtrip_status(void) {
+    char buf[96];
+    build_topic("devices", "esp-a1b2c3", "status", buf, sizeof(buf));
+    ParsedTopic t;
+    TEST_ASSERT_TRUE(parse_topic(buf, strlen(buf), t));
+    TEST_ASSERT_EQUAL_INT(TOPIC_STATUS, t.kind);
+    TEST_ASSERT_TRUE(topic_span_equals(t.root, "devices"));
+    TEST_ASSERT_TRUE(topic_span_equals(t.device, "esp-a1b2c3"));
+    TEST_ASSERT_EQUAL_INT(0, t.metric.len);
+}
+
+void test_parse_topic_rejects_foreign(void) {
+    ParsedTopic t;
+    TEST_ASSERT_FALSE(parse_topic("esp-a1b2c3/status", 17, t));      // no root
+    TEST_ASSERT_FALSE(parse_topic("devices/esp-a1b2c3/other", 24, t));
+    TEST_ASSERT_FALSE(parse_topic("devices/esp-a1b2c3/telemetry/", 29, t));
+    TEST_ASSERT_EQUAL_INT(TOPIC_UNKNOWN, t.kind);
+}
+
+// ── utils: parse_decimal_payload ─────────────────────────────────────────────
+
+void test_parse_decimal_payload_formats(void) {
+    char buf[16];
+    float v = 0.0f;
+    format_float_2dp(3.87f, buf, sizeof(buf));
+    TEST_ASSERT_TRUE(parse_decimal_payload(buf, strlen(buf), v));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 3.87f, v);
+    TEST_ASSERT_TRUE(parse_decimal_payload("-4.5", 4, v));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, -4.5f, v);
+    TEST_ASSERT_FALSE(parse_decimal_payload("OK", 2, v));
+    TEST_ASSERT_FALSE(parse_decimal_payload("", 0, v));
+}
+
+// ── ingest: split / decode / format ──────────────────────────────────────────
+
+void test_ingest_split_line_with_timestamp(void) {
+    const char* line = "1700000000.5 devices/esp-a1b2c3/telemetry/temperature 22.5\n";
+    IngestMessage m;
+    TEST_ASSERT_TRUE(ingest_split_line(line, strlen(line), m));
+    TEST_ASSERT_EQUAL_INT(1700000000500000000LL, m.ts_ns);
+    TEST_ASSERT_EQUAL_INT(40, m.topic_len);
+    TEST_ASSERT_EQUAL_INT(4, m.payload_len);
+    TEST_ASSERT_EQUAL_STRING_LEN("22.5", m.payload, 4);
+}
+
+void test_ingest_decode_drops_invalid(void) {
+    IngestMessage msgs[3];
+    const char* l0 = "devices/esp-a1b2c3/telemetry/voltage 3.70";
+    const char* l1 = "devices/esp-a1b2c3/telemetry/voltage n/a";
+    const char* l2 = "other/topic 1";
+    TEST_ASSERT_TRUE(ingest_split_line(l0, strlen(l0), msgs[0]));
+    TEST_ASSERT_TRUE(ingest_split_line(l1, strlen(l1), msgs[1]));
+    TEST_ASSERT_TRUE(ingest_split_line(l2, strlen(l2), msgs[2]));
+    IngestRecord recs[3];
+    TEST_ASSERT_EQUAL_INT(1, ingest_decode_batch(msgs, 3, recs));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 3.70f, recs[0].value);
+}
+
+void test_ingest_format_line_protocol_and_csv(void) {
+    const char* line = "42 home/env/esp-a1b2c3/status BAT_LOW";
+    IngestMessage m;
+    IngestRecord r;
+    TEST_ASSERT_TRUE(ingest_split_line(line, strlen(line), m));
+    TEST_ASSERT_EQUAL_INT(1, ingest_decode_batch(&m, 1, &r));
+
+    char out[128];
+    TEST_ASSERT_GREATER_THAN(0, ingest_format_record(r, INGEST_LINE_PROTOCOL, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_STRING(
+        "env,root=home/env,device=esp-a1b2c3 status=\"BAT_LOW\" 42000000000\n", out);
+    TEST_ASSERT_GREATER_THAN(0, ingest_format_record(r, INGEST_CSV, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_STRING("42000000000,home/env,esp-a1b2c3,status,BAT_LOW\n", out);
+    TEST_ASSERT_EQUAL_INT(0, ingest_format_record(r, INGEST_CSV, out, 8));
+}
+
+void test_ingest_format_channel(void) {
+    const char* line = "42 devices/esp-a1b2c3/telemetry/supply/temperature 19.5";
+    IngestMessage m;
+    IngestRecord r;
+    TEST_ASSERT_TRUE(ingest_split_line(line, strlen(line), m));
+    TEST_ASSERT_EQUAL_INT(1, ingest_decode_batch(&m, 1, &r));
+
+    char out[128];
+    TEST_ASSERT_GREATER_THAN(0, ingest_format_record(r, INGEST_LINE_PROTOCOL, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_STRING(
+        "env,root=devices,device=esp-a1b2c3,channel=supply temperature=19.5 42000000000\n", out);
+    TEST_ASSERT_GREATER_THAN(0, ingest_format_record(r, INGEST_CSV, out, sizeof(out)));
+    TEST_ASSERT_EQUAL_STRING("42000000000,devices,esp-a1b2c3,supply/temperature,19.5\n", out);
+}
+
+// ── policy: decision logic + trace replay ────────────────────────────────────
+
+void test_cycle_status_str_priority(void) {
+    TEST_ASSERT_EQUAL_STRING("BAT_LOW", cycle_status_str(3.45f, 3.5f, 3.4f, true));
+    TEST_ASSERT_EQUAL_STRING("OK",      cycle_status_str(3.9f,  3.5f, 3.4f, true));
+    TEST_ASSERT_EQUAL_STRING("NOK",     cycle_status_str(3.9f,  3.5f, 3.4f, false));
+}
+
+void test_cycle_status_str_channels(void) {
+    TEST_ASSERT_EQUAL_STRING("OK",       cycle_status_str(3.9f,  3.5f, 3.4f, 3, 3));
+    TEST_ASSERT_EQUAL_STRING("DEGRADED", cycle_status_str(3.9f,  3.5f, 3.4f, 1, 3));
+    TEST_ASSERT_EQUAL_STRING("NOK",      cycle_status_str(3.9f,  3.5f, 3.4f, 0, 3));
+    TEST_ASSERT_EQUAL_STRING("BAT_CRIT", cycle_status_str(3.3f,  3.5f, 3.4f, 1, 3));
+    TEST_ASSERT_EQUAL_STRING("OK",       cycle_status_str(3.9f,  3.5f, 3.4f, 1, 1));
+}
+
+void test_config_sleep_for_battery_table(void) {
+    Config cfg;
+    config_apply_defaults(cfg);
+    TEST_ASSERT_EQUAL_INT(60,    config_sleep_for_battery(cfg, 3.9f));
+    TEST_ASSERT_EQUAL_INT(300,   config_sleep_for_battery(cfg, 3.5f));
+    TEST_ASSERT_EQUAL_INT(86400, config_sleep_for_battery(cfg, 3.4f));
+}
+
+void test_policy_simulate_constant_trace(void) {
+    // One hour of constant conditions, 1 sample/min: a 60s sleep plus the
+    // modelled 5.65s awake time gives 55 wakes, exact reconstruction.
+    static TraceSample trace[61];
+    for (int i = 0; i <= 60; i++) trace[i] = { (uint32_t)i * 60, 21.0f, 50.0f, 3.9f };
+    Policy policy;
+    policy_default(policy);
+    EnergyModel model;
+    policy_default_energy_model(model);
+    PolicyResult r;
+    policy_simulate(trace, 61, policy, model, r);
+
+    TEST_ASSERT_EQUAL_UINT32(55, r.full_wakes);
+    TEST_ASSERT_EQUAL_UINT32(0, r.continuation_wakes);
+    TEST_ASSERT_EQUAL_UINT32(55, r.status_counts[0]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.0, r.temp_rmse);
+    TEST_ASSERT_GREATER_THAN(0, r.energy_j);
+}
+
+void test_policy_simulate_critical_battery_chains(void) {
+    // Critical battery: one publish, then 86400s in 21 segments
+    static TraceSample trace[2] = { { 0, 21.0f, 50.0f, 3.3f }, { 86400, 25.0f, 50.0f, 3.3f } };
+    Policy policy;
+    TEST_ASSERT_TRUE(policy_parse("crit:60,300,86400,3.5,3.4,1", policy));
+    EnergyModel model;
+    policy_default_energy_model(model);
+    PolicyResult r;
+    policy_simulate(trace, 2, policy, model, r);
+
+    TEST_ASSERT_EQUAL_UINT32(1, r.full_wakes);
+    TEST_ASSERT_EQUAL_UINT32(20, r.continuation_wakes);
+    TEST_ASSERT_EQUAL_UINT32(1, r.status_counts[3]);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 4.0, r.temp_max_err);
+}
+
+// ── led: pattern engine tables ───────────────────────────────────────────────
+
+// Sums on-time and period over one full pattern cycle
+static void led_cycle(LedPattern p, LedMode m, uint32_t& on_ms, uint32_t& period_ms) {
+    on_ms = period_ms = 0;
+    for (uint8_t step = 0; step < led_pattern_steps(p); step++) {
+        uint16_t hold;
+        bool on = led_pattern_step(p, m, step, hold);
+        period_ms += hold;
+        if (on) on_ms += hold;
+    }
+}
+
+void test_led_full_mode_matches_spec(void) {
+    uint32_t on, period;
+    led_cycle(LED_PATTERN_SENSOR, LED_MODE_FULL, on, period);
+    TEST_ASSERT_EQUAL_UINT32(2500, period);
+    TEST_ASSERT_EQUAL_UINT32(1000, on);
+    led_cycle(LED_PATTERN_MQTT, LED_MODE_FULL, on, period);
+    TEST_ASSERT_EQUAL_UINT32(2000, period);
+    TEST_ASSERT_EQUAL_UINT32(1500, on);
+}
+
+void test_led_pulse_mode_keeps_period(void) {
+    uint32_t on, period;
+    led_cycle(LED_PATTERN_WIFI, LED_MODE_PULSE, on, period);
+    TEST_ASSERT_EQUAL_UINT32(1000, period);
+    TEST_ASSERT_EQUAL_UINT32(LED_PULSE_MS, on);
+    led_cycle(LED_PATTERN_SENSOR, LED_MODE_PULSE, on, period);
+    TEST_ASSERT_EQUAL_UINT32(2500, period);
+    TEST_ASSERT_EQUAL_UINT32(2 * LED_PULSE_MS, on);
+}
+
+void test_led_off_mode_never_on(void) {
+    uint32_t on, period;
+    led_cycle(LED_PATTERN_PORTAL, LED_MODE_OFF, on, period);
+    TEST_ASSERT_EQUAL_UINT32(0, on);
+    led_cycle(LED_PATTERN_NONE, LED_MODE_FULL, on, period);
+    TEST_ASSERT_EQUAL_UINT32(0, period);
+}
+
+// ── coalescer: MQTT burst on the wire ───────────────────────────────────────
+
+struct WireCapture {
+    uint8_t  bytes[1024];
+    size_t   len;
+    uint32_t segments;
+};
+
+static size_t wire_sink(void* ctx, const uint8_t* data, size_t len) {
+    WireCapture* w = (WireCapture*)ctx;
+    memcpy(w->bytes + w->len, data, len);
+    w->len += len;
+    w->segments++;
+    return len;
+}
+
+// PUBLISH packet as PubSubClient frames it (QoS 0, one write per packet)
+static size_t mqtt_publish_packet(const char* topic, const char* payload, uint8_t* out) {
+    size_t tlen = strlen(topic), plen = strlen(payload);
+    size_t rem  = 2 + tlen + plen;
+    size_t n = 0;
+    out[n++] = 0x31;  // PUBLISH, retain
+    do {
+        uint8_t b = rem % 128;
+        rem /= 128;
+        out[n++] = (uint8_t)(b | (rem ? 0x80 : 0));
+    } while (rem);
+    out[n++] = (uint8_t)(tlen >> 8);
+    out[n++] = (uint8_t)tlen;
+    memcpy(out + n, topic, tlen);    n += tlen;
+    memcpy(out + n, payload, plen);  n += plen;
+    return n;
+}
+
+// Replays one wake's session: CONNECT, status + 3 telemetry PUBLISHes, DISCONNECT
+static void replay_session(WriteCoalescer& co, bool burst) {
+    static const uint8_t connect_pkt[] = { 0x10, 0x0C, 0, 4, 'M', 'Q', 'T', 'T', 4, 0x02, 0, 60, 0, 0 };
+    static const uint8_t disconnect_pkt[] = { 0xE0, 0x00 };
+    const char* topics[4] = {
+        "devices/esp-a1b2c3/status",
+        "devices/esp-a1b2c3/telemetry/temperature",
+        "devices/esp-a1b2c3/telemetry/humidity",
+        "devices/esp-a1b2c3/telemetry/voltage",
+    };
+    const char* payloads[4] = { "OK", "22.5", "48.0", "3.70" };
+
+    coalescer_write(co, connect_pkt, sizeof(connect_pkt));
+    if (burst) coalescer_begin_burst(co);
+    for (int i = 0; i < 4; i++) {
+        uint8_t pkt[128];
+        size_t n = mqtt_publish_packet(topics[i], payloads[i], pkt);
+        TEST_ASSERT_EQUAL_INT(n, coalescer_write(co, pkt, n));
+    }
+    coalescer_write(co, disconnect_pkt, sizeof(disconnect_pkt));
+    TEST_ASSERT_TRUE(coalescer_flush(co));
+}
+
+void test_coalescer_burst_single_segment(void) {
+    static WireCapture before, after;
+    before = {};
+    after  = {};
+    uint8_t buf[512];
+    WriteCoalescer co;
+
+    coalescer_init(co, buf, sizeof(buf), wire_sink, &before);
+    replay_session(co, false);
+    coalescer_init(co, buf, sizeof(buf), wire_sink, &after);
+    replay_session(co, true);
+
+    TEST_ASSERT_EQUAL_UINT32(6, before.segments);  // CONNECT + 4 PUBLISH + DISCONNECT
+    TEST_ASSERT_EQUAL_UINT32(2, after.segments);   // CONNECT + one burst
+    TEST_ASSERT_EQUAL_INT(before.len, after.len);
+    TEST_ASSERT_EQUAL_MEMORY(before.bytes, after.bytes, before.len);
+}
+
+void test_coalescer_overflow_flushes_early(void) {
+    static WireCapture wire;
+    wire = {};
+    uint8_t buf[8];
+    WriteCoalescer co;
+    coalescer_init(co, buf, sizeof(buf), wire_sink, &wire);
+    coalescer_begin_burst(co);
+
+    const uint8_t a[6] = { 1, 2, 3, 4, 5, 6 };
+    const uint8_t big[12] = { 0 };
+    coalescer_write(co, a, 6);
+    coalescer_write(co, a, 6);      // would overflow: first 6 go out
+    TEST_ASSERT_EQUAL_UINT32(1, wire.segments);
+    coalescer_write(co, big, 12);   // larger than buffer: drain + direct
+    TEST_ASSERT_EQUAL_UINT32(3, wire.segments);
+    TEST_ASSERT_TRUE(coalescer_flush(co));
+    TEST_ASSERT_EQUAL_UINT32(3, wire.segments);
+    TEST_ASSERT_EQUAL_INT(24, wire.len);
+}
+
+// ── cpu: phase frequency policy ──────────────────────────────────────────────
+
+void test_cpu_phase_mhz_policy(void) {
+    TEST_ASSERT_EQUAL_INT(160, cpu_phase_mhz(CPU_PHASE_CONFIG));
+    TEST_ASSERT_EQUAL_INT(160, cpu_phase_mhz(CPU_PHASE_ENCODE));
+    TEST_ASSERT_EQUAL_INT(80,  cpu_phase_mhz(CPU_PHASE_WIFI_WAIT));
+    TEST_ASSERT_EQUAL_INT(80,  cpu_phase_mhz(CPU_PHASE_SENSOR));
+    TEST_ASSERT_EQUAL_INT(80,  cpu_phase_mhz(CPU_PHASE_MQTT_WAIT));
+}
+
+void test_cpu_phase_log_accumulates(void) {
+    CpuPhaseLog log = {};
+    cpu_phase_log_switch(log, CPU_PHASE_CONFIG,    100000);  // boot 100ms
+    cpu_phase_log_switch(log, CPU_PHASE_WIFI_WAIT, 140000);  // config 40ms
+    cpu_phase_log_switch(log, CPU_PHASE_SENSOR,    2140000); // wifi 2s
+    cpu_phase_log_switch(log, CPU_PHASE_WIFI_WAIT, 4140000); // sensor 2s
+    cpu_phase_log_switch(log, CPU_PHASE_WIFI_WAIT, 4150000); // wifi +10ms
+
+    TEST_ASSERT_EQUAL_UINT32(100000,  log.us[CPU_PHASE_BOOT]);
+    TEST_ASSERT_EQUAL_UINT32(40000,   log.us[CPU_PHASE_CONFIG]);
+    TEST_ASSERT_EQUAL_UINT32(2010000, log.us[CPU_PHASE_WIFI_WAIT]);
+    TEST_ASSERT_EQUAL_UINT32(2000000, log.us[CPU_PHASE_SENSOR]);
+    TEST_ASSERT_EQUAL_INT(2, log.switches);  // 80->160->80
+}
+
+// ── espnow: frame codec + simulated link ─────────────────────────────────────
+
+struct SimLink {
+    uint8_t frame[32];
+    size_t  len;
+    int     sends;
+    int     drop_first;  // number of sends to lose before one is acknowledged
+};
+
+static bool sim_send(void* ctx, const uint8_t* mac, const uint8_t* data, size_t len) {
+    (void)mac;
+    SimLink* sim = (SimLink*)ctx;
+    sim->sends++;
+    if (sim->sends <= sim->drop_first) return false;
+    memcpy(sim->frame, data, len);
+    sim->len = len;
+    return true;
+}
+
+struct Captured {
+    char topics[4][96];
+    char payloads[4][16];
+    bool is_status[4];
+    int  count;
+};
+
+static bool capture_publish(void* ctx, const char* topic, const char* payload, bool is_status) {
+    Captured* c = (Captured*)ctx;
+    strcpy(c->topics[c->count], topic);
+    strcpy(c->payloads[c->count], payload);
+    c->is_status[c->count] = is_status;
+    c->count++;
+    return true;
+}
+
+void test_espnow_frame_roundtrip(void) {
+    SensorFrame in = { 0xa1b2c3, FRAME_STATUS_BAT_LOW, true, -3.4f, 65.0f, 3.87f };
+    uint8_t buf[ESPNOW_FRAME_LEN];
+    TEST_ASSERT_EQUAL_INT(ESPNOW_FRAME_LEN, espnow_encode_frame(in, buf, sizeof(buf)));
+    SensorFrame out;
+    TEST_ASSERT_TRUE(espnow_decode_frame(buf, sizeof(buf), out));
+    TEST_ASSERT_EQUAL_UINT32(0xa1b2c3, out.chip_id);
+    TEST_ASSERT_EQUAL_INT(FRAME_STATUS_BAT_LOW, out.status);
+    TEST_ASSERT_TRUE(out.sensor_ok);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, -3.4f, out.temp);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 65.0f, out.hum);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 3.87f, out.battery_v);
+
+    buf[0] ^= 0xFF;
+    TEST_ASSERT_FALSE(espnow_decode_frame(buf, sizeof(buf), out));
+}
+
+void test_espnow_sender_to_gateway_topics(void) {
+    const uint8_t gw[6] = { 1, 2, 3, 4, 5, 6 };
+    SimLink sim = {};
+    sim.drop_first = 1;
+    EspNowLink link = { sim_send, &sim };
+
+    SensorFrame f = { 0xa1b2c3, frame_status_from_str("OK"), true, 22.5f, 48.0f, 3.7f };
+    TEST_ASSERT_TRUE(espnow_send_readings(link, gw, f, 3));
+    TEST_ASSERT_EQUAL_INT(2, sim.sends);
+
+    Captured c = {};
+    TEST_ASSERT_TRUE(espnow_gateway_handle(sim.frame, sim.len, "devices", capture_publish, &c));
+    TEST_ASSERT_EQUAL_INT(4, c.count);
+    TEST_ASSERT_EQUAL_STRING("devices/esp-a1b2c3/status", c.topics[0]);
+    TEST_ASSERT_EQUAL_STRING("OK", c.payloads[0]);
+    TEST_ASSERT_TRUE(c.is_status[0]);
+    TEST_ASSERT_EQUAL_STRING("devices/esp-a1b2c3/telemetry/temperature", c.topics[1]);
+    TEST_ASSERT_EQUAL_STRING("22.5", c.payloads[1]);
+    TEST_ASSERT_EQUAL_STRING("devices/esp-a1b2c3/telemetry/humidity", c.topics[2]);
+    TEST_ASSERT_EQUAL_STRING("48.0", c.payloads[2]);
+    TEST_ASSERT_EQUAL_STRING("devices/esp-a1b2c3/telemetry/voltage", c.topics[3]);
+    TEST_ASSERT_EQUAL_STRING("3.70", c.payloads[3]);
+    TEST_ASSERT_FALSE(c.is_status[3]);
+}
+
+void test_espnow_sensor_failure_skips_measurements(void) {
+    SensorFrame f = { 0x000001, frame_status_from_str("BAT_CRIT"), false, 0.0f, 0.0f, 3.1f };
+    uint8_t buf[ESPNOW_FRAME_LEN];
+    espnow_encode_frame(f, buf, sizeof(buf));
+
+    Captured c = {};
+    TEST_ASSERT_TRUE(espnow_gateway_handle(buf, sizeof(buf), "home/env", capture_publish, &c));
+    TEST_ASSERT_EQUAL_INT(2, c.count);
+    TEST_ASSERT_EQUAL_STRING("BAT_CRIT", c.payloads[0]);
+    TEST_ASSERT_EQUAL_STRING("home/env/esp-000001/telemetry/voltage", c.topics[1]);
+}
+
+void test_espnow_gateway_checks_sender(void) {
+    const uint8_t allow[2][6] = { { 0x5c, 0xcf, 0x7f, 0xa1, 0xb2, 0xc3 },
+                                  { 0x5c, 0xcf, 0x7f, 0x00, 0x00, 0x01 } };
+    const uint8_t other[6]    = { 0x5c, 0xcf, 0x7f, 0xa1, 0xb2, 0xc4 };
+    TEST_ASSERT_TRUE(espnow_sender_allowed(allow[1], allow, 2));
+    TEST_ASSERT_FALSE(espnow_sender_allowed(other, allow, 2));
+    TEST_ASSERT_FALSE(espnow_sender_allowed(allow[0], allow, 0));
+
+    SensorFrame f = { 0xa1b2c3, FRAME_STATUS_OK, true, 20.0f, 40.0f, 4.0f };
+    uint8_t buf[ESPNOW_FRAME_LEN];
+    espnow_encode_frame(f, buf, sizeof(buf));
+    Captured c = {};
+    TEST_ASSERT_TRUE(espnow_gateway_handle(buf, sizeof(buf), "devices", capture_publish, &c,
+                                           allow[0]));
+    TEST_ASSERT_EQUAL_INT(4, c.count);
+
+    // A listed sensor cannot publish under another chip ID
+    Captured spoof = {};
+    TEST_ASSERT_FALSE(espnow_gateway_handle(buf, sizeof(buf), "devices", capture_publish, &spoof,
+                                            allow[1]));
+    TEST_ASSERT_EQUAL_INT(0, spoof.count);
+}
+
+void test_espnow_send_gives_up(void) {
+    const uint8_t gw[6] = { 0 };
+    SimLink sim = {};
+    sim.drop_first = 10;
+    EspNowLink link = { sim_send, &sim };
+    SensorFrame f = { 1, FRAME_STATUS_OK, true, 20.0f, 40.0f, 4.0f };
+    TEST_ASSERT_FALSE(espnow_send_readings(link, gw, f, 3));
+    TEST_ASSERT_EQUAL_INT(3, sim.sends);
+}
+
+// ── Log: binary event ring ───────────────────────────────────────────────────
+
+struct DrainSink {
+    char payloads[4][160];
+    int  count;
+    int  fail_at;  // payload index that is rejected, -1 = never
+};
+
+static bool drain_sink(void* ctx, const char* payload) {
+    DrainSink* d = (DrainSink*)ctx;
+    if (d->count == d->fail_at) return false;
+    strcpy(d->payloads[d->count++], payload);
+    return true;
+}
+
+void test_event_log_wraps_oldest_first(void) {
+    EventLog log;
+    memset(&log, 0xA5, sizeof(log));  // garbage, as after power-on
+    event_log_begin_wake(log);
+    TEST_ASSERT_EQUAL_UINT32(EVENT_LOG_MAGIC, log.magic);
+    TEST_ASSERT_EQUAL_UINT16(1, log.wake);
+    TEST_ASSERT_EQUAL_INT(0, log.count);
+
+    for (int i = 0; i < EVENT_LOG_CAPACITY + 3; i++) event_log_push(log, EV_WIFI_OK, i, 100000);
+    TEST_ASSERT_EQUAL_INT(EVENT_LOG_CAPACITY, log.count);
+    TEST_ASSERT_EQUAL_INT(3, event_log_get(log, 0).value);
+    TEST_ASSERT_EQUAL_INT(EVENT_LOG_CAPACITY + 2, event_log_get(log, EVENT_LOG_CAPACITY - 1).value);
+    TEST_ASSERT_EQUAL_UINT16(0xFFFF, event_log_get(log, 0).t_ms);  // saturated
+
+    // A valid ring survives the next wake
+    event_log_begin_wake(log);
+    TEST_ASSERT_EQUAL_UINT16(2, log.wake);
+    TEST_ASSERT_EQUAL_INT(EVENT_LOG_CAPACITY, log.count);
+
+    char buf[48];
+    event_log_format(event_log_push(log, EV_MQTT_FAIL, -2, 340), buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("w2+340ms MQTT_FAIL=-2", buf);
+}
+
+void test_event_log_drain_chunks_and_resumes(void) {
+    EventLog log;
+    event_log_reset(log);
+    event_log_begin_wake(log);
+    for (int i = 0; i < 10; i++) event_log_push(log, EV_SLEEP, 60, 1000 + i);
+
+    // Each entry is "w1+100Xms SLEEP=60" (17 chars): 3 fit in 64 bytes
+    DrainSink d = {};
+    d.fail_at = 2;
+    TEST_ASSERT_EQUAL_INT(6, event_log_drain(log, drain_sink, &d, 64));
+    TEST_ASSERT_EQUAL_INT(4, log.unsent);
+    TEST_ASSERT_EQUAL_STRING("w1+1000ms SLEEP=60;w1+1001ms SLEEP=60;w1+1002ms SLEEP=60",
+                             d.payloads[0]);
+
+    d.fail_at = -1;
+    TEST_ASSERT_EQUAL_INT(4, event_log_drain(log, drain_sink, &d, 64));
+    TEST_ASSERT_EQUAL_INT(0, log.unsent);
+    TEST_ASSERT_EQUAL_STRING("w1+1009ms SLEEP=60", d.payloads[3]);
+    TEST_ASSERT_EQUAL_INT(0, event_log_drain(log, drain_sink, &d, 64));
+}
+
+// ── MqttSn: client against the gateway stand-in ──────────────────────────────
+
+// Datagram loop: client sends go straight into the stand-in, its reply (if
+// any) waits for the next recv. drop_replies simulates an absent gateway.
+struct SnLoop {
+    MqttSnGatewaySim gw;
+    uint8_t reply[MQTTSN_MAX_PACKET];
+    size_t  reply_len;
+    bool    drop_replies;
+    char    topics[6][96];
+    char    payloads[6][32];
+    int     forwarded;
+};
+
+static bool sn_send(void* ctx, const uint8_t* data, size_t len) {
+    SnLoop* l = (SnLoop*)ctx;
+    size_t n = mqttsn_gateway_handle(l->gw, data, len, l->reply, sizeof(l->reply));
+    if (n && !l->drop_replies) l->reply_len = n;
+    return true;
+}
+
+static size_t sn_recv(void* ctx, uint8_t* buf, size_t cap, uint32_t /*timeout_ms*/) {
+    SnLoop* l = (SnLoop*)ctx;
+    size_t n = l->reply_len;
+    if (n == 0 || n > cap) return 0;
+    memcpy(buf, l->reply, n);
+    l->reply_len = 0;
+    return n;
+}
+
+static void sn_forward(void* ctx, const char* topic, const char* payload, bool /*retain*/) {
+    SnLoop* l = (SnLoop*)ctx;
+    strcpy(l->topics[l->forwarded], topic);
+    strcpy(l->payloads[l->forwarded], payload);
+    l->forwarded++;
+}
+
+void test_mqttsn_topic_ids_follow_layout(void) {
+    char topic[96];
+    build_topic("home/env", "esp-a1b2c3", "status", topic, sizeof(topic));
+    TEST_ASSERT_EQUAL_INT(MQTTSN_TOPIC_STATUS, mqttsn_topic_id(topic));
+    build_telemetry_topic("devices", "esp-a1b2c3", "humidity", topic, sizeof(topic));
+    TEST_ASSERT_EQUAL_INT(MQTTSN_TOPIC_HUMIDITY, mqttsn_topic_id(topic));
+    build_topic("devices", "esp-a1b2c3", "log", topic, sizeof(topic));
+    TEST_ASSERT_EQUAL_INT(MQTTSN_TOPIC_LOG, mqttsn_topic_id(topic));
+    build_telemetry_topic("devices", "esp-a1b2c3", "tx_power", topic, sizeof(topic));
+    TEST_ASSERT_EQUAL_INT(MQTTSN_TOPIC_TX_POWER, mqttsn_topic_id(topic));
+    build_topic("devices", "esp-a1b2c3", "fault", topic, sizeof(topic));
+    TEST_ASSERT_EQUAL_INT(MQTTSN_TOPIC_FAULT, mqttsn_topic_id(topic));
+    TEST_ASSERT_EQUAL_INT(MQTTSN_TOPIC_NONE, mqttsn_topic_id("devices/esp-a1b2c3/telemetry/pressure"));
+    TEST_ASSERT_EQUAL_INT(MQTTSN_TOPIC_NONE, mqttsn_topic_id("esp-a1b2c3/log"));
+
+    TEST_ASSERT_TRUE(mqttsn_topic_name(MQTTSN_TOPIC_VOLTAGE, "home/env", "esp-000001", topic, sizeof(topic)));
+    TEST_ASSERT_EQUAL_STRING("home/env/esp-000001/telemetry/voltage", topic);
+    TEST_ASSERT_FALSE(mqttsn_topic_name(MQTTSN_TOPIC_COUNT, "devices", "esp-000001", topic, sizeof(topic)));
+}
+
+void test_mqttsn_channel_topic_ids(void) {
+    static const char* const channels[] = { "supply", "return" };
+    char topic[96];
+    build_channel_topic("devices", "esp-a1b2c3", "return", "humidity", topic, sizeof(topic));
+    uint16_t id = mqttsn_topic_id(topic, channels, 2);
+    TEST_ASSERT_EQUAL_INT(MQTTSN_TOPIC_CHANNEL_BASE + 3, id);
+    TEST_ASSERT_EQUAL_INT(MQTTSN_TOPIC_NONE, mqttsn_topic_id(topic));  // channels unknown
+    TEST_ASSERT_EQUAL_INT(MQTTSN_TOPIC_NONE,
+                          mqttsn_topic_id("devices/esp-a1b2c3/telemetry/supply/voltage", channels, 2));
+
+    char name[96];
+    TEST_ASSERT_TRUE(mqttsn_topic_name(id, "devices", "esp-a1b2c3", name, sizeof(name), channels, 2));
+    TEST_ASSERT_EQUAL_STRING(topic, name);
+    TEST_ASSERT_TRUE(mqttsn_topic_name(MQTTSN_TOPIC_CHANNEL_BASE, "devices", "esp-a1b2c3",
+                                       name, sizeof(name), channels, 2));
+    TEST_ASSERT_EQUAL_STRING("devices/esp-a1b2c3/telemetry/supply/temperature", name);
+    TEST_ASSERT_FALSE(mqttsn_topic_name(MQTTSN_TOPIC_CHANNEL_BASE + 4, "devices", "esp-a1b2c3",
+                                        name, sizeof(name), channels, 2));
+}
+
+void test_mqttsn_wake_two_round_trips(void) {
+    SnLoop l = {};
+    mqttsn_gateway_init(l.gw, "devices", sn_forward, &l);
+    MqttSnTransport io = { sn_send, sn_recv, &l };
+    MqttSnClient c;
+    mqttsn_client_init(c, io);
+
+    TEST_ASSERT_TRUE(mqttsn_connect(c, "esp-a1b2c3", 60, 500));
+    TEST_ASSERT_EQUAL_STRING("esp-a1b2c3", l.gw.client_id);
+    TEST_ASSERT_TRUE(mqttsn_publish(c, MQTTSN_TOPIC_STATUS, "OK", 0, true, 500));
+    TEST_ASSERT_TRUE(mqttsn_publish(c, MQTTSN_TOPIC_TEMPERATURE, "22.5", 0, true, 500));
+    TEST_ASSERT_TRUE(mqttsn_publish(c, MQTTSN_TOPIC_VOLTAGE, "3.87", 0, true, 500));
+    TEST_ASSERT_TRUE(mqttsn_disconnect(c, 300, 500));
+
+    TEST_ASSERT_EQUAL_INT(3, l.forwarded);
+    TEST_ASSERT_EQUAL_STRING("devices/esp-a1b2c3/status", l.topics[0]);
+    TEST_ASSERT_EQUAL_STRING("OK", l.payloads[0]);
+    TEST_ASSERT_EQUAL_STRING("devices/esp-a1b2c3/telemetry/temperature", l.topics[1]);
+    TEST_ASSERT_EQUAL_STRING("3.87", l.payloads[2]);
+    TEST_ASSERT_EQUAL_UINT16(300, l.gw.sleep_s);
+    TEST_ASSERT_FALSE(l.gw.connected);
+    TEST_ASSERT_EQUAL_UINT16(5, c.datagrams);
+    TEST_ASSERT_EQUAL_UINT16(2, c.round_trips);  // CONNACK + DISCONNECT
+}
+
+void test_mqttsn_rejections_and_timeouts(void) {
+    SnLoop l = {};
+    mqttsn_gateway_init(l.gw, "devices", sn_forward, &l);
+    MqttSnTransport io = { sn_send, sn_recv, &l };
+    MqttSnClient c;
+    mqttsn_client_init(c, io);
+
+    // Not connected yet: nothing leaves the client
+    TEST_ASSERT_FALSE(mqttsn_publish(c, MQTTSN_TOPIC_STATUS, "OK", 0, true, 500));
+    TEST_ASSERT_EQUAL_UINT16(0, c.datagrams);
+
+    TEST_ASSERT_TRUE(mqttsn_connect(c, "esp-000001", 60, 500));
+    TEST_ASSERT_FALSE(mqttsn_publish(c, 42, "x", 1, false, 500));
+    TEST_ASSERT_EQUAL_INT(MQTTSN_RC_INVALID_TOPIC, c.last_rc);
+    TEST_ASSERT_TRUE(mqttsn_publish(c, MQTTSN_TOPIC_LOG, "w1+5ms BOOT=0", 1, false, 500));
+    TEST_ASSERT_EQUAL_STRING("devices/esp-000001/log", l.topics[0]);
+
+    l.drop_replies = true;
+    TEST_ASSERT_FALSE(mqttsn_disconnect(c, 60, 500));
+    TEST_ASSERT_FALSE(mqttsn_connect(c, "esp-000001", 60, 500));
+}
+
+void test_mqttsn_sleeping_session_resumes(void) {
+    SnLoop l = {};
+    mqttsn_gateway_init(l.gw, "devices", sn_forward, &l);
+    MqttSnTransport io = { sn_send, sn_recv, &l };
+    MqttSnClient c;
+    mqttsn_client_init(c, io);
+
+    TEST_ASSERT_TRUE(mqttsn_connect(c, "esp-a1b2c3", 60, 500));
+    TEST_ASSERT_FALSE(l.gw.resumed);
+    TEST_ASSERT_TRUE(mqttsn_disconnect(c, 300, 500));
+    TEST_ASSERT_TRUE(l.gw.session);  // asleep, not lost
+
+    // Next wake: CleanSession off picks the session up again
+    TEST_ASSERT_TRUE(mqttsn_connect(c, "esp-a1b2c3", 60, 500, false));
+    TEST_ASSERT_TRUE(l.gw.resumed);
+    TEST_ASSERT_EQUAL_UINT16(0, l.gw.sleep_s);
+
+    // A plain DISCONNECT ends it; a clean CONNECT never resumes
+    TEST_ASSERT_TRUE(mqttsn_disconnect(c, 0, 500));
+    TEST_ASSERT_FALSE(l.gw.session);
+    TEST_ASSERT_TRUE(mqttsn_connect(c, "esp-a1b2c3", 60, 500, false));
+    TEST_ASSERT_FALSE(l.gw.resumed);
+    TEST_ASSERT_TRUE(mqttsn_disconnect(c, 300, 500));
+    TEST_ASSERT_TRUE(mqttsn_connect(c, "esp-a1b2c3", 60, 500, true));
+    TEST_ASSERT_FALSE(l.gw.resumed);
+}
+
+// ── DhtAsync: edge decoder ───────────────────────────────────────────────────
+
+// Edges as the CHANGE interrupt records them: host release, 80/80us response,
+// 40 x {50us low, 26/70us high}, final release (no closing edge).
+struct DhtEdges {
+    uint32_t t[DHT_MAX_EDGES];
+    uint8_t  level[DHT_MAX_EDGES];
+    size_t   count;
+};
+
+static void dht_edge(DhtEdges& e, uint32_t& now, uint32_t after_us, uint8_t level) {
+    now += after_us;
+    e.t[e.count]     = now;
+    e.level[e.count] = level;
+    e.count++;
+}
+
+static DhtEdges dht_frame(const uint8_t bytes[5]) {
+    DhtEdges e = {};
+    uint32_t now = 1000;
+    dht_edge(e, now, 0, 1);    // host releases the line
+    dht_edge(e, now, 30, 0);   // sensor response low
+    dht_edge(e, now, 80, 1);   // response high
+    dht_edge(e, now, 80, 0);
+    for (int b = 0; b < 40; b++) {
+        bool one = (bytes[b / 8] >> (7 - b % 8)) & 1;
+        dht_edge(e, now, 50, 1);
+        dht_edge(e, now, one ? 70 : 26, 0);
+    }
+    dht_edge(e, now, 50, 1);   // sensor releases
+    return e;
+}
+
+void test_dht_decode_valid_frames(void) {
+    const uint8_t dht11[5] = { 55, 0, 23, 4, 82 };
+    DhtEdges e = dht_frame(dht11);
+    DhtReading r;
+    dht_decode_edges(e.t, e.level, e.count, DHT_TYPE_11, r);
+    TEST_ASSERT_EQUAL_UINT8(DHT_OK, r.error);
+    TEST_ASSERT_EQUAL_UINT8(85, r.edges);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 23.4f, r.temp);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 55.0f, r.hum);
+
+    // Capture that missed the release and response edges still decodes
+    dht_decode_edges(e.t + 3, e.level + 3, e.count - 3, DHT_TYPE_11, r);
+    TEST_ASSERT_EQUAL_UINT8(DHT_OK, r.error);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 23.4f, r.temp);
+
+    // DHT22: 16-bit values, sign bit on temperature
+    const uint8_t dht22[5] = { 0x02, 0x8C, 0x80, 0x65, 0x73 };
+    e = dht_frame(dht22);
+    dht_decode_edges(e.t, e.level, e.count, DHT_TYPE_22, r);
+    TEST_ASSERT_EQUAL_UINT8(DHT_OK, r.error);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, -10.1f, r.temp);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 65.2f, r.hum);
+}
+
+void test_dht_decode_checksum_keeps_bytes(void) {
+    const uint8_t bytes[5] = { 55, 0, 23, 4, 83 };
+    DhtEdges e = dht_frame(bytes);
+    DhtReading r;
+    dht_decode_edges(e.t, e.level, e.count, DHT_TYPE_11, r);
+    TEST_ASSERT_EQUAL_UINT8(DHT_ERR_CHECKSUM, r.error);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(bytes, r.bytes, 5);
+    TEST_ASSERT_EQUAL_STRING("checksum", dht_error_str(r.error));
+}
+
+void test_dht_decode_truncated_and_silent(void) {
+    const uint8_t bytes[5] = { 55, 0, 23, 4, 82 };
+    DhtEdges e = dht_frame(bytes);
+    DhtReading r;
+    dht_decode_edges(e.t, e.level, 60, DHT_TYPE_11, r);
+    TEST_ASSERT_EQUAL_UINT8(DHT_ERR_TOO_FEW_EDGES, r.error);
+    TEST_ASSERT_EQUAL_UINT8(60, r.edges);
+
+    dht_decode_edges(e.t, e.level, 0, DHT_TYPE_11, r);
+    TEST_ASSERT_EQUAL_UINT8(DHT_ERR_NO_RESPONSE, r.error);
+}
+
+void test_dht_decode_rejects_bad_pulse(void) {
+    const uint8_t bytes[5] = { 55, 0, 23, 4, 82 };
+    DhtEdges e = dht_frame(bytes);
+    // Stretched high pulse on bit 13: interrupt latency or line noise
+    for (size_t i = 31; i < e.count; i++) e.t[i] += 120;
+    DhtReading r;
+    dht_decode_edges(e.t, e.level, e.count, DHT_TYPE_11, r);
+    TEST_ASSERT_EQUAL_UINT8(DHT_ERR_BAD_PULSE, r.error);
+}
+
+// ── TxPower: RSSI-driven transmit power ──────────────────────────────────────
+
+void test_txpower_choose_from_rssi(void) {
+    TxPowerState s = {};
+    TEST_ASSERT_EQUAL_UINT8(TX_POWER_MAX_QDBM, txpower_choose(s));  // never initialised
+    txpower_state_reset(s);
+    TEST_ASSERT_EQUAL_UINT8(TX_POWER_MAX_QDBM, txpower_choose(s));  // RSSI unknown
+
+    txpower_record_success(s, -57);   // 10 dB headroom -> 20.5 - 10 dBm
+    TEST_ASSERT_EQUAL_UINT8(42, txpower_choose(s));
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 10.5f, txpower_dbm(42));
+
+    txpower_record_success(s, -40);   // next to the AP: clamped to the floor
+    TEST_ASSERT_EQUAL_UINT8(TX_POWER_MIN_QDBM, txpower_choose(s));
+    txpower_record_success(s, -80);   // weak link: full power
+    TEST_ASSERT_EQUAL_UINT8(TX_POWER_MAX_QDBM, txpower_choose(s));
+    txpower_record_success(s, 31);    // WiFi.RSSI() when not connected: ignored
+    TEST_ASSERT_EQUAL_INT8(-80, s.rssi);
+}
+
+void test_txpower_backoff_steps_and_decays(void) {
+    TxPowerState s;
+    txpower_state_reset(s);
+    txpower_record_success(s, -47);   // 20 dB headroom -> floor
+    TEST_ASSERT_EQUAL_UINT8(TX_POWER_MIN_QDBM, txpower_choose(s));
+
+    TEST_ASSERT_EQUAL_UINT8(TX_POWER_MIN_QDBM + TX_POWER_STEP_QDBM, txpower_record_failure(s));
+    TEST_ASSERT_EQUAL_UINT8(TX_POWER_MIN_QDBM + 2 * TX_POWER_STEP_QDBM, txpower_record_failure(s));
+    TEST_ASSERT_EQUAL_UINT8(TX_POWER_MAX_QDBM, txpower_record_failure(s));
+    TEST_ASSERT_EQUAL_UINT8(3, s.failures);
+    for (int i = 0; i < 10; i++) txpower_record_failure(s);
+    TEST_ASSERT_EQUAL_UINT8(TX_POWER_MAX_QDBM, s.backoff_qdbm);  // bounded
+
+    // Successful wakes walk back down, one decay step at a time
+    s.backoff_qdbm = TX_POWER_STEP_QDBM;
+    txpower_record_success(s, -47);
+    TEST_ASSERT_EQUAL_UINT8(0, s.failures);
+    TEST_ASSERT_EQUAL_UINT8(TX_POWER_MIN_QDBM + TX_POWER_STEP_QDBM - TX_POWER_DECAY_QDBM,
+                            txpower_choose(s));
+    txpower_record_success(s, -47);
+    txpower_record_success(s, -47);
+    TEST_ASSERT_EQUAL_UINT8(TX_POWER_MIN_QDBM, txpower_choose(s));
+}
+
+// ── WifiStore: multi-network store and cached AP plan ────────────────────────
+
+static WifiStore wifi_test_store(void) {
+    WifiStore store = {};
+    wifi_store_add(store, "office", "pw-office");
+    wifi_store_add(store, "workshop", "pw-workshop");
+    wifi_store_add(store, "yard", "pw-yard");
+    return store;
+}
+
+void test_wifi_store_add_update_and_full(void) {
+    WifiStore store = wifi_test_store();
+    uint32_t  hash  = wifi_store_hash(store);
+    TEST_ASSERT_EQUAL_INT(1, wifi_store_add(store, "workshop", "new-pw"));
+    TEST_ASSERT_EQUAL_STRING("new-pw", store.nets[1].pass);
+    TEST_ASSERT_EQUAL_UINT32(hash, wifi_store_hash(store));  // passwords do not count
+
+    TEST_ASSERT_EQUAL_INT(-1, wifi_store_add(store, "", "x"));
+    TEST_ASSERT_EQUAL_INT(-1, wifi_store_add(store, "ssid-longer-than-thirty-two-chars!", "x"));
+    for (int i = 0; i < WIFI_STORE_MAX; i++) {
+        char ssid[8];
+        snprintf(ssid, sizeof(ssid), "net%d", i);
+        wifi_store_add(store, ssid, "");
+    }
+    TEST_ASSERT_EQUAL_UINT8(WIFI_STORE_MAX, store.count);
+    TEST_ASSERT_EQUAL_STRING("net5", store.nets[WIFI_STORE_MAX - 1].ssid);  // last slot reused
+    TEST_ASSERT_TRUE(hash != wifi_store_hash(store));
+}
+
+void test_wifi_store_adopts_portal_password(void) {
+    WifiStore store = wifi_test_store();
+    TEST_ASSERT_FALSE(wifi_store_adopt(store, "office", "pw-office"));  // unchanged: no rewrite
+    TEST_ASSERT_TRUE(wifi_store_adopt(store, "office", "changed"));     // portal changed it
+    TEST_ASSERT_EQUAL_STRING("changed", store.nets[0].pass);
+    TEST_ASSERT_EQUAL_UINT8(3, store.count);
+    TEST_ASSERT_TRUE(wifi_store_adopt(store, "barn", "pw-barn"));
+    TEST_ASSERT_EQUAL_UINT8(4, store.count);
+    TEST_ASSERT_FALSE(wifi_store_adopt(store, "", "x"));
+}
+
+void test_wifi_plan_cold_start_then_cached(void) {
+    WifiStore   store = wifi_test_store();
+    WifiCache   cache = {};
+    WifiAttempt plan[WIFI_PLAN_MAX];
+
+    // Cold start: scan first; workshop is the strongest stored network seen
+    TEST_ASSERT_TRUE(wifi_plan_needs_scan(cache, store));
+    WifiSeen seen[] = {
+        { "neighbour", -40, { 1, 1, 1, 1, 1, 1 }, 1 },
+        { "workshop",  -71, { 2, 2, 2, 2, 2, 1 }, 6 },
+        { "workshop",  -58, { 2, 2, 2, 2, 2, 2 }, 11 },
+        { "office",    -66, { 3, 3, 3, 3, 3, 3 }, 1 },
+    };
+    size_t n = wifi_rank_scan(store, seen, 4, plan, WIFI_PLAN_MAX);
+    TEST_ASSERT_EQUAL_UINT(2, n);
+    TEST_ASSERT_EQUAL_UINT8(WIFI_STRATEGY_SCAN, plan[0].strategy);
+    TEST_ASSERT_EQUAL_UINT8(1, plan[0].index);
+    TEST_ASSERT_EQUAL_UINT8(11, plan[0].channel);
+    TEST_ASSERT_EQUAL_UINT8(0, plan[1].index);
+    n += wifi_plan(store, cache, plan + n, WIFI_PLAN_MAX - n);
+    TEST_ASSERT_EQUAL_UINT(WIFI_PLAN_MAX, n);
+    TEST_ASSERT_EQUAL_UINT8(WIFI_STRATEGY_RANKED, plan[2].strategy);
+
+    // Warm wake: cached BSSID first, no scan, then the rest by wins
+    wifi_cache_record(cache, store, &plan[0], plan[0].bssid, plan[0].channel, 3200);
+    TEST_ASSERT_FALSE(wifi_plan_needs_scan(cache, store));
+    TEST_ASSERT_EQUAL_UINT(WIFI_PLAN_MAX, wifi_plan(store, cache, plan, WIFI_PLAN_MAX));
+    TEST_ASSERT_EQUAL_UINT8(WIFI_STRATEGY_CACHED, plan[0].strategy);
+    TEST_ASSERT_EQUAL_UINT8(1, plan[0].index);
+    TEST_ASSERT_EQUAL_UINT8(11, plan[0].channel);
+    TEST_ASSERT_EQUAL_UINT8(WIFI_STRATEGY_RANKED, plan[1].strategy);
+    TEST_ASSERT_EQUAL_UINT8(1, plan[1].index);  // most wins, SSID-only
+    TEST_ASSERT_EQUAL_UINT8(0, plan[2].index);
+
+    WifiAttempt cached = plan[0];
+    wifi_cache_record(cache, store, &cached, cached.bssid, cached.channel, 400);
+    const WifiStrategyStats& st = cache.stats[WIFI_STRATEGY_CACHED];
+    TEST_ASSERT_EQUAL_UINT16(1, st.connects);
+    TEST_ASSERT_EQUAL_UINT16(400, st.last_ms);
+    TEST_ASSERT_EQUAL_UINT16(1, cache.stats[WIFI_STRATEGY_SCAN].connects);
+    TEST_ASSERT_EQUAL_UINT16(2, cache.wins[1]);
+}
+
+void test_wifi_plan_scans_after_failures(void) {
+    WifiStore   store = wifi_test_store();
+    WifiCache   cache;
+    WifiAttempt plan[WIFI_PLAN_MAX];
+    wifi_cache_reset(cache, store);
+    WifiAttempt ok = { WIFI_STRATEGY_RANKED, 2, 0, { 0 } };
+    const uint8_t bssid[6] = { 4, 4, 4, 4, 4, 4 };
+    wifi_cache_record(cache, store, &ok, bssid, 6, 5000);
+    TEST_ASSERT_FALSE(wifi_plan_needs_scan(cache, store));
+
+    wifi_cache_record(cache, store, nullptr, bssid, 0, 0);
+    TEST_ASSERT_FALSE(wifi_plan_needs_scan(cache, store));
+    wifi_cache_record(cache, store, nullptr, bssid, 0, 0);
+    TEST_ASSERT_TRUE(wifi_plan_needs_scan(cache, store));
+    TEST_ASSERT_EQUAL_UINT(WIFI_PLAN_MAX, wifi_plan(store, cache, plan, WIFI_PLAN_MAX));
+    TEST_ASSERT_EQUAL_UINT8(WIFI_STRATEGY_RANKED, plan[0].strategy);  // no cached attempt
+    TEST_ASSERT_EQUAL_UINT8(2, plan[0].index);
+
+    // Editing /wifi.json (different SSIDs) invalidates the cache
+    wifi_store_add(store, "annex", "");
+    TEST_ASSERT_FALSE(wifi_cache_valid(cache, store));
+    TEST_ASSERT_TRUE(wifi_plan_needs_scan(cache, store));
+}
+
+// ── BootGuard: crash-loop detection ──────────────────────────────────────────
+
+#define RST_DEEP_SLEEP 5
+
+void test_boot_guard_trips_on_crash_loop(void) {
+    BootGuardState s;
+    memset(&s, 0xA5, sizeof(s));  // RTC contents after power-on
+    TEST_ASSERT_FALSE(boot_guard_on_boot(s, 0));
+    TEST_ASSERT_EQUAL_UINT32(BOOT_GUARD_MAGIC, s.magic);
+
+    // Exception while connecting to MQTT, twice: not yet a loop
+    s.phase = CPU_PHASE_MQTT_WAIT;
+    TEST_ASSERT_FALSE(boot_guard_on_boot(s, BOOT_REASON_EXCEPTION));
+    s.phase = CPU_PHASE_MQTT_WAIT;
+    TEST_ASSERT_FALSE(boot_guard_on_boot(s, BOOT_REASON_SOFT_WDT));
+    TEST_ASSERT_EQUAL_UINT8(CPU_PHASE_BOOT, s.phase);  // marker restarts
+
+    s.phase = CPU_PHASE_MQTT_WAIT;
+    TEST_ASSERT_TRUE(boot_guard_on_boot(s, BOOT_REASON_WDT));
+    TEST_ASSERT_EQUAL_UINT8(CPU_PHASE_MQTT_WAIT, s.failing_phase);
+    TEST_ASSERT_EQUAL_UINT8(3, boot_guard_abnormal_count(s));
+
+    char buf[64];
+    boot_guard_format(s, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("phase=mqtt;resets=3/8;reasons=1,3,2;backoff=0", buf);
+
+    // Degraded wakes end cleanly; the crashes age out of the window
+    int degraded = 0;
+    for (int i = 0; i < BOOT_GUARD_WINDOW; i++) {
+        s.phase = BOOT_GUARD_PHASE_IDLE;
+        if (boot_guard_on_boot(s, RST_DEEP_SLEEP)) degraded++;
+    }
+    TEST_ASSERT_EQUAL_INT(BOOT_GUARD_WINDOW - BOOT_GUARD_TRIP, degraded);
+    TEST_ASSERT_FALSE(s.degraded);
+}
+
+void test_boot_guard_reset_classification(void) {
+    // Reset pin or brownout counts only when it cut a wake short
+    TEST_ASSERT_TRUE(boot_guard_is_abnormal(BOOT_REASON_EXT_SYS, CPU_PHASE_WIFI_WAIT));
+    TEST_ASSERT_FALSE(boot_guard_is_abnormal(BOOT_REASON_EXT_SYS, BOOT_GUARD_PHASE_IDLE));
+    TEST_ASSERT_FALSE(boot_guard_is_abnormal(RST_DEEP_SLEEP, CPU_PHASE_SENSOR));
+    TEST_ASSERT_FALSE(boot_guard_is_abnormal(4, CPU_PHASE_PORTAL));  // ESP.restart() after portal save
+
+    // A crash with no marker set is charged to boot
+    BootGuardState s;
+    boot_guard_reset(s);
+    boot_guard_on_boot(s, BOOT_REASON_EXCEPTION);
+    s.phase = BOOT_GUARD_PHASE_IDLE;
+    boot_guard_on_boot(s, BOOT_REASON_EXCEPTION);
+    TEST_ASSERT_EQUAL_UINT8(CPU_PHASE_BOOT, s.failing_phase);
+}
+
+void test_boot_guard_relay_crash_never_skips(void) {
+    BootGuardState s;
+    boot_guard_reset(s);
+    TEST_ASSERT_FALSE(boot_guard_is_abnormal(BOOT_REASON_EXT_SYS, BOOT_GUARD_PHASE_RELAY));
+
+    // Gateway relay loop hits the watchdog three times
+    for (int i = 0; i < BOOT_GUARD_TRIP; i++) {
+        s.phase = BOOT_GUARD_PHASE_RELAY;
+        boot_guard_on_boot(s, BOOT_REASON_WDT);
+    }
+    TEST_ASSERT_TRUE(s.degraded);  // the fault report goes out
+    TEST_ASSERT_EQUAL_UINT8(BOOT_GUARD_PHASE_RELAY, s.failing_phase);
+    TEST_ASSERT_FALSE(boot_guard_skips(s, CPU_PHASE_BOOT));
+    TEST_ASSERT_FALSE(boot_guard_skips(s, BOOT_GUARD_PHASE_RELAY));
+
+    char buf[64];
+    boot_guard_format(s, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("phase=relay;resets=3/8;reasons=1,1,1;backoff=0", buf);
+
+    // The same loop in the MQTT phase is skipped
+    boot_guard_reset(s);
+    for (int i = 0; i < BOOT_GUARD_TRIP; i++) {
+        s.phase = CPU_PHASE_MQTT_WAIT;
+        boot_guard_on_boot(s, BOOT_REASON_WDT);
+    }
+    TEST_ASSERT_TRUE(boot_guard_skips(s, CPU_PHASE_MQTT_WAIT));
+}
+
+void test_boot_guard_backoff_doubles_and_caps(void) {
+    TEST_ASSERT_EQUAL_UINT32(120, boot_guard_backoff_s(60, 0));
+    TEST_ASSERT_EQUAL_UINT32(480, boot_guard_backoff_s(60, 2));
+    TEST_ASSERT_EQUAL_UINT32(BOOT_GUARD_BACKOFF_MAX_S, boot_guard_backoff_s(60, 40));
+    TEST_ASSERT_EQUAL_UINT32(86400, boot_guard_backoff_s(86400, 1));  // never shorter than normal
+}
+
+// ── seq: report sequence counter and loss accounting ─────────────────────────
+
+void test_seq_counter_checkpoint_and_restore(void) {
+    SeqState st;
+    TEST_ASSERT_TRUE(seq_restore(st, nullptr));  // fresh: epoch 0, first report is 1
+    TEST_ASSERT_EQUAL_INT(0, st.epoch);
+    int due = 0;
+    for (int i = 0; i < 130; i++) due += seq_advance(st) ? 1 : 0;
+    TEST_ASSERT_EQUAL_UINT32(130, st.seq);
+    TEST_ASSERT_EQUAL_INT(2, due);               // at 64 and 128
+    TEST_ASSERT_EQUAL_UINT32(128, st.checkpoint);
+
+    // Power loss: resume past anything used since the checkpoint, new epoch
+    SeqState flash = st;
+    SeqState back;
+    TEST_ASSERT_TRUE(seq_restore(back, &flash));
+    TEST_ASSERT_EQUAL_INT(1, back.epoch);
+    seq_advance(back);
+    TEST_ASSERT_EQUAL_UINT32(128 + SEQ_CHECKPOINT_EVERY + 1, back.seq);
+}
+
+void test_seq_payload_roundtrip(void) {
+    SeqState st;
+    seq_restore(st, nullptr);
+    seq_advance(st);
+    char buf[48] = "BAT_LOW";
+    size_t n = strlen(buf);
+    TEST_ASSERT_GREATER_THAN(0, seq_format(st, 5234, buf + n, sizeof(buf) - n));
+    TEST_ASSERT_EQUAL_STRING("BAT_LOW;seq=1;ep=0;up=5234", buf);
+
+    SeqStamp s;
+    TEST_ASSERT_TRUE(seq_parse(buf, strlen(buf), s));
+    TEST_ASSERT_EQUAL_UINT32(1, s.seq);
+    TEST_ASSERT_EQUAL_UINT32(5234, s.up_ms);
+    TEST_ASSERT_FALSE(seq_parse("OK", 2, s));
+    TEST_ASSERT_FALSE(seq_parse("OK;seq=4x;ep=0;up=1", 19, s));
+    TEST_ASSERT_EQUAL_INT(0, seq_format(st, 1, buf, 8));
+}
+
+void test_seq_stats_gaps_late_and_restart(void) {
+    static SeqDeviceStats d;
+    seq_stats_init(d, "esp-a1b2c3", 10);
+    SeqStamp s = { 10, 0, 1000 };
+    TEST_ASSERT_EQUAL_INT(SEQ_FIRST, seq_stats_add(d, s));
+    s.seq = 11;
+    TEST_ASSERT_EQUAL_INT(SEQ_IN_ORDER, seq_stats_add(d, s));
+    s.seq = 15;                                   // 12..14 missing
+    TEST_ASSERT_EQUAL_INT(SEQ_GAP, seq_stats_add(d, s));
+    s.seq = 13;
+    TEST_ASSERT_EQUAL_INT(SEQ_LATE, seq_stats_add(d, s));
+    TEST_ASSERT_EQUAL_INT(SEQ_DUPLICATE, seq_stats_add(d, s));
+    s.seq = 15;
+    TEST_ASSERT_EQUAL_INT(SEQ_DUPLICATE, seq_stats_add(d, s));
+    TEST_ASSERT_EQUAL_UINT32(4, d.received);
+    TEST_ASSERT_EQUAL_UINT32(1, d.gaps);
+    TEST_ASSERT_EQUAL_UINT32(2, d.missing);
+    TEST_ASSERT_EQUAL_UINT32(2, d.duplicates);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 2.0f / 6.0f, seq_stats_loss(d));
+
+    // Restored counter: a jump with a new epoch is a restart, not a gap
+    s = { 200, 1, 3000 };
+    TEST_ASSERT_EQUAL_INT(SEQ_RESTART, seq_stats_add(d, s));
+    s = { 16, 0, 1000 };                          // older epoch: stale
+    TEST_ASSERT_EQUAL_INT(SEQ_DUPLICATE, seq_stats_add(d, s));
+    TEST_ASSERT_EQUAL_UINT32(1, d.restarts);
+    TEST_ASSERT_EQUAL_UINT32(1, d.gaps);
+
+    // up_ms: four at 1000 ms, one at 3000 ms
+    TEST_ASSERT_EQUAL_UINT32(1050, seq_stats_up_percentile(d, 50));
+    TEST_ASSERT_EQUAL_UINT32(3000, seq_stats_up_percentile(d, 99));
+}
+
+void test_seq_stats_receive_intervals(void) {
+    static SeqDeviceStats d;
+    seq_stats_init(d, "esp-a1b2c3", 10);
+    d.period_ms = 60000;
+    SeqStamp s = { 1, 0, 900 };
+    seq_stats_add(d, s, 1000000);
+    s.seq = 2;
+    seq_stats_add(d, s, 1060400);                 // 400 ms past the period
+    s.seq = 4;
+    seq_stats_add(d, s, 1180900);                 // two periods: 250 ms each
+    s.seq = 3;
+    seq_stats_add(d, s, 1181000);                 // late: no interval
+    s.seq = 5;
+    seq_stats_add(d, s, 1240000);                 // 900 ms early, sampled as 0
+    TEST_ASSERT_EQUAL_UINT32(3, d.rx_samples);
+    TEST_ASSERT_EQUAL_UINT32(300, seq_stats_rx_percentile(d, 50));
+    TEST_ASSERT_EQUAL_UINT32(400, seq_stats_rx_percentile(d, 99));
+    TEST_ASSERT_EQUAL_UINT32(900, d.rx_early_ms);
+
+    // Unknown receive time or period: nothing sampled
+    static SeqDeviceStats e;
+    seq_stats_init(e, "esp-000001", 10);
+    s = { 1, 0, 900 };
+    seq_stats_add(e, s, 1000000);
+    s.seq = 2;
+    seq_stats_add(e, s, 1060000);
+    TEST_ASSERT_EQUAL_UINT32(0, e.rx_samples);
+    TEST_ASSERT_EQUAL_UINT32(0, seq_stats_rx_percentile(e, 50));
+}
+
+// ── portal: idle policy and duty accounting ──────────────────────────────────
+
+void test_portal_idle_follows_activity(void) {
+    PortalDuty d;
+    portal_duty_begin(d);
+    TEST_ASSERT_EQUAL_UINT32(PORTAL_IDLE_EMPTY_MS, portal_idle_ms(d, 0, 0));
+    portal_duty_poll(d, 150, 10);                 // station, nothing served yet
+    TEST_ASSERT_EQUAL_UINT32(PORTAL_IDLE_QUIET_MS, portal_idle_ms(d, 1, 10));
+
+    portal_duty_poll(d, 8000, 1000);              // served a request
+    TEST_ASSERT_EQUAL_UINT32(0, portal_idle_ms(d, 1, 1000 + PORTAL_ACTIVE_HOLD_MS - 1));
+    TEST_ASSERT_EQUAL_UINT32(PORTAL_IDLE_QUIET_MS, portal_idle_ms(d, 1, 1000 + PORTAL_ACTIVE_HOLD_MS));
+    TEST_ASSERT_EQUAL_UINT32(PORTAL_IDLE_EMPTY_MS, portal_idle_ms(d, 0, 1500));  // station left
+    TEST_ASSERT_EQUAL_UINT32(2, d.polls);
+    TEST_ASSERT_EQUAL_UINT32(1, d.busy_polls);
+
+    portal_duty_idle(d, 900, 1000);
+    TEST_ASSERT_EQUAL_UINT8(90, portal_duty_idle_pct(d));
+}
+
+// ── power wait: mode policy and light sleep slicing ─────────────────────────
+
+void test_power_wait_mode_by_reason(void) {
+    // Waits for a reply keep the SDK default; gaps light-sleep against an associated AP
+    TEST_ASSERT_EQUAL(WAIT_MODE_DEFAULT,    power_wait_mode(WAIT_ASSOCIATION, false));
+    TEST_ASSERT_EQUAL(WAIT_MODE_DEFAULT,    power_wait_mode(WAIT_NETWORK, true));
+    TEST_ASSERT_EQUAL(WAIT_MODE_AUTO_LIGHT, power_wait_mode(WAIT_RETRY_GAP, true));
+    TEST_ASSERT_EQUAL(WAIT_MODE_AUTO_LIGHT, power_wait_mode(WAIT_SENSOR_GAP, true));
+    TEST_ASSERT_EQUAL(WAIT_MODE_DEFAULT,    power_wait_mode(WAIT_SENSOR_GAP, false));  // ESP-NOW path
+    TEST_ASSERT_EQUAL(WAIT_MODE_DEFAULT,    power_wait_mode(WAIT_SENSOR_CAPTURE, true));
+    TEST_ASSERT_EQUAL(WAIT_MODE_LIGHT,      power_wait_mode(WAIT_RADIO_OFF, true));
+    TEST_ASSERT_EQUAL_STRING("auto-light", power_wait_mode_name(WAIT_MODE_AUTO_LIGHT));
+}
+
+void test_power_wait_slice_ends_at_led_step(void) {
+    bool light = false;
+    TEST_ASSERT_EQUAL_UINT32(100, power_wait_slice_ms(60000, 100, light));
+    TEST_ASSERT_TRUE(light);
+    TEST_ASSERT_EQUAL_UINT32(40, power_wait_slice_ms(40, 100, light));  // wait ends first
+    TEST_ASSERT_TRUE(light);
+    TEST_ASSERT_EQUAL_UINT32(POWER_LIGHT_MAX_MS, power_wait_slice_ms(90000, LED_NO_CHANGE, light));
+    TEST_ASSERT_TRUE(light);
+
+    // Short slices stay awake so timer1 steps the LED itself
+    TEST_ASSERT_EQUAL_UINT32(POWER_LIGHT_MIN_MS - 1,
+                             power_wait_slice_ms(500, POWER_LIGHT_MIN_MS - 1, light));
+    TEST_ASSERT_FALSE(light);
+    TEST_ASSERT_EQUAL_UINT32(1, power_wait_slice_ms(500, 0, light));  // step due now
+    TEST_ASSERT_FALSE(light);
+    TEST_ASSERT_EQUAL_UINT32(0, power_wait_slice_ms(0, 100, light));
+}
+
 // ── main ─────────────────────────────────────────────────────────────────────
 
 int main(void) {
@@ -140,6 +1494,9 @@ int main(void) {
 
     RUN_TEST(test_defaults_all_fields);
     RUN_TEST(test_defaults_unconditional_overwrite);
+    RUN_TEST(test_config_normalize_sensors);
+    RUN_TEST(test_config_sensor_pins_allowed);
+    RUN_TEST(test_config_json_worst_case_fits);
 
     RUN_TEST(test_build_telemetry_topic_standard);
     RUN_TEST(test_build_telemetry_topic_nested_root);
@@ -148,5 +1505,76 @@ int main(void) {
     RUN_TEST(test_battery_status_str_normal);
     RUN_TEST(test_battery_status_str_boundary_crit);
 
+    RUN_TEST(test_sleep_next_chunk_critical_battery);
+    RUN_TEST(test_sleep_next_chunk_short);
+
+    RUN_TEST(test_parse_topic_roundtrip_telemetry);
+    RUN_TEST(test_parse_topic_roundtrip_status);
+    RUN_TEST(test_parse_topic_roundtrip_channel);
+    RUN_TEST(test_parse_topic_rejects_foreign);
+    RUN_TEST(test_parse_decimal_payload_formats);
+    RUN_TEST(test_ingest_split_line_with_timestamp);
+    RUN_TEST(test_ingest_decode_drops_invalid);
+    RUN_TEST(test_ingest_format_line_protocol_and_csv);
+    RUN_TEST(test_ingest_format_channel);
+
+    RUN_TEST(test_cycle_status_str_priority);
+    RUN_TEST(test_cycle_status_str_channels);
+    RUN_TEST(test_config_sleep_for_battery_table);
+    RUN_TEST(test_policy_simulate_constant_trace);
+    RUN_TEST(test_policy_simulate_critical_battery_chains);
+
+    RUN_TEST(test_led_full_mode_matches_spec);
+    RUN_TEST(test_led_pulse_mode_keeps_period);
+    RUN_TEST(test_led_off_mode_never_on);
+
+    RUN_TEST(test_coalescer_burst_single_segment);
+    RUN_TEST(test_coalescer_overflow_flushes_early);
+
+    RUN_TEST(test_cpu_phase_mhz_policy);
+    RUN_TEST(test_cpu_phase_log_accumulates);
+
+    RUN_TEST(test_espnow_frame_roundtrip);
+    RUN_TEST(test_espnow_sender_to_gateway_topics);
+    RUN_TEST(test_espnow_sensor_failure_skips_measurements);
+    RUN_TEST(test_espnow_gateway_checks_sender);
+    RUN_TEST(test_espnow_send_gives_up);
+
+    RUN_TEST(test_event_log_wraps_oldest_first);
+    RUN_TEST(test_event_log_drain_chunks_and_resumes);
+
+    RUN_TEST(test_mqttsn_topic_ids_follow_layout);
+    RUN_TEST(test_mqttsn_channel_topic_ids);
+    RUN_TEST(test_mqttsn_wake_two_round_trips);
+    RUN_TEST(test_mqttsn_sleeping_session_resumes);
+    RUN_TEST(test_mqttsn_rejections_and_timeouts);
+
+    RUN_TEST(test_dht_decode_valid_frames);
+    RUN_TEST(test_dht_decode_checksum_keeps_bytes);
+    RUN_TEST(test_dht_decode_truncated_and_silent);
+    RUN_TEST(test_dht_decode_rejects_bad_pulse);
+
+    RUN_TEST(test_txpower_choose_from_rssi);
+    RUN_TEST(test_txpower_backoff_steps_and_decays);
+
+    RUN_TEST(test_wifi_store_add_update_and_full);
+    RUN_TEST(test_wifi_store_adopts_portal_password);
+    RUN_TEST(test_wifi_plan_cold_start_then_cached);
+    RUN_TEST(test_wifi_plan_scans_after_failures);
+
+    RUN_TEST(test_boot_guard_trips_on_crash_loop);
+    RUN_TEST(test_boot_guard_reset_classification);
+    RUN_TEST(test_boot_guard_relay_crash_never_skips);
+    RUN_TEST(test_boot_guard_backoff_doubles_and_caps);
+
+    RUN_TEST(test_seq_counter_checkpoint_and_restore);
+    RUN_TEST(test_seq_payload_roundtrip);
+    RUN_TEST(test_seq_stats_gaps_late_and_restart);
+    RUN_TEST(test_seq_stats_receive_intervals);
+
+    RUN_TEST(test_portal_idle_follows_activity);
+    RUN_TEST(test_power_wait_mode_by_reason);
+    RUN_TEST(test_power_wait_slice_ends_at_led_step);
+
     return UNITY_END();
 }
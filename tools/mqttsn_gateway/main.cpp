@@ -0,0 +1,172 @@
+// mqttsn-gateway — MQTT-SN stand-in gateway for bench comparisons.
+//
+// Build & run (PlatformIO native env, POSIX sockets, no Arduino dependencies):
+//   pio run -e mqttsn_gateway
+//   .pio/build/mqttsn_gateway/program --root devices | .pio/build/ingest/program
+//
+// Answers CONNECT, predefined-topic PUBLISH and sleeping DISCONNECT from any
+// number of devices, holding a sleeping device's session until its next
+// CONNECT resumes it (or twice the announced sleep has passed). Prints each
+// publish as "unix_ts topic payload" on stdout (the tools/ingest input format). Per-session datagram counts and
+// announced sleep go to stderr, so MQTT-SN wakes can be compared with the
+// TCP path's "[MQTT] Disconnected" serial line.
+//
+// --predefined DEVICE prints the predefinedTopic.conf lines a real gateway
+// (Eclipse Paho MQTT-SN gateway) needs for that device, then exits.
+// --channels a,b lists the device's named sensor channels, in config.json
+// order, for both modes.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "MqttSn.h"
+
+#define MAX_SESSIONS 32
+#define MAX_CHANNELS 8
+
+// One gateway state per source address — the library stand-in is per-client
+struct Session {
+    sockaddr_in      addr;
+    MqttSnGatewaySim gw;
+    unsigned         datagrams;
+    time_t           asleep_until;  // 0 = awake; slot reusable after this
+    bool             used;
+};
+
+static Session     g_sessions[MAX_SESSIONS];
+static const char* g_channels[MAX_CHANNELS];
+static uint8_t     g_channel_count = 0;
+
+static void print_publish(void* ctx, const char* topic, const char* payload, bool retain) {
+    (void)ctx;
+    (void)retain;
+    printf("%ld %s %s\n", (long)time(nullptr), topic, payload);
+    fflush(stdout);
+}
+
+static Session* session_for(const sockaddr_in& from, const char* root) {
+    Session* free_slot = nullptr;
+    time_t   now       = time(nullptr);
+    for (Session& s : g_sessions) {
+        if (s.used && s.addr.sin_addr.s_addr == from.sin_addr.s_addr &&
+            s.addr.sin_port == from.sin_port) return &s;
+        if (s.used && s.asleep_until && now > s.asleep_until) s.used = false;  // lost
+        if (!s.used && !free_slot) free_slot = &s;
+    }
+    if (!free_slot) return nullptr;
+    free_slot->used         = true;
+    free_slot->addr         = from;
+    free_slot->datagrams    = 0;
+    free_slot->asleep_until = 0;
+    mqttsn_gateway_init(free_slot->gw, root, print_publish, nullptr);
+    free_slot->gw.channels      = g_channels;
+    free_slot->gw.channel_count = g_channel_count;
+    return free_slot;
+}
+
+static int print_predefined(const char* root, const char* device) {
+    char topic[128];
+    for (uint16_t id = 1; id < MQTTSN_TOPIC_COUNT; id++) {
+        mqttsn_topic_name(id, root, device, topic, sizeof(topic));
+        printf("%s, %s, %u\n", device, topic, (unsigned)id);
+    }
+    for (uint16_t id = MQTTSN_TOPIC_CHANNEL_BASE;
+         mqttsn_topic_name(id, root, device, topic, sizeof(topic), g_channels, g_channel_count);
+         id++) {
+        printf("%s, %s, %u\n", device, topic, (unsigned)id);
+    }
+    return 0;
+}
+
+// "supply,return" -> g_channels; the list is split in place
+static bool parse_channels(char* list) {
+    for (char* name = strtok(list, ","); name; name = strtok(nullptr, ",")) {
+        if (g_channel_count == MAX_CHANNELS) return false;
+        g_channels[g_channel_count++] = name;
+    }
+    return true;
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr, "usage: %s [--root ROOT] [--port PORT] [--channels A,B,...] "
+                    "[--predefined DEVICE]\n", argv0);
+}
+
+int main(int argc, char** argv) {
+    const char* root   = "devices";
+    int         port   = MQTTSN_DEFAULT_PORT;
+    const char* device = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--root") == 0 && i + 1 < argc) {
+            root = argv[++i];
+        } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--channels") == 0 && i + 1 < argc) {
+            if (!parse_channels(argv[++i])) {
+                fprintf(stderr, "[MQTT-SN] At most %d channels\n", MAX_CHANNELS);
+                return 2;
+            }
+        } else if (strcmp(argv[i], "--predefined") == 0 && i + 1 < argc) {
+            device = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (device) return print_predefined(root, device);
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        perror("[MQTT-SN] socket");
+        return 1;
+    }
+    sockaddr_in local = {};
+    local.sin_family      = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port        = htons((uint16_t)port);
+    if (bind(fd, (sockaddr*)&local, sizeof(local)) < 0) {
+        perror("[MQTT-SN] bind");
+        return 1;
+    }
+    fprintf(stderr, "[MQTT-SN] Listening on UDP %d, root \"%s\"\n", port, root);
+
+    for (;;) {
+        uint8_t     in[MQTTSN_MAX_PACKET + 1];
+        uint8_t     out[MQTTSN_MAX_PACKET];
+        sockaddr_in from;
+        socklen_t   from_len = sizeof(from);
+        ssize_t n = recvfrom(fd, in, sizeof(in), 0, (sockaddr*)&from, &from_len);
+        if (n <= 0) continue;
+
+        Session* s = session_for(from, root);
+        if (!s) {
+            fprintf(stderr, "[MQTT-SN] Session table full, datagram dropped\n");
+            continue;
+        }
+        s->datagrams++;
+        uint8_t type  = mqttsn_msg_type(in, (size_t)n);
+        size_t  reply = mqttsn_gateway_handle(s->gw, in, (size_t)n, out, sizeof(out));
+        if (reply) sendto(fd, out, reply, 0, (sockaddr*)&from, from_len);
+
+        if (type == MQTTSN_CONNECT) {
+            fprintf(stderr, "[MQTT-SN] %s: %s session\n", s->gw.client_id,
+                    s->gw.resumed ? "resumed" : "new");
+            s->datagrams     = 1;  // per-wake counts for the DISCONNECT line
+            s->gw.publishes  = 0;
+            s->asleep_until  = 0;
+        } else if (type == MQTTSN_DISCONNECT) {
+            fprintf(stderr, "[MQTT-SN] %s: %u datagrams, %u published, asleep %us\n",
+                    s->gw.client_id, s->datagrams, (unsigned)s->gw.publishes,
+                    (unsigned)s->gw.sleep_s);
+            // A sleeping client keeps its session for the next wake
+            if (s->gw.session) s->asleep_until = time(nullptr) + 2 * (time_t)s->gw.sleep_s;
+            else               s->used = false;
+        }
+    }
+}
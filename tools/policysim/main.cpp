@@ -0,0 +1,129 @@
+// policysim — replay recorded traces through the firmware's reporting policy.
+//
+// Build & run (PlatformIO native env):
+//   pio run -e policysim
+//   .pio/build/policysim/program --trace site.csv --policy firmware:
+//       --policy slow:300,900,86400,3.5,3.4,1
+//
+// Trace CSV: t_s,temp_c,hum_pct,battery_v — one row per ground-truth sample,
+// t_s strictly increasing; "nan" temp/hum models a failed DHT read. A header
+// row is skipped. --synth-days N generates a 1-minute synthetic trace instead
+// (diurnal + weekly temperature swing, linear battery discharge).
+//
+// Policy spec: name:normal_s,low_s,crit_s,low_v,crit_v,num_reads — trailing
+// fields may be omitted and keep the firmware defaults. Without --policy the
+// firmware defaults are evaluated.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include "PolicySim.h"
+
+#define MAX_POLICIES 16
+
+static bool load_trace(const char* path, std::vector<TraceSample>& trace) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "[Sim] cannot open %s\n", path);
+        return false;
+    }
+    char line[256];
+    unsigned long lineno = 0;
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        TraceSample s;
+        unsigned long t;
+        if (sscanf(line, "%lu,%f,%f,%f", &t, &s.temp, &s.hum, &s.battery_v) != 4) {
+            if (lineno > 1) fprintf(stderr, "[Sim] %s:%lu: skipped\n", path, lineno);
+            continue;
+        }
+        s.t_s = (uint32_t)t;
+        if (!trace.empty() && s.t_s <= trace.back().t_s) {
+            fprintf(stderr, "[Sim] %s:%lu: time not increasing, skipped\n", path, lineno);
+            continue;
+        }
+        trace.push_back(s);
+    }
+    fclose(f);
+    return !trace.empty();
+}
+
+static void synth_trace(int days, std::vector<TraceSample>& trace) {
+    const double day  = 86400.0;
+    const uint32_t n  = (uint32_t)days * 1440u;
+    uint32_t lcg = 12345;
+    trace.reserve(n);
+    for (uint32_t i = 0; i < n; i++) {
+        double t = i * 60.0;
+        lcg = lcg * 1103515245u + 12345u;
+        double noise = ((lcg >> 16) & 0x7FFF) / 32768.0 - 0.5;
+        TraceSample s;
+        s.t_s       = (uint32_t)t;
+        s.temp      = (float)(20.0 + 4.0 * sin(2 * M_PI * t / day)
+                                   + 3.0 * sin(2 * M_PI * t / (7 * day)) + 0.3 * noise);
+        s.hum       = (float)(55.0 - 10.0 * sin(2 * M_PI * t / day) + noise);
+        s.battery_v = (float)(4.1 - 0.8 * (double)i / n);
+        trace.push_back(s);
+    }
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr, "usage: %s (--trace FILE | --synth-days N) [--policy SPEC]... "
+                    "[--capacity-mah N]\n", argv0);
+}
+
+int main(int argc, char** argv) {
+    std::vector<TraceSample> trace;
+    Policy policies[MAX_POLICIES];
+    int n_policies = 0;
+    double capacity_mah = 2000.0;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--trace") && i + 1 < argc) {
+            if (!load_trace(argv[++i], trace)) return 1;
+        } else if (!strcmp(argv[i], "--synth-days") && i + 1 < argc) {
+            synth_trace(atoi(argv[++i]), trace);
+        } else if (!strcmp(argv[i], "--policy") && i + 1 < argc && n_policies < MAX_POLICIES) {
+            if (!policy_parse(argv[++i], policies[n_policies])) {
+                fprintf(stderr, "[Sim] bad policy spec: %s\n", argv[i]);
+                return 2;
+            }
+            n_policies++;
+        } else if (!strcmp(argv[i], "--capacity-mah") && i + 1 < argc) {
+            capacity_mah = atof(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (trace.empty()) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (n_policies == 0) policy_default(policies[n_policies++]);
+
+    EnergyModel model;
+    policy_default_energy_model(model);
+
+    printf("trace: %zu samples, %.1f days\n\n", trace.size(),
+           (trace.back().t_s - trace.front().t_s) / 86400.0);
+    printf("%-12s %9s %9s %9s %10s %8s %9s %7s %7s %7s %8s\n",
+           "policy", "sessions", "contin.", "publish", "energy_J", "avg_mA",
+           "life_d", "T_rmse", "T_max", "H_rmse", "sim_ms");
+
+    for (int p = 0; p < n_policies; p++) {
+        PolicyResult r;
+        auto t0 = std::chrono::steady_clock::now();
+        policy_simulate(trace.data(), trace.size(), policies[p], model, r);
+        auto t1 = std::chrono::steady_clock::now();
+        double life_d = r.avg_current_ma > 0 ? capacity_mah / r.avg_current_ma / 24.0 : 0.0;
+        printf("%-12s %9u %9u %9u %10.1f %8.3f %9.1f %7.2f %7.2f %7.2f %8.2f\n",
+               policies[p].name, r.full_wakes, r.continuation_wakes, r.publishes,
+               r.energy_j, r.avg_current_ma, life_d, r.temp_rmse, r.temp_max_err,
+               r.hum_rmse, std::chrono::duration<double, std::milli>(t1 - t0).count());
+    }
+    return 0;
+}
@@ -0,0 +1,322 @@
+// seqstat — per-device report loss, gaps, duplicates and timing from
+// sequence-stamped status payloads (report.seq = true, see SeqCounter.h).
+//
+// Build & run (PlatformIO native env, POSIX sockets, no Arduino dependencies):
+//   pio run -e seqstat
+//   .pio/build/seqstat/program --broker localhost --root devices
+//   mosquitto_sub -v -t 'devices/#' | .pio/build/seqstat/program
+//
+// --broker HOST[:PORT] subscribes to {root}/# itself (MQTT 3.1.1, QoS 0,
+// clean session). Retained messages are the broker replaying the last
+// status, not reports, and are skipped. Without --broker, reads
+// "[unix_ts] topic payload" lines from stdin (the tools/ingest input format).
+//
+// The table goes to stdout at EOF, on SIGINT/SIGTERM and every --every
+// seconds (broker mode). up_* is the device's awake time: the "up" field,
+// ms from reset to the status publish. rx_* is end-to-end timing on the
+// host clock: how far the interval between receiving consecutive reports
+// ran past the expected --period (default 60 s, the sleep.normal_s
+// default); rx_early is the largest lead of a report that came in early.
+// The device has no synchronised clock, so this is drift and transit
+// variation, not absolute transit time. Receive time is when the broker
+// delivered the report, or in stdin mode the line's timestamp (arrival
+// time without one). Devices on a battery-dependent sleep interval show
+// the longer intervals as delay.
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "SeqStats.h"
+#include "TelemetryIngest.h"
+
+#define MAX_DEVICES    256
+#define LINE_MAX_LEN   1024
+#define MQTT_KEEPALIVE 60
+
+static SeqDeviceStats g_devices[MAX_DEVICES];
+static size_t         g_count      = 0;
+static unsigned long  g_unstamped  = 0;   // status payloads without a seq suffix
+static unsigned long  g_dropped    = 0;   // devices beyond MAX_DEVICES
+static uint32_t       g_period_ms  = 60000;
+static volatile sig_atomic_t g_stop = 0;
+
+static void on_signal(int) { g_stop = 1; }
+
+static uint64_t now_ms() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+// -- Accounting ───────────────────────────────────────────────────────────────
+
+static void account(const char* topic, size_t topic_len, const char* payload, size_t payload_len,
+                    uint64_t rx_ms) {
+    ParsedTopic t;
+    if (!parse_topic(topic, topic_len, t) || t.kind != TOPIC_STATUS) return;
+    SeqStamp s;
+    if (!seq_parse(payload, payload_len, s)) {
+        g_unstamped++;
+        return;
+    }
+    SeqDeviceStats* d = seq_stats_lookup(g_devices, g_count, MAX_DEVICES, t.device.ptr, t.device.len);
+    if (!d) {
+        g_dropped++;
+        return;
+    }
+    d->period_ms = g_period_ms;
+    seq_stats_add(*d, s, rx_ms);
+}
+
+static void print_report() {
+    printf("%-20s %8s %6s %6s %6s %8s %6s %7s %7s %7s %7s %7s %7s %7s %7s %7s %8s\n",
+           "device", "received", "dup", "late", "gaps", "missing", "epoch", "loss%", "up_p50",
+           "up_p90", "up_p99", "up_max", "rx_p50", "rx_p90", "rx_p99", "rx_max", "rx_early");
+    for (size_t i = 0; i < g_count; i++) {
+        const SeqDeviceStats& d = g_devices[i];
+        printf("%-20s %8u %6u %6u %6u %8u %6u %7.2f %7u %7u %7u %7u %7u %7u %7u %7u %8u\n",
+               d.device, d.received, d.duplicates, d.late, d.gaps, d.missing, (unsigned)d.epoch,
+               seq_stats_loss(d) * 100.0f, seq_stats_up_percentile(d, 50),
+               seq_stats_up_percentile(d, 90), seq_stats_up_percentile(d, 99), d.up_max_ms,
+               seq_stats_rx_percentile(d, 50), seq_stats_rx_percentile(d, 90),
+               seq_stats_rx_percentile(d, 99), d.rx_max_ms, d.rx_early_ms);
+    }
+    if (g_unstamped || g_dropped) {
+        printf("(%lu status payloads without seq, %lu from devices over the %d limit)\n",
+               g_unstamped, g_dropped, MAX_DEVICES);
+    }
+    fflush(stdout);
+}
+
+// -- stdin mode ───────────────────────────────────────────────────────────────
+
+static int run_stdin() {
+    char line[LINE_MAX_LEN];
+    while (!g_stop && fgets(line, sizeof(line), stdin)) {
+        IngestMessage m;
+        if (!ingest_split_line(line, strlen(line), m)) continue;
+        uint64_t rx_ms = m.ts_ns ? (uint64_t)(m.ts_ns / 1000000) : now_ms();
+        account(m.topic, m.topic_len, m.payload, m.payload_len, rx_ms);
+    }
+    print_report();
+    return 0;
+}
+
+// -- Minimal MQTT 3.1.1 subscriber ────────────────────────────────────────────
+
+static bool send_all(int fd, const uint8_t* p, size_t n) {
+    while (n > 0) {
+        ssize_t w = send(fd, p, n, 0);
+        if (w <= 0) return false;
+        p += w;
+        n -= (size_t)w;
+    }
+    return true;
+}
+
+static bool recv_all(int fd, uint8_t* p, size_t n) {
+    while (n > 0) {
+        ssize_t r = recv(fd, p, n, 0);
+        if (r <= 0) return false;
+        p += r;
+        n -= (size_t)r;
+    }
+    return true;
+}
+
+static size_t put_remaining_len(uint8_t* p, size_t len) {
+    size_t i = 0;
+    do {
+        uint8_t b = len % 128;
+        len /= 128;
+        p[i++] = (uint8_t)(b | (len ? 0x80 : 0));
+    } while (len);
+    return i;
+}
+
+static size_t put_str(uint8_t* p, const char* s) {
+    size_t n = strlen(s);
+    p[0] = (uint8_t)(n >> 8);
+    p[1] = (uint8_t)n;
+    memcpy(p + 2, s, n);
+    return n + 2;
+}
+
+// One control packet: fixed header byte, then a body of at most cap bytes
+// (longer bodies are read and truncated). Returns the body length, or -1.
+static long read_packet(int fd, uint8_t& header, uint8_t* body, size_t cap) {
+    if (!recv_all(fd, &header, 1)) return -1;
+    size_t len = 0;
+    for (int shift = 0; shift < 28; shift += 7) {
+        uint8_t b;
+        if (!recv_all(fd, &b, 1)) return -1;
+        len |= (size_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) break;
+    }
+    size_t keep = len < cap ? len : cap;
+    if (!recv_all(fd, body, keep)) return -1;
+    for (size_t skip = len - keep; skip > 0; skip--) {
+        uint8_t b;
+        if (!recv_all(fd, &b, 1)) return -1;
+    }
+    return (long)keep;
+}
+
+static int mqtt_open(const char* host, const char* port, const char* filter) {
+    addrinfo hints = {};
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res = nullptr;
+    if (getaddrinfo(host, port, &hints, &res) != 0) {
+        fprintf(stderr, "[Seqstat] Cannot resolve %s\n", host);
+        return -1;
+    }
+    int fd = -1;
+    for (addrinfo* a = res; a && fd < 0; a = a->ai_next) {
+        fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd >= 0 && connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(res);
+    if (fd < 0) {
+        perror("[Seqstat] connect");
+        return -1;
+    }
+
+    uint8_t pkt[512];
+    uint8_t body[512];
+    char    client_id[32];
+    snprintf(client_id, sizeof(client_id), "seqstat-%ld", (long)getpid());
+
+    // CONNECT: protocol "MQTT" level 4, clean session
+    size_t n = put_str(body, "MQTT");
+    body[n++] = 4;
+    body[n++] = 0x02;
+    body[n++] = 0;
+    body[n++] = MQTT_KEEPALIVE;
+    n += put_str(body + n, client_id);
+    pkt[0] = 0x10;
+    size_t h = 1 + put_remaining_len(pkt + 1, n);
+    memcpy(pkt + h, body, n);
+    uint8_t hdr;
+    if (!send_all(fd, pkt, h + n) || read_packet(fd, hdr, body, sizeof(body)) < 2 ||
+        hdr != 0x20 || body[1] != 0) {
+        fprintf(stderr, "[Seqstat] Broker refused the connection\n");
+        close(fd);
+        return -1;
+    }
+
+    // SUBSCRIBE packet id 1, QoS 0
+    n = 0;
+    body[n++] = 0;
+    body[n++] = 1;
+    n += put_str(body + n, filter);
+    body[n++] = 0;
+    pkt[0] = 0x82;
+    h = 1 + put_remaining_len(pkt + 1, n);
+    memcpy(pkt + h, body, n);
+    if (!send_all(fd, pkt, h + n) || read_packet(fd, hdr, body, sizeof(body)) < 3 ||
+        hdr != 0x90 || body[2] == 0x80) {
+        fprintf(stderr, "[Seqstat] Subscription to %s refused\n", filter);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int run_broker(const char* broker, const char* root, int every_s) {
+    char host[256];
+    strncpy(host, broker, sizeof(host) - 1);
+    host[sizeof(host) - 1] = '\0';
+    const char* port  = "1883";
+    char*       colon = strrchr(host, ':');
+    if (colon) {
+        *colon = '\0';
+        port   = colon + 1;
+    }
+    char filter[128];
+    snprintf(filter, sizeof(filter), "%s/#", root);
+
+    int fd = mqtt_open(host, port, filter);
+    if (fd < 0) return 1;
+    fprintf(stderr, "[Seqstat] Subscribed to %s on %s:%s\n", filter, host, port);
+
+    time_t last_ping   = time(nullptr);
+    time_t last_report = last_ping;
+    while (!g_stop) {
+        fd_set rd;
+        FD_ZERO(&rd);
+        FD_SET(fd, &rd);
+        timeval tv = { 1, 0 };
+        int ready = select(fd + 1, &rd, nullptr, nullptr, &tv);
+        time_t now = time(nullptr);
+        if (now - last_ping >= MQTT_KEEPALIVE / 2) {
+            static const uint8_t kPing[2] = { 0xC0, 0x00 };
+            if (!send_all(fd, kPing, sizeof(kPing))) break;
+            last_ping = now;
+        }
+        if (every_s > 0 && now - last_report >= every_s) {
+            print_report();
+            last_report = now;
+        }
+        if (ready <= 0) continue;
+
+        uint8_t hdr;
+        uint8_t body[LINE_MAX_LEN];
+        long    n = read_packet(fd, hdr, body, sizeof(body));
+        if (n < 0) {
+            fprintf(stderr, "[Seqstat] Broker closed the connection\n");
+            break;
+        }
+        if ((hdr & 0xF0) != 0x30 || n < 2) continue;  // PUBLISH only
+        if (hdr & 0x01) continue;                     // retained: a replay, not a report
+        size_t tlen = (size_t)((body[0] << 8) | body[1]);
+        size_t off  = 2 + tlen + (((hdr >> 1) & 0x03) ? 2 : 0);  // packet id at QoS > 0
+        if (off > (size_t)n) continue;
+        account((const char*)body + 2, tlen, (const char*)body + off, (size_t)n - off, now_ms());
+    }
+    close(fd);
+    print_report();
+    return 0;
+}
+
+static void usage(const char* argv0) {
+    fprintf(stderr, "usage: %s [--broker HOST[:PORT]] [--root ROOT] [--every SECONDS] "
+                    "[--period SECONDS]\n", argv0);
+}
+
+int main(int argc, char** argv) {
+    const char* broker  = nullptr;
+    const char* root    = "devices";
+    int         every_s = 60;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--broker") == 0 && i + 1 < argc) {
+            broker = argv[++i];
+        } else if (strcmp(argv[i], "--root") == 0 && i + 1 < argc) {
+            root = argv[++i];
+        } else if (strcmp(argv[i], "--every") == 0 && i + 1 < argc) {
+            every_s = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--period") == 0 && i + 1 < argc) {
+            g_period_ms = (uint32_t)atoi(argv[++i]) * 1000u;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    struct sigaction sa = {};
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    return broker ? run_broker(broker, root, every_s) : run_stdin();
+}